@@ -0,0 +1,218 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "fp_bln_script.h"
+
+// ========================== 编译 ==========================
+static int hex_value(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	return -1;
+}
+
+bool fp_bln_params_valid(const uint8_t* params, uint8_t paramLen)
+{
+	if (paramLen == 0)
+		return false;
+	if (params[0] >= 1 && params[0] <= 6)
+		return paramLen == 4;
+	if (params[0] == 7)
+		return paramLen == 8;
+	return false;
+}
+
+esp_err_t fp_bln_append(fp_bln_sequence_t* seq, const uint8_t* params, uint8_t paramLen, uint32_t atMs, const uint8_t addr[4])
+{
+	if (seq->count >= FP_BLN_MAX_STEPS || !fp_bln_params_valid(params, paramLen))
+	{
+		return ESP_FAIL;
+	}
+	uint8_t payload[1 + 8];
+	payload[0] = CMD_CONTROL_BLN;
+	memcpy(payload + 1, params, paramLen);
+
+	fp_bln_step_t* step = &seq->steps[seq->count];
+	step->len = (uint8_t)fp_build_frame(addr, PACKET_CMD, payload, paramLen + 1, step->frame, sizeof(step->frame));
+	step->atMs = atMs;
+	seq->count++;
+	if (seq->totalMs < atMs)
+		seq->totalMs = atMs;
+	return ESP_OK;
+}
+
+esp_err_t fp_bln_compile(fp_bln_sequence_t* seq, const char* text, size_t len, const uint8_t addr[4])
+{
+	memset(seq, 0, sizeof(*seq));
+	uint32_t clockMs = 0; // 当前累计时刻
+	uint16_t line = 1;
+	size_t pos = 0;
+
+	while (pos < len)
+	{
+		size_t end = pos;
+		while (end < len && text[end] != '\n')
+			end++;
+		// 截掉注释和行尾
+		size_t stop = pos;
+		while (stop < end && text[stop] != ';')
+			stop++;
+
+		uint8_t params[16];
+		uint8_t paramLen = 0;
+		size_t i = pos;
+		while (i < stop)
+		{
+			char c = text[i];
+			if (c == ' ' || c == '\t' || c == '\r')
+			{
+				i++;
+				continue;
+			}
+			if ((c == 'S' || c == 's') && i + 1 < stop && (text[i + 1] == 'L' || text[i + 1] == 'l'))
+			{
+				// 间隔指令：SLnnnn
+				uint32_t ms = 0;
+				size_t j = i + 2;
+				while (j < stop && text[j] >= '0' && text[j] <= '9')
+					ms = ms * 10 + (uint32_t)(text[j++] - '0');
+				if (j == i + 2 || paramLen != 0)
+				{
+					seq->errorLine = line;
+					return ESP_FAIL;
+				}
+				clockMs += ms;
+				i = j;
+				continue;
+			}
+			int hi = hex_value(c);
+			int lo = i + 1 < stop ? hex_value(text[i + 1]) : -1;
+			if (hi < 0 || lo < 0 || paramLen >= sizeof(params))
+			{
+				seq->errorLine = line;
+				return ESP_FAIL;
+			}
+			params[paramLen++] = (uint8_t)(hi << 4 | lo);
+			i += 2;
+		}
+
+		if (paramLen > 0 && fp_bln_append(seq, params, paramLen, clockMs, addr) != ESP_OK)
+		{
+			seq->errorLine = line;
+			return ESP_FAIL;
+		}
+		pos = end + 1;
+		line++;
+	}
+	seq->totalMs = clockMs;
+	return seq->count > 0 ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t fp_bln_compile_file(fp_bln_sequence_t* seq, const char* path, const uint8_t addr[4])
+{
+	FILE* fp = fopen(path, "rb");
+	if (fp == nullptr)
+	{
+		printf("错误: 无法打开灯带脚本%s\n", path);
+		return ESP_FAIL;
+	}
+	char text[4096];
+	size_t len = fread(text, 1, sizeof(text), fp);
+	fclose(fp);
+	if (len == sizeof(text))
+	{
+		printf("错误: 灯带脚本超过%d字节\n", (int)sizeof(text));
+		return ESP_FAIL;
+	}
+	if (fp_bln_compile(seq, text, len, addr) != ESP_OK)
+	{
+		printf("错误: 灯带脚本第%d行格式不正确\n", seq->errorLine);
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+// ========================== 定时执行 ==========================
+// 先睡眠到目标时刻前1ms，再自旋等待，发送时刻误差在几十微秒以内
+static void wait_until_us(uint64_t due)
+{
+	uint64_t now = fp_time_us();
+	if (due > now + 1000)
+	{
+		std::this_thread::sleep_for(std::chrono::microseconds(due - now - 1000));
+	}
+	while (fp_time_us() < due)
+	{
+	}
+}
+
+// 收取已发出帧的应答，直到都收到或到达截止时刻（应答按发送顺序返回，每帧一条）
+static void drain_acks(const fp_transport_t* tp, const uint8_t addr[4], uint16_t* outstanding, uint64_t untilUs, fp_bln_report_t* report)
+{
+	while (*outstanding > 0)
+	{
+		uint64_t now = fp_time_us();
+		if (now + 1000 > untilUs)
+			return;
+		uint8_t resp[FP_MIN_FRAME_LEN + 4];
+		uint16_t respLen = fp_transport_recv_frame(tp, resp, sizeof(resp), (uint32_t)((untilUs - now) / 1000));
+		if (respLen == 0)
+			return;
+		if (fp_check_frame(resp, respLen, addr) != FP_FRAME_OK)
+			continue;
+		(*outstanding)--;
+		if (resp[FP_PAYLOAD_INDEX] == 0x00)
+			report->acked++;
+	}
+}
+
+esp_err_t fp_bln_run(const fp_bln_sequence_t* seq, const fp_transport_t* tp, bool waitAck, fp_bln_report_t* report)
+{
+	memset(report, 0, sizeof(*report));
+	uint64_t start = fp_time_us();
+	uint64_t driftSum = 0;
+	esp_err_t ret = ESP_OK;
+	uint16_t outstanding = 0; // 已发出、还没收到应答的帧数
+	const uint8_t* addr = seq->count ? seq->steps[0].frame + FP_ADDR_INDEX : nullptr;
+
+	for (uint16_t i = 0; i < seq->count; i++)
+	{
+		const fp_bln_step_t* step = &seq->steps[i];
+		uint64_t due = start + (uint64_t)step->atMs * 1000; // 绝对时刻，偏差不会逐帧累计
+		if (waitAck)
+			drain_acks(tp, addr, &outstanding, due, report); // 收应答不能占用这一帧的发送时刻
+		wait_until_us(due);
+		uint32_t drift = (uint32_t)(fp_time_us() - due);
+		driftSum += drift;
+		if (drift > report->maxDriftUs)
+			report->maxDriftUs = drift;
+
+		if (fp_transport_send(tp, step->frame, step->len) != ESP_OK)
+		{
+			ret = ESP_FAIL;
+			continue;
+		}
+		report->sent++;
+		outstanding++;
+	}
+
+	uint64_t end = start + (uint64_t)seq->totalMs * 1000;
+	if (waitAck)
+		drain_acks(tp, addr, &outstanding, end, report);
+	wait_until_us(end);
+	report->endDriftUs = (int64_t)(fp_time_us() - start) - (int64_t)seq->totalMs * 1000;
+	report->meanDriftUs = seq->count ? (uint32_t)(driftSum / seq->count) : 0;
+	if (waitAck)
+	{
+		// 最后几帧（或间隔太短来不及收的帧）的应答在序列结束之后才到
+		drain_acks(tp, addr, &outstanding, fp_time_us() + FP_BLN_ACK_TAIL_MS * 1000, report);
+		report->unanswered = outstanding;
+	}
+	return ret;
+}
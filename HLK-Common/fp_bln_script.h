@@ -0,0 +1,88 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 灯带测试脚本编译与定时执行（HLK-ZW111测试工具的BLN_TestCode.txt格式）
+// 脚本格式：每行为背光灯控制指令(0x3C)的参数字节（十六进制，空格分隔），
+//           "SLnnnn"表示间隔nnnn毫秒，";"之后为注释
+//   01 04 01 00 ;呼吸灯，红->蓝
+//   SL2000      ;间隔2秒
+//   07 24 9B AE CD AB 9C 01
+// 脚本只解析一次，编译为带包头、地址和校验和的完整帧序列，运行时只做定时发送
+
+#define FP_BLN_MAX_STEPS 64     // 最大帧数
+#define FP_BLN_MAX_FRAME 20     // 单帧最大长度（七彩灯帧为20字节）
+#define FP_BLN_ACK_TAIL_MS 200  // 序列结束后等待剩余应答的最长时间
+
+typedef struct
+{
+	uint8_t frame[FP_BLN_MAX_FRAME]; // 预编译的完整帧
+	uint8_t len;                     // 帧长度
+	uint32_t atMs;                   // 相对序列开始的发送时刻（毫秒）
+} fp_bln_step_t;
+
+typedef struct
+{
+	fp_bln_step_t steps[FP_BLN_MAX_STEPS];
+	uint16_t count;      // 帧数
+	uint32_t totalMs;    // 序列总时长（最后一帧之后的间隔也计入）
+	uint16_t errorLine;  // 编译失败时出错的行号（从1开始）
+} fp_bln_sequence_t;
+
+typedef struct
+{
+	uint16_t sent;          // 已发送帧数
+	uint16_t acked;         // 收到确认码0x00的帧数
+	uint16_t unanswered;    // 序列结束后等到FP_BLN_ACK_TAIL_MS仍没有应答的帧数
+	uint32_t maxDriftUs;    // 最大发送时刻偏差
+	uint32_t meanDriftUs;   // 平均发送时刻偏差
+	int64_t endDriftUs;     // 序列结束时刻相对计划的偏差
+} fp_bln_report_t;
+
+/**
+ * @brief 检查背光灯参数长度与功能码是否匹配（功能码1-6为4字节，七彩灯为8字节）
+ * @param params 背光灯控制参数（功能码开始）
+ * @param paramLen 参数长度
+ * @return 参数有效返回true
+ */
+bool fp_bln_params_valid(const uint8_t* params, uint8_t paramLen);
+
+/**
+ * @brief 编译脚本文本
+ * @param seq 输出帧序列
+ * @param text 脚本文本（注释可为任意编码）
+ * @param len 文本长度
+ * @param addr 设备地址
+ * @return 编译成功返回ESP_OK，失败时seq->errorLine为出错行号
+ */
+esp_err_t fp_bln_compile(fp_bln_sequence_t* seq, const char* text, size_t len, const uint8_t addr[4]);
+
+/**
+ * @brief 编译脚本文件
+ * @param seq 输出帧序列
+ * @param path 脚本文件路径
+ * @param addr 设备地址
+ * @return 编译成功返回ESP_OK
+ */
+esp_err_t fp_bln_compile_file(fp_bln_sequence_t* seq, const char* path, const uint8_t addr[4]);
+
+/**
+ * @brief 追加一帧LED控制帧（供动画编译等程序化生成序列使用）
+ * @param seq 帧序列
+ * @param params 背光灯控制参数（功能码开始）
+ * @param paramLen 参数长度
+ * @param atMs 发送时刻（相对序列开始，毫秒）
+ * @param addr 设备地址
+ * @return 序列未满且参数有效返回ESP_OK
+ */
+esp_err_t fp_bln_append(fp_bln_sequence_t* seq, const uint8_t* params, uint8_t paramLen, uint32_t atMs, const uint8_t addr[4]);
+
+/**
+ * @brief 按计划时刻执行帧序列
+ * @param seq 帧序列
+ * @param tp 传输接口
+ * @param waitAck 是否收取应答（发送间隙里收取所有未收到的应答，不占用下一帧的发送时刻；
+ *                序列结束后再收取剩余应答，最多FP_BLN_ACK_TAIL_MS，不计入结束时刻偏差）
+ * @param report 执行报告（发送时刻偏差等）
+ * @return 全部帧发送成功返回ESP_OK
+ */
+esp_err_t fp_bln_run(const fp_bln_sequence_t* seq, const fp_transport_t* tp, bool waitAck, fp_bln_report_t* report);
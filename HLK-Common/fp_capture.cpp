@@ -0,0 +1,345 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fp_capture.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define REC_COMMITTED 0x80000000u
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "记录头提交标志需要4字节原子变量");
+
+static void put64(uint8_t* p, uint64_t v)
+{
+	for (uint8_t i = 0; i < 8; i++)
+		p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get64(const uint8_t* p)
+{
+	uint64_t v = 0;
+	for (uint8_t i = 0; i < 8; i++)
+		v |= (uint64_t)p[i] << (8 * i);
+	return v;
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static size_t record_size(uint16_t len)
+{
+	return (FP_CAPTURE_REC_HDR + (size_t)len + 7) & ~(size_t)7;
+}
+
+// ========================== 写入 ==========================
+static void writer_reset(fp_capture_writer_t* w, uint8_t* buf, size_t capacity)
+{
+	w->base = buf;
+	w->capacity = capacity;
+	w->tail.store(FP_CAPTURE_FILE_HDR);
+	w->dropped.store(0);
+	w->fd = -1;
+	w->ownsBuffer = false;
+	w->path[0] = '\0';
+
+	memcpy(buf, FP_CAPTURE_MAGIC, 4);
+	buf[4] = FP_CAPTURE_VERSION;
+	buf[5] = buf[6] = buf[7] = 0;
+	put64(buf + 8, fp_time_us());
+}
+
+esp_err_t fp_capture_writer_init(fp_capture_writer_t* w, uint8_t* buf, size_t capacity)
+{
+	if (buf == nullptr || capacity < FP_CAPTURE_FILE_HDR)
+	{
+		return ESP_FAIL;
+	}
+	memset(buf, 0, capacity); // 记录头提交标志依赖初始为0
+	writer_reset(w, buf, capacity);
+	return ESP_OK;
+}
+
+esp_err_t fp_capture_writer_open(fp_capture_writer_t* w, const char* path, size_t capacity)
+{
+	if (capacity < FP_CAPTURE_FILE_HDR)
+	{
+		return ESP_FAIL;
+	}
+#ifndef _WIN32
+	int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+	{
+		printf("错误: 无法创建抓包文件%s\n", path);
+		return ESP_FAIL;
+	}
+	if (ftruncate(fd, (off_t)capacity) != 0)
+	{
+		::close(fd);
+		return ESP_FAIL;
+	}
+	void* map = mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED)
+	{
+		::close(fd);
+		return ESP_FAIL;
+	}
+	writer_reset(w, (uint8_t*)map, capacity); // ftruncate扩展的部分已为0
+	w->fd = fd;
+#else
+	uint8_t* buf = (uint8_t*)calloc(1, capacity);
+	if (buf == nullptr)
+	{
+		return ESP_FAIL;
+	}
+	writer_reset(w, buf, capacity);
+	w->ownsBuffer = true;
+#endif
+	strncpy(w->path, path, sizeof(w->path) - 1);
+	w->path[sizeof(w->path) - 1] = '\0';
+	return ESP_OK;
+}
+
+esp_err_t fp_capture_append(fp_capture_writer_t* w, uint8_t dir, uint8_t port, const uint8_t addr[4],
+	const uint8_t* data, uint16_t len)
+{
+	size_t size = record_size(len);
+	// 只在放得下时推进tail，tail从不回退：先加后减的回滚在并发时会让两条记录预留到同一位置
+	size_t off = w->tail.load(std::memory_order_relaxed);
+	do
+	{
+		if (off + size > w->capacity)
+		{
+			w->dropped.fetch_add(1, std::memory_order_relaxed);
+			return ESP_FAIL;
+		}
+	} while (!w->tail.compare_exchange_weak(off, off + size, std::memory_order_relaxed));
+
+	// 预留成功后再取时间戳：预留顺序即文件中的记录顺序，先取时间戳会让后面的记录带上更早的时间
+	// （取时间戳前被抢占仍可能有微小的倒序，读取方按0间隔处理）
+	uint8_t* rec = w->base + off;
+	memcpy(rec + 4, addr, 4);
+	put64(rec + 8, fp_time_us());
+	memcpy(rec + FP_CAPTURE_REC_HDR, data, len);
+	// 最后写入info并置提交标志，读取方看到标志即可确认整条记录完整
+	if (port > FP_CAPTURE_MAX_PORT)
+		port = FP_CAPTURE_MAX_PORT;
+	uint32_t info = len | ((uint32_t)dir << 16) | ((uint32_t)port << 24) | REC_COMMITTED;
+	reinterpret_cast<std::atomic<uint32_t>*>(rec)->store(info, std::memory_order_release);
+	return ESP_OK;
+}
+
+size_t fp_capture_writer_size(fp_capture_writer_t* w)
+{
+	size_t tail = w->tail.load(std::memory_order_relaxed);
+	return tail < w->capacity ? tail : w->capacity;
+}
+
+void fp_capture_writer_close(fp_capture_writer_t* w)
+{
+	size_t size = fp_capture_writer_size(w);
+#ifndef _WIN32
+	if (w->fd >= 0)
+	{
+		msync(w->base, w->capacity, MS_SYNC);
+		munmap(w->base, w->capacity);
+		if (ftruncate(w->fd, (off_t)size) != 0)
+		{
+			printf("警告: 抓包文件截断失败\n");
+		}
+		::close(w->fd);
+		w->fd = -1;
+	}
+#endif
+	if (w->ownsBuffer)
+	{
+		FILE* fp = fopen(w->path, "wb");
+		if (fp != nullptr)
+		{
+			fwrite(w->base, 1, size, fp);
+			fclose(fp);
+		}
+		free(w->base);
+	}
+	w->base = nullptr;
+	w->capacity = 0;
+}
+
+// ========================== 读取 ==========================
+esp_err_t fp_capture_reader_init(fp_capture_reader_t* r, const uint8_t* data, size_t size)
+{
+	memset(r, 0, sizeof(*r));
+	if (data == nullptr || size < FP_CAPTURE_FILE_HDR || memcmp(data, FP_CAPTURE_MAGIC, 4) != 0)
+	{
+		return ESP_FAIL;
+	}
+	r->base = data;
+	r->size = size;
+	r->pos = FP_CAPTURE_FILE_HDR;
+	r->startUs = get64(data + 8);
+	return ESP_OK;
+}
+
+esp_err_t fp_capture_reader_open(fp_capture_reader_t* r, const char* path)
+{
+	memset(r, 0, sizeof(*r));
+#ifndef _WIN32
+	int fd = ::open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return ESP_FAIL;
+	}
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size < FP_CAPTURE_FILE_HDR)
+	{
+		::close(fd);
+		return ESP_FAIL;
+	}
+	size_t size = (size_t)st.st_size;
+	void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (map == MAP_FAILED)
+	{
+		return ESP_FAIL;
+	}
+	madvise(map, size, MADV_SEQUENTIAL);
+#else
+	FILE* fp = fopen(path, "rb");
+	if (fp == nullptr)
+	{
+		return ESP_FAIL;
+	}
+	fseek(fp, 0, SEEK_END);
+	size_t size = (size_t)ftell(fp);
+	fseek(fp, 0, SEEK_SET);
+	void* map = malloc(size);
+	if (map == nullptr || fread(map, 1, size, fp) != size)
+	{
+		free(map);
+		fclose(fp);
+		return ESP_FAIL;
+	}
+	fclose(fp);
+#endif
+	if (fp_capture_reader_init(r, (const uint8_t*)map, size) != ESP_OK)
+	{
+		r->map = map;
+		r->mapSize = size;
+		fp_capture_reader_close(r);
+		return ESP_FAIL;
+	}
+	r->map = map;
+	r->mapSize = size;
+	return ESP_OK;
+}
+
+bool fp_capture_next(fp_capture_reader_t* r, fp_capture_record_t* rec)
+{
+	if (r->pos + FP_CAPTURE_REC_HDR > r->size)
+	{
+		return false;
+	}
+	const uint8_t* p = r->base + r->pos;
+	uint32_t info = get32(p);
+	uint16_t len = (uint16_t)(info & 0xFFFF);
+	if (!(info & REC_COMMITTED) || r->pos + FP_CAPTURE_REC_HDR + len > r->size)
+	{
+		return false;
+	}
+	rec->len = len;
+	rec->dir = (uint8_t)(info >> 16);
+	rec->port = (uint8_t)((info >> 24) & FP_CAPTURE_MAX_PORT);
+	memcpy(rec->addr, p + 4, 4);
+	rec->tsUs = get64(p + 8);
+	rec->data = p + FP_CAPTURE_REC_HDR;
+	r->pos += record_size(len);
+	return true;
+}
+
+// 记录头是否合理：已提交、方向有效、长度不越界、时间戳不早于抓包开始
+static bool plausible_header(const fp_capture_reader_t* r, size_t pos)
+{
+	const uint8_t* p = r->base + pos;
+	uint32_t info = get32(p);
+	uint8_t dir = (uint8_t)(info >> 16);
+	return (info & REC_COMMITTED) && (dir == FP_DIR_TX || dir == FP_DIR_RX) &&
+		pos + FP_CAPTURE_REC_HDR + (info & 0xFFFF) <= r->size && get64(p + 8) >= r->startUs;
+}
+
+size_t fp_capture_resync(const fp_capture_reader_t* r, size_t pos)
+{
+	// 记录按8字节对齐；数据区里碰巧像记录头的字节，后面几条通常接不上，连续校验RESYNC_DEPTH条
+	const int RESYNC_DEPTH = 8;
+	if (pos < FP_CAPTURE_FILE_HDR)
+		pos = FP_CAPTURE_FILE_HDR;
+	pos = (pos + 7) & ~(size_t)7;
+	for (; pos + FP_CAPTURE_REC_HDR <= r->size; pos += 8)
+	{
+		size_t q = pos;
+		int good = 0;
+		while (good < RESYNC_DEPTH && q + FP_CAPTURE_REC_HDR <= r->size && plausible_header(r, q))
+		{
+			q += record_size((uint16_t)(get32(r->base + q) & 0xFFFF));
+			good++;
+		}
+		// 连续够数，或一直接到数据末尾（含未提交的空白）都算找到
+		bool atEnd = q + FP_CAPTURE_REC_HDR > r->size || get32(r->base + q) == 0;
+		if (good == RESYNC_DEPTH || (good > 0 && atEnd))
+			return pos;
+	}
+	return r->size;
+}
+
+void fp_capture_reader_close(fp_capture_reader_t* r)
+{
+	if (r->map != nullptr)
+	{
+#ifndef _WIN32
+		munmap(r->map, r->mapSize);
+#else
+		free(r->map);
+#endif
+	}
+	memset(r, 0, sizeof(*r));
+}
+
+// ========================== 传输抓包 ==========================
+static int tap_write(void* ctx, const uint8_t* data, uint16_t len)
+{
+	fp_capture_tap_t* tap = (fp_capture_tap_t*)ctx;
+	int n = tap->inner.write(tap->inner.ctx, data, len);
+	if (n > 0)
+	{
+		fp_capture_append(tap->writer, FP_DIR_TX, tap->port, tap->addr, data, (uint16_t)n);
+	}
+	return n;
+}
+
+static int tap_read(void* ctx, uint8_t* buf, uint16_t cap, uint32_t timeoutMs)
+{
+	fp_capture_tap_t* tap = (fp_capture_tap_t*)ctx;
+	int n = tap->inner.read(tap->inner.ctx, buf, cap, timeoutMs);
+	if (n > 0)
+	{
+		fp_capture_append(tap->writer, FP_DIR_RX, tap->port, tap->addr, buf, (uint16_t)n);
+	}
+	return n;
+}
+
+void fp_transport_capture(fp_transport_t* tp, fp_capture_tap_t* tap, const fp_transport_t* inner,
+	fp_capture_writer_t* writer, uint8_t port, const uint8_t addr[4])
+{
+	tap->inner = *inner;
+	tap->writer = writer;
+	tap->port = port;
+	memcpy(tap->addr, addr, 4);
+	tp->ctx = tap;
+	tp->write = tap_write;
+	tp->read = tap_read;
+}
@@ -0,0 +1,150 @@
+﻿#pragma once
+#include <atomic>
+#include "fp_transport.h"
+
+// 串口流量抓包格式（小端存储）
+// 文件头16字节：魔数"FPC1"(4) + 版本(4) + 抓包开始时间(8，微秒)
+// 每条记录：记录头16字节 + 原始字节 + 填充到8字节对齐
+//   info(4)：bit0-15长度，bit16-23方向，bit24-30端口号，bit31已提交标志（最后写入）
+//   addr(4)：设备地址
+//   tsUs(8)：单调时钟时间戳（微秒）
+
+#define FP_CAPTURE_MAGIC "FPC1"
+#define FP_CAPTURE_VERSION 1
+#define FP_CAPTURE_FILE_HDR 16
+#define FP_CAPTURE_REC_HDR 16
+
+#define FP_DIR_TX 0 // 主机 -> 模块
+#define FP_DIR_RX 1 // 模块 -> 主机
+
+#define FP_CAPTURE_MAX_PORT 127 // 端口号上限（同一抓包文件里区分多个串口，默认地址相同的设备靠它分开）
+
+typedef struct
+{
+	uint8_t dir;          // 方向（FP_DIR_xxx）
+	uint8_t port;         // 端口号（版本1早期的文件为0）
+	uint8_t addr[4];      // 设备地址
+	uint64_t tsUs;        // 时间戳（微秒）
+	const uint8_t* data;  // 原始字节（直接指向映射内存，不拷贝）
+	uint16_t len;         // 字节数
+} fp_capture_record_t;
+
+// ========================== 写入 ==========================
+// 多线程写入只通过原子加法预留空间，各自填写后再置提交标志，不加锁
+typedef struct
+{
+	uint8_t* base;               // 映射内存或调用者提供的缓冲区
+	size_t capacity;             // 容量
+	std::atomic<size_t> tail;    // 已预留的末尾位置
+	std::atomic<uint32_t> dropped; // 空间不足丢弃的记录数
+	int fd;                      // 文件模式下的文件描述符（内存模式为-1）
+	bool ownsBuffer;             // 缓冲区是否由写入器分配
+	char path[256];              // 文件路径（Windows下关闭时写出）
+} fp_capture_writer_t;
+
+/**
+ * @brief 以调用者提供的内存初始化写入器（MCU上可放在静态RAM中）
+ * @param w 写入器
+ * @param buf 缓冲区
+ * @param capacity 缓冲区容量
+ * @return 容量足够写入文件头返回ESP_OK
+ */
+esp_err_t fp_capture_writer_init(fp_capture_writer_t* w, uint8_t* buf, size_t capacity);
+
+/**
+ * @brief 创建抓包文件并映射（POSIX下直接写入映射内存）
+ * @param w 写入器
+ * @param path 文件路径
+ * @param capacity 文件最大容量
+ * @return 成功返回ESP_OK
+ */
+esp_err_t fp_capture_writer_open(fp_capture_writer_t* w, const char* path, size_t capacity);
+
+/**
+ * @brief 追加一条记录（可在多个线程中并发调用）
+ * @param w 写入器
+ * @param dir 方向（FP_DIR_xxx）
+ * @param port 端口号（0-FP_CAPTURE_MAX_PORT，超出按上限记录）
+ * @param addr 设备地址
+ * @param data 原始字节
+ * @param len 字节数
+ * @return 空间不足返回ESP_FAIL（计入dropped）
+ */
+esp_err_t fp_capture_append(fp_capture_writer_t* w, uint8_t dir, uint8_t port, const uint8_t addr[4],
+	const uint8_t* data, uint16_t len);
+
+/**
+ * @brief 当前抓包数据长度（含文件头）
+ */
+size_t fp_capture_writer_size(fp_capture_writer_t* w);
+
+/**
+ * @brief 关闭写入器（文件模式下截断到实际长度）
+ */
+void fp_capture_writer_close(fp_capture_writer_t* w);
+
+// ========================== 读取 ==========================
+typedef struct
+{
+	const uint8_t* base;  // 抓包数据
+	size_t size;          // 数据长度
+	size_t pos;           // 当前读取位置
+	uint64_t startUs;     // 抓包开始时间
+	void* map;            // 映射/分配的内存（内存模式为nullptr）
+	size_t mapSize;       // 映射长度
+} fp_capture_reader_t;
+
+/**
+ * @brief 以内存中的抓包数据初始化读取器
+ * @return 文件头有效返回ESP_OK
+ */
+esp_err_t fp_capture_reader_init(fp_capture_reader_t* r, const uint8_t* data, size_t size);
+
+/**
+ * @brief 打开并映射抓包文件
+ * @return 成功返回ESP_OK
+ */
+esp_err_t fp_capture_reader_open(fp_capture_reader_t* r, const char* path);
+
+/**
+ * @brief 读取下一条记录（遇到未提交或截断的记录即结束）
+ * @param r 读取器
+ * @param rec 输出记录
+ * @return 读到记录返回true
+ */
+bool fp_capture_next(fp_capture_reader_t* r, fp_capture_record_t* rec);
+
+/**
+ * @brief 从任意偏移找到下一条记录的起点（按记录头连续校验，用于把抓包切成多段并行处理）
+ * @param r 抓包读取器
+ * @param pos 起始偏移
+ * @return 不小于pos的第一个记录起点，没有时返回数据长度
+ */
+size_t fp_capture_resync(const fp_capture_reader_t* r, size_t pos);
+
+/**
+ * @brief 关闭读取器
+ */
+void fp_capture_reader_close(fp_capture_reader_t* r);
+
+// ========================== 传输抓包 ==========================
+// 包在任意传输外层，收发的每段字节都追加到抓包（上层代码无需改动）
+typedef struct
+{
+	fp_transport_t inner;         // 被包装的传输
+	fp_capture_writer_t* writer;  // 抓包写入器
+	uint8_t port;                 // 记录使用的端口号
+	uint8_t addr[4];              // 记录使用的设备地址
+} fp_capture_tap_t;
+
+/**
+ * @brief 生成带抓包功能的传输
+ * @param tp 输出传输接口
+ * @param tap 抓包上下文（生命周期由调用者保证）
+ * @param inner 被包装的传输
+ * @param writer 抓包写入器
+ * @param port 端口号（多个串口写同一抓包文件时各用不同的号）
+ * @param addr 设备地址
+ */
+void fp_transport_capture(fp_transport_t* tp, fp_capture_tap_t* tap, const fp_transport_t* inner,
+	fp_capture_writer_t* writer, uint8_t port, const uint8_t addr[4]);
@@ -0,0 +1,135 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_dispatch.h"
+
+// ========================== 解码函数 ==========================
+// 只有确认码的应答
+static bool decode_confirm(const uint8_t*, uint16_t, fp_decoded_t*)
+{
+	return true;
+}
+
+// 带字段的应答：绑定对应的视图
+template <typename V, V fp_decoded_t::*M>
+static bool decode_view(const uint8_t* frame, uint16_t len, fp_decoded_t* out)
+{
+	return fp_view_bind(&(out->*M), frame, len);
+}
+
+// ========================== 分派表 ==========================
+struct dispatch_table
+{
+	fp_dispatch_entry_t e[FP_DISPATCH_SIZE];
+};
+
+static constexpr dispatch_table make_table()
+{
+	dispatch_table t{};
+	t.e[CMD_GET_IMAGE] = { decode_confirm, "GetImage" };
+	t.e[CMD_GEN_CHAR] = { decode_confirm, "GenChar" };
+	t.e[CMD_MATCH] = { decode_confirm, "Match" };
+	t.e[CMD_SEARCH] = { decode_view<fp_search_view, &fp_decoded_t::search>, "Search" };
+	t.e[CMD_REG_MODEL] = { decode_confirm, "RegModel" };
+	t.e[CMD_STORE_CHAR] = { decode_confirm, "StoreChar" };
+	t.e[CMD_LOAD_CHAR] = { decode_confirm, "LoadChar" };
+	t.e[CMD_UP_CHAR] = { decode_confirm, "UpChar" };
+	t.e[CMD_DOWN_CHAR] = { decode_confirm, "DownChar" };
+	t.e[CMD_UP_IMAGE] = { decode_confirm, "UpImage" };
+	t.e[CMD_DOWN_IMAGE] = { decode_confirm, "DownImage" };
+	t.e[CMD_DELET_CHAR] = { decode_confirm, "DeletChar" };
+	t.e[CMD_EMPTY] = { decode_confirm, "Empty" };
+	t.e[CMD_WRITE_REG] = { decode_confirm, "WriteReg" };
+	t.e[CMD_READ_SYSPARA] = { decode_view<fp_syspara_view, &fp_decoded_t::syspara>, "ReadSysPara" };
+	t.e[CMD_SET_PWD] = { decode_confirm, "SetPwd" };
+	t.e[CMD_VFY_PWD] = { decode_confirm, "VfyPwd" };
+	t.e[CMD_SET_CHIP_ADDR] = { decode_confirm, "SetChipAddr" };
+	t.e[CMD_VALID_TEMPLATE_NUM] = { decode_view<fp_template_num_view, &fp_decoded_t::templateNum>, "ValidTempleteNum" };
+	t.e[CMD_READ_INDEX_TABLE] = { decode_view<fp_index_page_view, &fp_decoded_t::indexPage>, "ReadIndexTable" };
+	t.e[CMD_CANCEL] = { decode_confirm, "Cancel" };
+	t.e[CMD_AUTO_ENROLL] = { decode_view<fp_enroll_view, &fp_decoded_t::enroll>, "AutoEnroll" };
+	t.e[CMD_AUTO_IDENTIFY] = { decode_view<fp_identify_view, &fp_decoded_t::identify>, "AutoIdentify" };
+	t.e[CMD_SLEEP] = { decode_confirm, "Sleep" };
+	t.e[CMD_GET_CHIP_SN] = { decode_confirm, "GetChipSN" };
+	t.e[CMD_HANDSHAKE] = { decode_confirm, "HandShake" };
+	t.e[CMD_CHECK_SENSOR] = { decode_confirm, "CheckSensor" };
+	t.e[CMD_CONTROL_BLN] = { decode_confirm, "ControlBLN" };
+	return t;
+}
+
+static constexpr dispatch_table kTable = make_table();
+
+const fp_dispatch_entry_t* fp_dispatch_entry(uint8_t cmd)
+{
+	return cmd < FP_DISPATCH_SIZE && kTable.e[cmd].decode != nullptr ? &kTable.e[cmd] : nullptr;
+}
+
+const char* fp_dispatch_name(uint8_t cmd)
+{
+	const fp_dispatch_entry_t* e = fp_dispatch_entry(cmd);
+	return e != nullptr ? e->name : "?";
+}
+
+// ========================== 分派 ==========================
+void fp_dispatch_init(fp_dispatch_t* d, void* user)
+{
+	memset(d, 0, sizeof(*d));
+	d->user = user;
+}
+
+esp_err_t fp_dispatch_on(fp_dispatch_t* d, uint8_t cmd, fp_complete_fn fn)
+{
+	if (fp_dispatch_entry(cmd) == nullptr)
+		return ESP_FAIL;
+	d->handlers[cmd] = fn;
+	return ESP_OK;
+}
+
+// 慢路径：未收录的指令码，只给出确认码
+static esp_err_t dispatch_unknown(fp_dispatch_t* d, fp_decoded_t* out)
+{
+	d->unknown++;
+	if (d->fallback != nullptr)
+		d->fallback(d->user, out);
+	return ESP_FAIL;
+}
+
+esp_err_t fp_dispatch(fp_dispatch_t* d, uint8_t cmd, const uint8_t* frame, uint16_t len)
+{
+	if (frame == nullptr || len < FP_MIN_FRAME_LEN)
+	{
+		d->decodeErrors++;
+		return ESP_FAIL;
+	}
+	fp_decoded_t out;
+	out.cmd = cmd;
+	out.bound = false;
+	out.confirm = frame[FP_PAYLOAD_INDEX];
+	out.frame = frame;
+	out.len = len;
+
+	fp_decode_fn decode = cmd < FP_DISPATCH_SIZE ? kTable.e[cmd].decode : nullptr;
+	if (decode == nullptr)
+	{
+		return dispatch_unknown(d, &out);
+	}
+	// 失败应答可能只有确认码，绑不上字段也照常回调；成功应答必须带齐字段
+	out.bound = decode(frame, len, &out);
+	if (out.confirm == 0x00 && !out.bound)
+	{
+		d->decodeErrors++;
+		return ESP_FAIL;
+	}
+	d->dispatched++;
+	fp_complete_fn fn = d->handlers[cmd];
+	if (fn != nullptr)
+		fn(d->user, &out);
+	else
+		d->unhandled++;
+	return ESP_OK;
+}
+
+void fp_dispatch_print_stats(const fp_dispatch_t* d)
+{
+	printf("应答分派：%u帧，未收录指令%u帧，长度不足%u帧，无回调%u帧\n",
+		d->dispatched, d->unknown, d->decodeErrors, d->unhandled);
+}
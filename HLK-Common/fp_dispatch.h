@@ -0,0 +1,98 @@
+﻿#pragma once
+#include "fp_views.h"
+
+// 应答分派：按应答所对应的指令码直接索引一张稠密表（0x00-0x3F），
+// 表项里的解码函数和名称在编译期确定，每帧的分派开销是一次数组下标，与支持的指令数无关；
+// 解码后按指令码调用应用注册的完成回调；表外或未收录的指令码走计数的慢路径
+//
+// 应答帧本身不带指令码，由调用者按在途命令给出（一问一答时即刚发出的命令）
+
+#define FP_DISPATCH_SIZE 0x40 // 表大小，覆盖CMD_GET_IMAGE(0x01)到CMD_CONTROL_BLN(0x3C)
+
+// 解码结果：视图直接指向应答帧，不拷贝
+typedef struct
+{
+	uint8_t cmd;     // 指令码
+	uint8_t confirm; // 确认码
+	bool bound;      // 视图已绑定（失败应答只有确认码时为false，只能看确认码）
+	const uint8_t* frame;
+	uint16_t len;
+	union
+	{
+		fp_syspara_view syspara;         // 读模组基本参数
+		fp_index_page_view indexPage;    // 读索引表
+		fp_identify_view identify;       // 自动识别
+		fp_enroll_view enroll;           // 自动注册
+		fp_search_view search;           // 搜索指纹
+		fp_template_num_view templateNum; // 读有效模板个数
+	};
+} fp_decoded_t;
+
+/**
+ * @brief 解码函数：校验该指令应答的长度并绑定视图
+ * @return 应答长度不足该指令的字段布局返回false
+ */
+typedef bool (*fp_decode_fn)(const uint8_t* frame, uint16_t len, fp_decoded_t* out);
+
+/**
+ * @brief 完成回调
+ * @param user 回调参数
+ * @param d 解码结果（只在回调期间有效）
+ */
+typedef void (*fp_complete_fn)(void* user, const fp_decoded_t* d);
+
+typedef struct
+{
+	fp_decode_fn decode; // 解码函数（nullptr表示未收录）
+	const char* name;    // 指令名称
+} fp_dispatch_entry_t;
+
+typedef struct
+{
+	fp_complete_fn handlers[FP_DISPATCH_SIZE]; // 各指令的完成回调
+	fp_complete_fn fallback;                   // 未收录指令的回调（可为nullptr）
+	void* user;                                // 回调参数
+	// 统计
+	uint32_t dispatched;                       // 经快路径分派的帧数
+	uint32_t unknown;                          // 走慢路径的帧数（未收录的指令码）
+	uint32_t decodeErrors;                     // 长度不足字段布局的帧数
+	uint32_t unhandled;                        // 没有注册回调的帧数
+} fp_dispatch_t;
+
+/**
+ * @brief 指令码对应的表项（编译期生成的表）
+ */
+const fp_dispatch_entry_t* fp_dispatch_entry(uint8_t cmd);
+
+/**
+ * @brief 指令名称（未收录返回"?"）
+ */
+const char* fp_dispatch_name(uint8_t cmd);
+
+/**
+ * @brief 初始化分派器
+ * @param d 分派器
+ * @param user 回调参数
+ */
+void fp_dispatch_init(fp_dispatch_t* d, void* user);
+
+/**
+ * @brief 注册某条指令的完成回调
+ * @return 指令码未收录返回ESP_FAIL
+ */
+esp_err_t fp_dispatch_on(fp_dispatch_t* d, uint8_t cmd, fp_complete_fn fn);
+
+/**
+ * @brief 分派一帧已校验的应答
+ * @param d 分派器
+ * @param cmd 应答对应的指令码
+ * @param frame 应答帧
+ * @param len 帧长度
+ * @return 解码成功返回ESP_OK（与是否注册回调无关；失败应答长度不足字段布局时照常回调，bound为false）
+ */
+esp_err_t fp_dispatch(fp_dispatch_t* d, uint8_t cmd, const uint8_t* frame, uint16_t len);
+
+/**
+ * @brief 打印分派统计
+ */
+void fp_dispatch_print_stats(const fp_dispatch_t* d);
@@ -0,0 +1,181 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "fp_fleet.h"
+
+// ========================== 常用管理命令 ==========================
+static void set_cmd(fp_fleet_command_t* cmd, uint8_t code, uint32_t timeoutMs)
+{
+	memset(cmd, 0, sizeof(*cmd));
+	cmd->cmd = code;
+	cmd->timeoutMs = timeoutMs;
+}
+
+void fp_fleet_cmd_empty(fp_fleet_command_t* cmd)
+{
+	set_cmd(cmd, CMD_EMPTY, 2000); // 清空需擦除Flash
+}
+
+void fp_fleet_cmd_sleep(fp_fleet_command_t* cmd)
+{
+	set_cmd(cmd, CMD_SLEEP, 300);
+}
+
+void fp_fleet_cmd_cancel(fp_fleet_command_t* cmd)
+{
+	set_cmd(cmd, CMD_CANCEL, 300);
+}
+
+void fp_fleet_cmd_read_index_table(fp_fleet_command_t* cmd, uint8_t page)
+{
+	set_cmd(cmd, CMD_READ_INDEX_TABLE, 300);
+	cmd->params[0] = page;
+	cmd->paramLen = 1;
+}
+
+void fp_fleet_cmd_control_led(fp_fleet_command_t* cmd, uint8_t functionCode, uint8_t startColor, uint8_t endColor, uint8_t cycleTimes)
+{
+	set_cmd(cmd, CMD_CONTROL_BLN, 300);
+	cmd->params[0] = functionCode;
+	cmd->params[1] = startColor & 0x07;
+	cmd->params[2] = endColor & 0x07;
+	cmd->params[3] = cycleTimes;
+	cmd->paramLen = 4;
+}
+
+// ========================== 执行器 ==========================
+// 超时或坏帧后线路上可能还有迟到的应答，读到安静为止，免得被同一端口上的下一台设备当成自己的应答
+// （设备都用默认地址FFFFFFFF时按地址校验分辨不出来）
+static void drain(const fp_transport_t* tp)
+{
+	uint8_t buf[64];
+	while (tp->read(tp->ctx, buf, sizeof(buf), 20) > 0)
+	{
+	}
+}
+
+static void run_one(const fp_fleet_device_t* dev, const fp_fleet_command_t* cmd, fp_fleet_result_t* result)
+{
+	uint8_t resp[FP_MAX_FRAME_LEN];
+	memset(result, 0, sizeof(*result));
+	result->ok = fp_transact(&dev->transport, dev->addr, cmd->cmd, cmd->params, cmd->paramLen,
+		resp, sizeof(resp), cmd->timeoutMs, &result->xfer);
+	if (result->xfer.frame == FP_FRAME_OK)
+	{
+		uint16_t payloadLen = 0;
+		const uint8_t* payload = fp_frame_payload(resp, &payloadLen);
+		uint16_t dataLen = payloadLen > 1 ? payloadLen - 1 : 0;
+		result->dataLen = (uint8_t)std::min<uint16_t>(dataLen, FP_FLEET_MAX_DATA);
+		memcpy(result->data, payload + 1, result->dataLen);
+	}
+	else if (!result->xfer.linkError)
+	{
+		drain(&dev->transport);
+	}
+}
+
+esp_err_t fp_fleet_run(const fp_fleet_device_t* devices, size_t count, const fp_fleet_command_t* cmd,
+	size_t concurrency, fp_fleet_result_t* results, fp_fleet_report_t* report)
+{
+	memset(report, 0, sizeof(*report));
+	report->total = (uint32_t)count;
+	if (count == 0)
+	{
+		return ESP_OK;
+	}
+
+	// 按端口分组：同一端口上的设备必须串行，不同端口之间并发
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		order[i] = i;
+	}
+	std::stable_sort(order.begin(), order.end(), [devices](size_t a, size_t b) {
+		return devices[a].transport.ctx < devices[b].transport.ctx;
+	});
+	std::vector<size_t> groupStart;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (i == 0 || devices[order[i]].transport.ctx != devices[order[i - 1]].transport.ctx)
+		{
+			groupStart.push_back(i);
+		}
+	}
+	size_t groups = groupStart.size();
+	groupStart.push_back(count);
+	report->ports = (uint32_t)groups;
+
+	size_t workers = (concurrency == 0 || concurrency > groups) ? groups : concurrency;
+	std::atomic<size_t> nextGroup(0);
+	auto worker = [&]() {
+		size_t g;
+		while ((g = nextGroup.fetch_add(1)) < groups)
+		{
+			for (size_t i = groupStart[g]; i < groupStart[g + 1]; i++)
+			{
+				run_one(&devices[order[i]], cmd, &results[order[i]]);
+			}
+		}
+	};
+
+	uint64_t start = fp_time_us();
+	std::vector<std::thread> pool;
+	for (size_t w = 1; w < workers; w++)
+	{
+		pool.emplace_back(worker);
+	}
+	worker(); // 当前线程也参与执行
+	for (auto& t : pool)
+	{
+		t.join();
+	}
+	report->wallUs = fp_time_us() - start;
+
+	// 汇总
+	for (size_t i = 0; i < count; i++)
+	{
+		const fp_fleet_result_t* r = &results[i];
+		if (r->ok)
+			report->okCount++;
+		else if (r->xfer.linkError)
+			report->linkErrorCount++;
+		else if (r->xfer.timeout)
+			report->timeoutCount++;
+		else if (r->xfer.frame != FP_FRAME_OK)
+			report->frameErrorCount++;
+		else
+			report->moduleErrorCount++;
+		report->sumLatencyUs += r->xfer.latencyUs;
+		report->maxLatencyUs = std::max(report->maxLatencyUs, r->xfer.latencyUs);
+	}
+	return report->okCount == report->total ? ESP_OK : ESP_FAIL;
+}
+
+void fp_fleet_print_report(const fp_fleet_device_t* devices, size_t count,
+	const fp_fleet_result_t* results, const fp_fleet_report_t* report)
+{
+	printf("批量命令完成：设备%u台，端口%u个，成功%u，超时%u，帧错误%u，模块错误%u，链路错误%u\n",
+		report->total, report->ports, report->okCount, report->timeoutCount,
+		report->frameErrorCount, report->moduleErrorCount, report->linkErrorCount);
+	printf("总耗时%.1fms（串行需%.1fms），单台最大延迟%.1fms\n",
+		report->wallUs / 1000.0, report->sumLatencyUs / 1000.0, report->maxLatencyUs / 1000.0);
+	for (size_t i = 0; i < count; i++)
+	{
+		const fp_fleet_result_t* r = &results[i];
+		if (r->ok)
+			continue;
+		printf("  失败：%s（地址%02X%02X%02X%02X）", devices[i].name ? devices[i].name : "-",
+			devices[i].addr[0], devices[i].addr[1], devices[i].addr[2], devices[i].addr[3]);
+		if (r->xfer.linkError)
+			printf(" 链路错误\n");
+		else if (r->xfer.timeout)
+			printf(" 应答超时\n");
+		else if (r->xfer.frame != FP_FRAME_OK)
+			printf(" 应答帧校验失败(%d)\n", (int)r->xfer.frame);
+		else
+			printf(" 确认码=%02X\n", r->xfer.confirm);
+	}
+}
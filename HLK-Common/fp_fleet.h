@@ -0,0 +1,75 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 批量管理命令执行器：把同一条命令（清空、休眠、LED测试、读索引表等）
+// 下发到整栋楼的所有模块，按端口并发、端口内串行（RS-485总线上的多个地址共用一个端口），
+// 总耗时约等于最慢端口的耗时，而不是所有设备耗时之和
+
+#define FP_FLEET_MAX_PARAMS 16 // 管理命令参数上限
+#define FP_FLEET_MAX_DATA 32   // 每台设备保存的应答数据上限（索引表一页正好32字节）
+
+typedef struct
+{
+	const char* name;          // 设备名称（报告用）
+	uint8_t addr[4];           // 设备地址
+	fp_transport_t transport;  // 所在端口（ctx相同视为同一端口）
+} fp_fleet_device_t;
+
+typedef struct
+{
+	uint8_t cmd;                          // 指令码
+	uint8_t params[FP_FLEET_MAX_PARAMS];  // 指令参数
+	uint8_t paramLen;                     // 参数长度
+	uint32_t timeoutMs;                   // 单台设备应答超时
+} fp_fleet_command_t;
+
+typedef struct
+{
+	fp_transact_result_t xfer;      // 交互结果（确认码、超时、帧校验、延迟）
+	esp_err_t ok;                   // 是否成功（确认码为0x00）
+	uint8_t data[FP_FLEET_MAX_DATA];// 确认码之后的应答数据
+	uint8_t dataLen;                // 应答数据长度
+} fp_fleet_result_t;
+
+typedef struct
+{
+	uint32_t total;            // 设备总数
+	uint32_t okCount;          // 成功数
+	uint32_t timeoutCount;     // 超时数
+	uint32_t frameErrorCount;  // 应答帧校验失败数
+	uint32_t moduleErrorCount; // 模块返回非0确认码数
+	uint32_t linkErrorCount;   // 链路错误数
+	uint32_t ports;            // 端口数
+	uint32_t maxLatencyUs;     // 单台最大延迟
+	uint64_t sumLatencyUs;     // 单台延迟之和（即串行执行所需时间）
+	uint64_t wallUs;           // 实际总耗时
+} fp_fleet_report_t;
+
+// ========================== 常用管理命令 ==========================
+void fp_fleet_cmd_empty(fp_fleet_command_t* cmd);
+void fp_fleet_cmd_sleep(fp_fleet_command_t* cmd);
+void fp_fleet_cmd_cancel(fp_fleet_command_t* cmd);
+void fp_fleet_cmd_read_index_table(fp_fleet_command_t* cmd, uint8_t page);
+/**
+ * @brief LED测试图案（参数含义同各型号驱动中的control_led）
+ */
+void fp_fleet_cmd_control_led(fp_fleet_command_t* cmd, uint8_t functionCode, uint8_t startColor, uint8_t endColor, uint8_t cycleTimes);
+
+/**
+ * @brief 向一组设备下发同一条命令并汇总结果
+ * @param devices 设备列表
+ * @param count 设备数量
+ * @param cmd 命令
+ * @param concurrency 最大并发端口数（0表示不限制）
+ * @param results 每台设备的结果（与devices一一对应，调用者分配count项）
+ * @param report 汇总报告
+ * @return 全部设备成功返回ESP_OK
+ */
+esp_err_t fp_fleet_run(const fp_fleet_device_t* devices, size_t count, const fp_fleet_command_t* cmd,
+	size_t concurrency, fp_fleet_result_t* results, fp_fleet_report_t* report);
+
+/**
+ * @brief 打印汇总报告及失败设备明细
+ */
+void fp_fleet_print_report(const fp_fleet_device_t* devices, size_t count,
+	const fp_fleet_result_t* results, const fp_fleet_report_t* report);
@@ -0,0 +1,148 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_health.h"
+
+static const char* const kStateNames[] = { "未知", "正常", "降级", "断开" };
+
+void fp_health_default_config(fp_health_config_t* cfg)
+{
+	cfg->idleMs = 5000;
+	cfg->probeCmd = CMD_HANDSHAKE;
+	cfg->downAfter = 3;
+	cfg->recoverAfter = 2;
+	cfg->badFramePermille = 100;
+	cfg->rttFactorPct = 300;
+	cfg->rttSlackUs = 5000;
+}
+
+void fp_health_init(fp_health_t* h, const fp_health_config_t* cfg, fp_health_event_t onChange, void* user)
+{
+	memset(h, 0, sizeof(*h));
+	h->cfg = *cfg;
+	h->onChange = onChange;
+	h->user = user;
+	h->lastTrafficUs = fp_time_us();
+}
+
+// 往返时间只取不读写FLASH、不等手指的快命令，其他命令的耗时主要是模块处理时间
+static bool is_quick(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case CMD_HANDSHAKE:
+	case CMD_READ_SYSPARA:
+	case CMD_VALID_TEMPLATE_NUM:
+	case CMD_READ_INDEX_TABLE:
+	case CMD_GET_CHIP_SN:
+	case CMD_CONTROL_BLN:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static bool rtt_degraded(const fp_health_t* h)
+{
+	if (h->rttBaseUs == 0)
+		return false;
+	uint64_t limit = (uint64_t)h->rttBaseUs * h->cfg.rttFactorPct / 100 + h->cfg.rttSlackUs;
+	return h->rttFastUs > limit;
+}
+
+static void set_state(fp_health_t* h, fp_health_state_t to)
+{
+	if (h->state == to)
+		return;
+	fp_health_state_t from = h->state;
+	h->state = to;
+	h->transitions++;
+	if (h->onChange != nullptr)
+		h->onChange(h->user, from, to);
+}
+
+void fp_health_observe(fp_health_t* h, uint8_t cmd, const fp_transact_result_t* result)
+{
+	h->observed++;
+	h->lastTrafficUs = fp_time_us();
+
+	if (result->timeout || result->linkError)
+	{
+		h->noResponse++;
+		h->okStreak = 0;
+		if (h->failStreak < 0xFF)
+			h->failStreak++;
+		set_state(h, h->failStreak >= h->cfg.downAfter ? FP_HEALTH_DOWN : h->state == FP_HEALTH_DOWN ? FP_HEALTH_DOWN : FP_HEALTH_DEGRADED);
+		return;
+	}
+
+	// 有应答（确认码非0也说明模块活着），坏帧按比例计入
+	bool bad = result->frame != FP_FRAME_OK;
+	h->failStreak = 0;
+	h->badFrameRate = (uint16_t)((h->badFrameRate * 15 + (bad ? 1000 : 0)) / 16);
+	if (bad)
+	{
+		h->badFrames++;
+		h->okStreak = 0;
+	}
+	else
+	{
+		if (h->okStreak < 0xFF)
+			h->okStreak++;
+		if (is_quick(cmd))
+		{
+			uint32_t rtt = result->latencyUs;
+			if (h->rttBaseUs == 0)
+			{
+				h->rttBaseUs = rtt;
+				h->rttFastUs = rtt;
+			}
+			else
+			{
+				h->rttFastUs = (uint32_t)(((uint64_t)h->rttFastUs * 3 + rtt) / 4);
+				h->rttBaseUs = (uint32_t)(((uint64_t)h->rttBaseUs * 63 + rtt) / 64);
+			}
+		}
+	}
+
+	bool degraded = h->badFrameRate > h->cfg.badFramePermille || rtt_degraded(h);
+	if (degraded)
+	{
+		set_state(h, FP_HEALTH_DEGRADED);
+	}
+	else if (h->state == FP_HEALTH_UNKNOWN || h->state == FP_HEALTH_HEALTHY || h->okStreak >= h->cfg.recoverAfter)
+	{
+		set_state(h, FP_HEALTH_HEALTHY);
+	}
+}
+
+uint32_t fp_health_due_ms(const fp_health_t* h)
+{
+	uint64_t idleUs = fp_time_us() - h->lastTrafficUs;
+	uint64_t limitUs = (uint64_t)h->cfg.idleMs * 1000;
+	return idleUs >= limitUs ? 0 : (uint32_t)((limitUs - idleUs + 999) / 1000);
+}
+
+bool fp_health_probe(fp_health_t* h, const fp_transport_t* tp, const uint8_t addr[4], uint32_t timeoutMs)
+{
+	if (fp_health_due_ms(h) != 0)
+		return false;
+	uint8_t resp[FP_MIN_FRAME_LEN + 16];
+	fp_transact_result_t result;
+	fp_transact(tp, addr, h->cfg.probeCmd, nullptr, 0, resp, sizeof(resp), timeoutMs, &result);
+	h->probes++;
+	fp_health_observe(h, h->cfg.probeCmd, &result);
+	return true;
+}
+
+const char* fp_health_state_name(fp_health_state_t state)
+{
+	return (unsigned)state < sizeof(kStateNames) / sizeof(kStateNames[0]) ? kStateNames[state] : "?";
+}
+
+void fp_health_print_stats(const fp_health_t* h)
+{
+	printf("链路状态：%s，旁听%u次，探测%u次，无应答%u次，坏帧%u次（滑动坏帧率%.1f%%），状态变化%u次\n",
+		fp_health_state_name(h->state), h->observed, h->probes, h->noResponse, h->badFrames,
+		h->badFrameRate / 10.0, h->transitions);
+	printf("  快命令往返：短期%.2fms，基线%.2fms\n", h->rttFastUs / 1000.0, h->rttBaseUs / 1000.0);
+}
@@ -0,0 +1,106 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 设备存活与链路质量监测
+// 链路上有正常命令往来时只旁听这些交互（不额外发帧）；空闲超过设定时间才发一条最便宜的探测命令
+// （默认握手，也可改为读模组基本参数）。按以下指标判定状态：
+//   连续无应答次数   超时或链路错误连续达到downAfter次判为断开
+//   坏帧率           应答帧校验失败（校验和、截断等）的滑动比例，超过上限判为降级
+//   往返时间趋势     快命令往返时间的短期均值相对长期基线明显变大时判为降级
+// 状态变化时回调通知；探测只在空闲时发出，不占用交互命令的时间
+
+// 链路状态
+typedef enum
+{
+	FP_HEALTH_UNKNOWN = 0, // 尚无样本
+	FP_HEALTH_HEALTHY,     // 正常
+	FP_HEALTH_DEGRADED,    // 有应答但出现坏帧、偶发超时或明显变慢
+	FP_HEALTH_DOWN         // 连续无应答
+} fp_health_state_t;
+
+/**
+ * @brief 状态变化回调
+ * @param user 回调参数
+ * @param from 原状态
+ * @param to 新状态
+ */
+typedef void (*fp_health_event_t)(void* user, fp_health_state_t from, fp_health_state_t to);
+
+typedef struct
+{
+	uint32_t idleMs;            // 空闲多久后发探测
+	uint8_t probeCmd;           // 探测命令（CMD_HANDSHAKE或CMD_READ_SYSPARA）
+	uint8_t downAfter;          // 连续无应答多少次判为断开
+	uint8_t recoverAfter;       // 降级/断开后连续正常多少次恢复
+	uint16_t badFramePermille;  // 坏帧率上限（千分比；单个坏帧使滑动比例升到约62，上限应高于它才能容忍偶发坏帧）
+	uint16_t rttFactorPct;      // 短期往返时间超过基线的百分比上限（300表示3倍）
+	uint32_t rttSlackUs;        // 往返时间比较的绝对余量，避免基线很小时误判
+} fp_health_config_t;
+
+typedef struct
+{
+	fp_health_config_t cfg;
+	fp_health_state_t state;     // 当前状态
+	fp_health_event_t onChange;  // 状态变化回调（可为nullptr）
+	void* user;                  // 回调参数
+	uint64_t lastTrafficUs;      // 最近一次交互（含探测）的时刻
+	uint8_t failStreak;          // 连续无应答次数
+	uint8_t okStreak;            // 连续正常次数
+	uint16_t badFrameRate;       // 坏帧率（千分比，按1/16滑动）
+	uint32_t rttFastUs;          // 快命令往返时间短期均值（1/4滑动）
+	uint32_t rttBaseUs;          // 快命令往返时间长期基线（1/64滑动）
+	// 统计
+	uint32_t observed;           // 旁听的交互数
+	uint32_t probes;             // 发出的探测数
+	uint32_t badFrames;          // 坏帧数
+	uint32_t noResponse;         // 无应答次数
+	uint32_t transitions;        // 状态变化次数
+} fp_health_t;
+
+/**
+ * @brief 默认配置（空闲5秒握手探测，连续3次无应答判断开，连续2次正常恢复，坏帧率10%，往返时间3倍）
+ */
+void fp_health_default_config(fp_health_config_t* cfg);
+
+/**
+ * @brief 初始化
+ * @param h 监测器
+ * @param cfg 配置
+ * @param onChange 状态变化回调（可为nullptr）
+ * @param user 回调参数
+ */
+void fp_health_init(fp_health_t* h, const fp_health_config_t* cfg, fp_health_event_t onChange, void* user);
+
+/**
+ * @brief 旁听一次命令交互（正常命令和探测都经过这里）
+ * @param h 监测器
+ * @param cmd 指令码
+ * @param result 交互结果
+ */
+void fp_health_observe(fp_health_t* h, uint8_t cmd, const fp_transact_result_t* result);
+
+/**
+ * @brief 距离下一次探测的时间
+ * @return 已到期返回0
+ */
+uint32_t fp_health_due_ms(const fp_health_t* h);
+
+/**
+ * @brief 链路空闲已到期时发一条探测命令（由持有链路的线程在空闲时调用）
+ * @param h 监测器
+ * @param tp 传输接口
+ * @param addr 设备地址
+ * @param timeoutMs 应答超时
+ * @return 发出了探测返回true（未到期返回false）
+ */
+bool fp_health_probe(fp_health_t* h, const fp_transport_t* tp, const uint8_t addr[4], uint32_t timeoutMs);
+
+/**
+ * @brief 状态名称
+ */
+const char* fp_health_state_name(fp_health_state_t state);
+
+/**
+ * @brief 打印监测统计
+ */
+void fp_health_print_stats(const fp_health_t* h);
@@ -0,0 +1,287 @@
+﻿#include <string.h>
+#include "fp_image.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define FP_IMAGE_AVX2 1
+#endif
+#if defined(__SSSE3__) || defined(__AVX__) || defined(__AVX2__)
+#include <tmmintrin.h>
+#define FP_IMAGE_SSSE3 1
+#endif
+
+// ========================== 调色板 ==========================
+void fp_image_palette_identity(fp_image_palette_t* palette)
+{
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		palette->level[i] = (uint8_t)(i * 17);
+	}
+}
+
+void fp_image_palette_stretch(fp_image_palette_t* palette, const uint32_t hist[16], uint16_t clipPermille)
+{
+	uint32_t total = 0;
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		total += hist[i];
+	}
+	uint32_t clip = (uint32_t)((uint64_t)total * clipPermille / 1000);
+
+	// 从两端分别找到裁剪后的最暗/最亮灰度级
+	uint8_t lo = 0;
+	uint32_t acc = hist[0];
+	while (lo < 15 && acc <= clip)
+	{
+		acc += hist[++lo];
+	}
+	uint8_t hi = 15;
+	acc = hist[15];
+	while (hi > 0 && acc <= clip)
+	{
+		acc += hist[--hi];
+	}
+
+	if (total == 0 || hi <= lo)
+	{
+		fp_image_palette_identity(palette); // 图像为单一灰度，无法拉伸
+		return;
+	}
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		if (i <= lo)
+			palette->level[i] = 0x00;
+		else if (i >= hi)
+			palette->level[i] = 0xFF;
+		else
+			palette->level[i] = (uint8_t)((i - lo) * 255 / (hi - lo));
+	}
+}
+
+// ========================== 解包内核 ==========================
+// 标量实现：每字节两次查表，MCU上也足够快
+static inline void unpack4_scalar(const uint8_t* src, size_t srcLen, uint8_t* dst, const uint8_t level[16])
+{
+	for (size_t i = 0; i < srcLen; i++)
+	{
+		uint8_t byte = src[i];
+		dst[2 * i] = level[byte >> 4];       // 高4位为前一个像素
+		dst[2 * i + 1] = level[byte & 0x0F]; // 低4位为后一个像素
+	}
+}
+
+#if FP_IMAGE_SSSE3
+// 16字节打包数据 -> 32字节像素：拆高低半字节后用pshufb查调色板，再交织
+static inline void unpack4_block16(const uint8_t* src, uint8_t* dst, __m128i lut, __m128i mask)
+{
+	__m128i packed = _mm_loadu_si128((const __m128i*)src);
+	__m128i hi = _mm_shuffle_epi8(lut, _mm_and_si128(_mm_srli_epi16(packed, 4), mask));
+	__m128i lo = _mm_shuffle_epi8(lut, _mm_and_si128(packed, mask));
+	_mm_storeu_si128((__m128i*)dst, _mm_unpacklo_epi8(hi, lo));
+	_mm_storeu_si128((__m128i*)(dst + 16), _mm_unpackhi_epi8(hi, lo));
+}
+#endif
+
+#if FP_IMAGE_AVX2
+// 32字节打包数据 -> 64字节像素（unpack按128位通道交织，需要再跨通道重排）
+static inline void unpack4_block32(const uint8_t* src, uint8_t* dst, __m256i lut, __m256i mask)
+{
+	__m256i packed = _mm256_loadu_si256((const __m256i*)src);
+	__m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(packed, 4), mask));
+	__m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(packed, mask));
+	__m256i r0 = _mm256_unpacklo_epi8(hi, lo); // 字节0-7 | 16-23
+	__m256i r1 = _mm256_unpackhi_epi8(hi, lo); // 字节8-15 | 24-31
+	_mm256_storeu_si256((__m256i*)dst, _mm256_permute2x128_si256(r0, r1, 0x20));
+	_mm256_storeu_si256((__m256i*)(dst + 32), _mm256_permute2x128_si256(r0, r1, 0x31));
+}
+#endif
+
+static const uint8_t* palette_levels(const fp_image_palette_t* palette, fp_image_palette_t* storage)
+{
+	if (palette != nullptr)
+	{
+		return palette->level;
+	}
+	fp_image_palette_identity(storage);
+	return storage->level;
+}
+
+// ========================== 整幅转换 ==========================
+void fp_image_unpack4(const uint8_t* src, size_t srcLen, uint8_t* dst, const fp_image_palette_t* palette)
+{
+	fp_image_palette_t identity;
+	const uint8_t* level = palette_levels(palette, &identity);
+	size_t i = 0;
+
+#if FP_IMAGE_AVX2
+	__m256i lut32 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)level));
+	__m256i mask32 = _mm256_set1_epi8(0x0F);
+	for (; i + 32 <= srcLen; i += 32)
+	{
+		unpack4_block32(src + i, dst + 2 * i, lut32, mask32);
+	}
+#endif
+#if FP_IMAGE_SSSE3
+	__m128i lut16 = _mm_loadu_si128((const __m128i*)level);
+	__m128i mask16 = _mm_set1_epi8(0x0F);
+	for (; i + 16 <= srcLen; i += 16)
+	{
+		unpack4_block16(src + i, dst + 2 * i, lut16, mask16);
+	}
+#endif
+	unpack4_scalar(src + i, srcLen - i, dst + 2 * i, level);
+}
+
+void fp_image_unpack4_inplace(uint8_t* buf, size_t srcLen, const fp_image_palette_t* palette)
+{
+	fp_image_palette_t identity;
+	const uint8_t* level = palette_levels(palette, &identity);
+
+	// 从尾部向前处理：第i字节写到2i、2i+1，始终不覆盖尚未读取的[0, i)区间
+#if FP_IMAGE_AVX2
+	const size_t block = 32;
+	size_t blocks = srcLen / block;
+#elif FP_IMAGE_SSSE3
+	const size_t block = 16;
+	size_t blocks = srcLen / block;
+#else
+	const size_t block = 1;
+	size_t blocks = 0; // 无SIMD时全部走标量路径
+#endif
+	for (size_t i = srcLen; i > blocks * block; i--)
+	{
+		uint8_t byte = buf[i - 1];
+		buf[2 * (i - 1) + 1] = level[byte & 0x0F];
+		buf[2 * (i - 1)] = level[byte >> 4];
+	}
+
+#if FP_IMAGE_AVX2
+	__m256i lut32 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)level));
+	__m256i mask32 = _mm256_set1_epi8(0x0F);
+	for (size_t b = blocks; b > 0; b--)
+	{
+		size_t off = (b - 1) * block;
+		unpack4_block32(buf + off, buf + 2 * off, lut32, mask32); // 先整块读入寄存器再写回
+	}
+#elif FP_IMAGE_SSSE3
+	__m128i lut16 = _mm_loadu_si128((const __m128i*)level);
+	__m128i mask16 = _mm_set1_epi8(0x0F);
+	for (size_t b = blocks; b > 0; b--)
+	{
+		size_t off = (b - 1) * block;
+		unpack4_block16(buf + off, buf + 2 * off, lut16, mask16);
+	}
+#endif
+}
+
+void fp_image_histogram4(const uint8_t* src, size_t srcLen, uint32_t hist[16])
+{
+	// 4路独立计数，避免相邻像素灰度相同时的写后读依赖
+	uint32_t part[4][16];
+	memset(part, 0, sizeof(part));
+	size_t i = 0;
+	for (; i + 2 <= srcLen; i += 2)
+	{
+		part[0][src[i] >> 4]++;
+		part[1][src[i] & 0x0F]++;
+		part[2][src[i + 1] >> 4]++;
+		part[3][src[i + 1] & 0x0F]++;
+	}
+	for (; i < srcLen; i++)
+	{
+		part[0][src[i] >> 4]++;
+		part[1][src[i] & 0x0F]++;
+	}
+	for (uint8_t v = 0; v < 16; v++)
+	{
+		hist[v] += part[0][v] + part[1][v] + part[2][v] + part[3][v];
+	}
+}
+
+void fp_image_remap4(uint8_t* img, size_t pixels, const fp_image_palette_t* palette)
+{
+	size_t i = 0;
+	// v*17右移4位即还原出4位像素值，可直接作为调色板下标
+#if FP_IMAGE_AVX2
+	__m256i lut32 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)palette->level));
+	__m256i mask32 = _mm256_set1_epi8(0x0F);
+	for (; i + 32 <= pixels; i += 32)
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i*)(img + i));
+		v = _mm256_shuffle_epi8(lut32, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask32));
+		_mm256_storeu_si256((__m256i*)(img + i), v);
+	}
+#endif
+#if FP_IMAGE_SSSE3
+	__m128i lut16 = _mm_loadu_si128((const __m128i*)palette->level);
+	__m128i mask16 = _mm_set1_epi8(0x0F);
+	for (; i + 16 <= pixels; i += 16)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(img + i));
+		v = _mm_shuffle_epi8(lut16, _mm_and_si128(_mm_srli_epi16(v, 4), mask16));
+		_mm_storeu_si128((__m128i*)(img + i), v);
+	}
+#endif
+	for (; i < pixels; i++)
+	{
+		img[i] = palette->level[img[i] >> 4];
+	}
+}
+
+// ========================== 流式转换 ==========================
+void fp_image_stream_begin(fp_image_stream_t* stream, uint8_t* dst, size_t capacity, bool stretch, uint16_t clipPermille)
+{
+	memset(stream, 0, sizeof(*stream));
+	stream->dst = dst;
+	stream->capacity = capacity;
+	stream->stretch = stretch;
+	stream->clipPermille = clipPermille;
+	fp_image_palette_identity(&stream->palette);
+}
+
+esp_err_t fp_image_stream_feed(fp_image_stream_t* stream, const uint8_t* data, size_t len)
+{
+	if (stream->pixels + len * 2 > stream->capacity)
+	{
+		return ESP_FAIL;
+	}
+	fp_image_unpack4(data, len, stream->dst + stream->pixels, &stream->palette);
+	if (stream->stretch)
+	{
+		fp_image_histogram4(data, len, stream->hist); // 数据刚解包仍在缓存中，顺带统计
+	}
+	stream->pixels += len * 2;
+	return ESP_OK;
+}
+
+esp_err_t fp_image_stream_feed_packet(fp_image_stream_t* stream, const uint8_t* frame, uint16_t frameLen, const uint8_t addr[4])
+{
+	if (stream->done || fp_check_frame(frame, frameLen, addr) != FP_FRAME_OK)
+	{
+		return ESP_FAIL;
+	}
+	uint8_t pid = frame[FP_PID_INDEX];
+	if (pid != PACKET_DATA_MORE && pid != PACKET_DATA_LAST)
+	{
+		return ESP_FAIL;
+	}
+	uint16_t payloadLen = 0;
+	const uint8_t* payload = fp_frame_payload(frame, &payloadLen);
+	if (fp_image_stream_feed(stream, payload, payloadLen) != ESP_OK)
+	{
+		return ESP_FAIL;
+	}
+	stream->done = (pid == PACKET_DATA_LAST);
+	return ESP_OK;
+}
+
+size_t fp_image_stream_finish(fp_image_stream_t* stream)
+{
+	if (stream->stretch && stream->pixels > 0)
+	{
+		fp_image_palette_t stretched;
+		fp_image_palette_stretch(&stretched, stream->hist, stream->clipPermille);
+		fp_image_remap4(stream->dst, stream->pixels, &stretched);
+	}
+	return stream->pixels;
+}
@@ -0,0 +1,111 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 4位灰度图像转换（UpImage上传的图像每字节两个像素，高4位在前）
+// x86平台按编译选项自动选择AVX2/SSSE3内核，其他平台（MCU）使用查表标量实现
+
+// ========================== 调色板 ==========================
+// 4位像素只有16个灰度级，拉伸、反色等映射都表示为16项调色板，
+// 解包时一次查表完成，不需要再对8位图像做第二遍处理
+typedef struct
+{
+	uint8_t level[16]; // 4位像素值 -> 8位灰度
+} fp_image_palette_t;
+
+/**
+ * @brief 生成线性调色板（0x0 -> 0x00，0xF -> 0xFF，即v*17）
+ * @param palette 输出调色板
+ */
+void fp_image_palette_identity(fp_image_palette_t* palette);
+
+/**
+ * @brief 根据16级直方图生成对比度拉伸调色板
+ * @param palette 输出调色板
+ * @param hist 4位像素直方图（16项）
+ * @param clipPermille 两端各裁剪的像素比例（千分比，0表示按最小/最大灰度拉伸）
+ */
+void fp_image_palette_stretch(fp_image_palette_t* palette, const uint32_t hist[16], uint16_t clipPermille);
+
+// ========================== 整幅转换 ==========================
+/**
+ * @brief 4位打包图像解包为8位灰度
+ * @param src 打包数据（每字节两个像素，高4位在前）
+ * @param srcLen 打包数据字节数
+ * @param dst 输出缓冲区（至少srcLen*2字节，不能与src重叠，原地转换请用fp_image_unpack4_inplace）
+ * @param palette 调色板，传nullptr使用线性映射
+ */
+void fp_image_unpack4(const uint8_t* src, size_t srcLen, uint8_t* dst, const fp_image_palette_t* palette);
+
+/**
+ * @brief 原地解包：缓冲区前srcLen字节为打包数据，解包后占满srcLen*2字节
+ * @param buf 缓冲区（容量至少srcLen*2字节）
+ * @param srcLen 打包数据字节数
+ * @param palette 调色板，传nullptr使用线性映射
+ */
+void fp_image_unpack4_inplace(uint8_t* buf, size_t srcLen, const fp_image_palette_t* palette);
+
+/**
+ * @brief 统计4位打包图像的16级直方图（累加到hist）
+ * @param src 打包数据
+ * @param srcLen 打包数据字节数
+ * @param hist 直方图（16项，调用者负责清零）
+ */
+void fp_image_histogram4(const uint8_t* src, size_t srcLen, uint32_t hist[16]);
+
+/**
+ * @brief 对已线性解包的8位图像重新映射（用于解包后再做对比度拉伸）
+ * @param img 8位图像（像素值必须为v*17形式，即fp_image_unpack4线性解包的结果）
+ * @param pixels 像素数
+ * @param palette 新调色板
+ */
+void fp_image_remap4(uint8_t* img, size_t pixels, const fp_image_palette_t* palette);
+
+// ========================== 流式转换 ==========================
+// UpImage传输期间每收到一个数据包就解包一次，最后一包到达时图像已转换完成
+typedef struct
+{
+	uint8_t* dst;                 // 8位图像输出缓冲区
+	size_t capacity;              // 输出缓冲区容量（像素）
+	size_t pixels;                // 已输出像素数
+	uint32_t hist[16];            // 流式累计的直方图
+	fp_image_palette_t palette;   // 解包时使用的调色板
+	bool stretch;                 // 完成时是否做对比度拉伸
+	uint16_t clipPermille;        // 拉伸裁剪比例
+	bool done;                    // 已收到结束包
+} fp_image_stream_t;
+
+/**
+ * @brief 初始化流式转换
+ * @param stream 流上下文
+ * @param dst 8位图像输出缓冲区
+ * @param capacity 输出缓冲区容量（像素）
+ * @param stretch 完成时是否按直方图做对比度拉伸
+ * @param clipPermille 拉伸时两端裁剪的千分比
+ */
+void fp_image_stream_begin(fp_image_stream_t* stream, uint8_t* dst, size_t capacity, bool stretch, uint16_t clipPermille);
+
+/**
+ * @brief 输入一段打包图像数据（已去掉帧头和校验和）
+ * @param stream 流上下文
+ * @param data 打包数据
+ * @param len 数据长度
+ * @return 输出缓冲区足够返回ESP_OK，溢出返回ESP_FAIL
+ */
+esp_err_t fp_image_stream_feed(fp_image_stream_t* stream, const uint8_t* data, size_t len);
+
+/**
+ * @brief 输入一个完整的UpImage数据包（校验帧头、地址、校验和后解包）
+ * @param stream 流上下文
+ * @param frame 数据包
+ * @param frameLen 数据包长度
+ * @param addr 设备地址
+ * @return 数据包有效且解包成功返回ESP_OK
+ */
+esp_err_t fp_image_stream_feed_packet(fp_image_stream_t* stream, const uint8_t* frame, uint16_t frameLen, const uint8_t addr[4]);
+
+/**
+ * @brief 结束流式转换（需要时执行对比度拉伸）
+ * @param stream 流上下文
+ * @return 已输出像素数
+ */
+size_t fp_image_stream_finish(fp_image_stream_t* stream);
@@ -0,0 +1,147 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_index.h"
+#include "fp_views.h"
+
+static uint16_t page_count(const fp_index_t* idx)
+{
+	return (uint16_t)((idx->capacity + FP_INDEX_PAGE_SLOTS - 1) / FP_INDEX_PAGE_SLOTS);
+}
+
+void fp_index_init(fp_index_t* idx, const uint8_t addr[4], uint16_t capacity, uint8_t depth)
+{
+	memset(idx, 0, sizeof(*idx));
+	memcpy(idx->addr, addr, 4);
+	idx->capacity = capacity > FP_INDEX_MAX_PAGES * FP_INDEX_PAGE_SLOTS ? FP_INDEX_MAX_PAGES * FP_INDEX_PAGE_SLOTS : capacity;
+	idx->depth = depth < 1 ? 1 : depth;
+}
+
+bool fp_index_occupied(const fp_index_t* idx, uint16_t id)
+{
+	return id < idx->capacity && (idx->bitmap[id >> 3] & (1 << (id & 7)));
+}
+
+void fp_index_set(fp_index_t* idx, uint16_t id, bool occupied)
+{
+	if (id >= idx->capacity || fp_index_occupied(idx, id) == occupied)
+		return;
+	if (occupied)
+	{
+		idx->bitmap[id >> 3] |= (uint8_t)(1 << (id & 7));
+		idx->count++;
+	}
+	else
+	{
+		idx->bitmap[id >> 3] &= (uint8_t)~(1 << (id & 7));
+		idx->count--;
+	}
+}
+
+uint16_t fp_index_first_free(const fp_index_t* idx)
+{
+	for (uint16_t i = 0; i < (idx->capacity + 7) / 8; i++)
+	{
+		if (idx->bitmap[i] == 0xFF)
+			continue;
+		for (uint8_t b = 0; b < 8; b++)
+		{
+			uint16_t id = (uint16_t)(i * 8 + b);
+			if (id < idx->capacity && !(idx->bitmap[i] & (1 << b)))
+				return id;
+		}
+	}
+	return 0xFFFF;
+}
+
+// 超时后线路上可能还有迟到的应答，读到安静为止再重发
+static void drain(const fp_transport_t* tp)
+{
+	uint8_t buf[64];
+	while (tp->read(tp->ctx, buf, sizeof(buf), 20) > 0)
+	{
+	}
+}
+
+esp_err_t fp_index_resync(fp_index_t* idx, const fp_transport_t* tp, uint32_t timeoutMs)
+{
+	uint16_t pages = page_count(idx);
+	uint8_t frames[FP_INDEX_MAX_PAGES][FP_MIN_FRAME_LEN + 1];
+	uint16_t frameLen = 0;
+	for (uint16_t p = 0; p < pages; p++)
+	{
+		uint8_t payload[2] = { CMD_READ_INDEX_TABLE, (uint8_t)p };
+		frameLen = fp_build_frame(idx->addr, PACKET_CMD, payload, sizeof(payload), frames[p], sizeof(frames[p]));
+	}
+
+	idx->valid = false;
+	idx->resyncs++;
+	idx->lastPageUs = 0;
+	uint64_t start = fp_time_us();
+	uint64_t sentUs[FP_INDEX_MAX_PAGES] = { 0 };
+	uint16_t next = 0;    // 下一个要发送的页
+	uint16_t done = 0;    // 下一个应到达的页（应答按发送顺序到达）
+	uint16_t certain = 0; // 此前的页已确认：当时发出的请求都收到了应答，应答与页一一对应
+	uint8_t resp[FP_MIN_FRAME_LEN + FP_INDEX_PAGE_BYTES + 4];
+	while (done < pages)
+	{
+		if (next == done)
+			certain = done;
+		while (next < pages && next - done < idx->depth)
+		{
+			if (fp_transport_send(tp, frames[next], frameLen) != ESP_OK)
+				return ESP_FAIL;
+			sentUs[next] = fp_time_us();
+			idx->pagesRequested++;
+			next++;
+		}
+
+		uint16_t len = fp_transport_recv_frame(tp, resp, sizeof(resp), timeoutMs);
+		if (len == 0 || fp_check_frame(resp, len, idx->addr) != FP_FRAME_OK)
+		{
+			// 模块丢弃了请求或应答损坏。应答里没有页号，被丢的若是前面的请求，后面的应答已被错记到前面的页上，
+			// 所以从最后一个确认点起全部作废：减小深度后从那里重读；单独发出的一页也失败时放弃
+			idx->pageTimeouts++;
+			if (next - certain == 1)
+				return ESP_FAIL;
+			idx->depth = (uint8_t)(idx->depth > 1 ? idx->depth / 2 : 1);
+			drain(tp);
+			done = certain;
+			next = certain;
+			continue;
+		}
+		fp_index_page_view page;
+		if (!fp_view_bind(&page, resp, len) || page.confirm() != 0x00)
+			return ESP_FAIL;
+
+		uint32_t pageUs = (uint32_t)(fp_time_us() - sentUs[done]);
+		if (idx->lastPageUs == 0 || pageUs < idx->lastPageUs)
+			idx->lastPageUs = pageUs;
+		memcpy(idx->bitmap + done * FP_INDEX_PAGE_BYTES, page.bitmap(), FP_INDEX_PAGE_BYTES);
+		done++;
+	}
+	idx->lastResyncUs = (uint32_t)(fp_time_us() - start);
+
+	// 清掉容量以外的位并重新计数
+	uint16_t bytes = (uint16_t)((idx->capacity + 7) / 8);
+	if (idx->capacity & 7)
+		idx->bitmap[bytes - 1] &= (uint8_t)((1 << (idx->capacity & 7)) - 1);
+	memset(idx->bitmap + bytes, 0, sizeof(idx->bitmap) - bytes);
+	idx->count = 0;
+	for (uint16_t i = 0; i < bytes; i++)
+	{
+		for (uint8_t v = idx->bitmap[i]; v; v &= (uint8_t)(v - 1))
+			idx->count++;
+	}
+	idx->valid = true;
+	return ESP_OK;
+}
+
+void fp_index_print_stats(const fp_index_t* idx)
+{
+	printf("索引表（地址%02X%02X%02X%02X）：容量%u，%u页，已注册%u，%s\n",
+		idx->addr[0], idx->addr[1], idx->addr[2], idx->addr[3],
+		idx->capacity, page_count(idx), idx->count, idx->valid ? "已同步" : "未同步");
+	printf("  最近同步%.1fms（单页往返%.1fms），流水线深度%u，同步%u次，发出页请求%u，页超时%u次\n",
+		idx->lastResyncUs / 1000.0, idx->lastPageUs / 1000.0, idx->depth,
+		idx->resyncs, idx->pagesRequested, idx->pageTimeouts);
+}
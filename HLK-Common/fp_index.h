@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 指纹库占用位图与整库同步
+// 读索引表(0x1F)每次只返回一页（256个ID，32字节位图），逐页一问一答时同步时间随页数线性增长；
+// 这里把各页请求连续发出（流水线深度可配置），应答按发送顺序到达，收到一页解析一页；
+// 模块接收缓冲装不下时会丢掉请求，表现为等应答超时；应答不带页号，丢的若是中间的请求，
+// 之后到达的应答都会记错页，因此超时后从最后一个确认点（流水线排空、发出的请求都已应答）起全部重读，
+// 同时流水线深度减半，最终退化为逐页一问一答，保证在任何型号上都能完成同步
+
+#define FP_INDEX_PAGE_SLOTS 256                                 // 每页ID数
+#define FP_INDEX_PAGE_BYTES (FP_INDEX_PAGE_SLOTS / 8)           // 每页位图字节数
+#define FP_INDEX_MAX_PAGES 16                                   // 最大页数（4096个ID）
+#define FP_INDEX_MAX_BYTES (FP_INDEX_MAX_PAGES * FP_INDEX_PAGE_BYTES)
+#define FP_INDEX_DEFAULT_DEPTH 4                                // 默认流水线深度
+
+typedef struct
+{
+	uint8_t addr[4];                    // 设备地址
+	uint16_t capacity;                  // 指纹库容量
+	uint8_t bitmap[FP_INDEX_MAX_BYTES]; // 占用位图（bit=1表示已注册）
+	uint16_t count;                     // 已注册数
+	uint8_t depth;                      // 当前流水线深度（超时后减半并保留，下次同步沿用）
+	bool valid;                         // 位图是否与模块一致
+	// 统计
+	uint32_t resyncs;                   // 同步次数
+	uint32_t lastResyncUs;              // 最近一次同步耗时（微秒）
+	uint32_t lastPageUs;                // 最近一次同步中单页应答的最小耗时（≈一次往返）
+	uint32_t pageTimeouts;              // 页应答超时次数（模块丢弃了流水线中的请求）
+	uint32_t pagesRequested;            // 累计发出的页请求数（含重发）
+} fp_index_t;
+
+/**
+ * @brief 初始化位图
+ * @param idx 位图
+ * @param addr 设备地址
+ * @param capacity 指纹库容量（超过FP_INDEX_MAX_PAGES页的部分忽略）
+ * @param depth 初始流水线深度（1表示逐页一问一答）
+ */
+void fp_index_init(fp_index_t* idx, const uint8_t addr[4], uint16_t capacity, uint8_t depth);
+
+/**
+ * @brief 从模块读取整个索引表
+ * @param idx 位图
+ * @param tp 传输接口（同步期间由调用者保证独占）
+ * @param timeoutMs 单页应答超时
+ * @return 所有页读取成功返回ESP_OK，失败时valid为false
+ */
+esp_err_t fp_index_resync(fp_index_t* idx, const fp_transport_t* tp, uint32_t timeoutMs);
+
+/**
+ * @brief 查询/更新某个ID的占用状态（注册、删除成功后由调用者同步更新）
+ */
+bool fp_index_occupied(const fp_index_t* idx, uint16_t id);
+void fp_index_set(fp_index_t* idx, uint16_t id, bool occupied);
+
+/**
+ * @brief 最小的空闲ID
+ * @return 指纹库满返回0xFFFF
+ */
+uint16_t fp_index_first_free(const fp_index_t* idx);
+
+/**
+ * @brief 打印同步统计
+ */
+void fp_index_print_stats(const fp_index_t* idx);
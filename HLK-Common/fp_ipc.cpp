@@ -0,0 +1,156 @@
+﻿#include <string.h>
+#include "fp_ipc.h"
+#include "fp_transport.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+uint16_t fp_ipc_build(uint8_t type, uint8_t device, uint32_t reqId,
+	const uint8_t* body, uint16_t bodyLen, uint8_t* out, uint16_t outCap)
+{
+	if (bodyLen > FP_IPC_MAX_BODY || FP_IPC_HEADER_LEN + bodyLen > outCap)
+	{
+		return 0;
+	}
+	out[0] = type;
+	out[1] = device;
+	out[2] = (uint8_t)(reqId >> 24);
+	out[3] = (uint8_t)(reqId >> 16);
+	out[4] = (uint8_t)(reqId >> 8);
+	out[5] = (uint8_t)reqId;
+	out[6] = (uint8_t)(bodyLen >> 8);
+	out[7] = (uint8_t)bodyLen;
+	if (bodyLen > 0)
+		memcpy(out + FP_IPC_HEADER_LEN, body, bodyLen);
+	return FP_IPC_HEADER_LEN + bodyLen;
+}
+
+int fp_ipc_parse(const uint8_t* buf, size_t len, fp_ipc_msg_t* msg)
+{
+	if (len < FP_IPC_HEADER_LEN)
+	{
+		return 0;
+	}
+	uint16_t bodyLen = fp_be16(buf + 6);
+	if (bodyLen > FP_IPC_MAX_BODY)
+	{
+		return -1;
+	}
+	if (len < (size_t)FP_IPC_HEADER_LEN + bodyLen)
+	{
+		return 0;
+	}
+	msg->type = buf[0];
+	msg->device = buf[1];
+	msg->reqId = ((uint32_t)buf[2] << 24) | ((uint32_t)buf[3] << 16) | ((uint32_t)buf[4] << 8) | buf[5];
+	msg->bodyLen = bodyLen;
+	msg->body = buf + FP_IPC_HEADER_LEN;
+	return FP_IPC_HEADER_LEN + bodyLen;
+}
+
+#ifndef _WIN32
+// ========================== 客户端 ==========================
+esp_err_t fp_ipc_connect(fp_ipc_client_t* c, const char* path)
+{
+	memset(c, 0, sizeof(*c));
+	c->nextReqId = 1;
+	c->fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (c->fd < 0)
+	{
+		return ESP_FAIL;
+	}
+	struct sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strncpy(sa.sun_path, path != nullptr ? path : FP_IPC_DEFAULT_PATH, sizeof(sa.sun_path) - 1);
+	if (::connect(c->fd, (struct sockaddr*)&sa, sizeof(sa)) != 0)
+	{
+		::close(c->fd);
+		c->fd = -1;
+		return ESP_FAIL;
+	}
+	return ESP_OK;
+}
+
+void fp_ipc_close(fp_ipc_client_t* c)
+{
+	if (c->fd >= 0)
+		::close(c->fd);
+	c->fd = -1;
+}
+
+uint32_t fp_ipc_request(fp_ipc_client_t* c, uint8_t type, uint8_t device, const uint8_t* body, uint16_t bodyLen)
+{
+	uint8_t msg[FP_IPC_MAX_MSG];
+	uint32_t reqId = c->nextReqId++;
+	if (c->nextReqId == 0)
+		c->nextReqId = 1; // 0留给事件
+	uint16_t len = fp_ipc_build(type, device, reqId, body, bodyLen, msg, sizeof(msg));
+	if (len == 0 || c->fd < 0)
+	{
+		return 0;
+	}
+	for (uint16_t sent = 0; sent < len;)
+	{
+		ssize_t n = ::send(c->fd, msg + sent, len - sent, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return 0;
+		sent += (uint16_t)n;
+	}
+	return reqId;
+}
+
+uint32_t fp_ipc_command(fp_ipc_client_t* c, uint8_t device, uint8_t cmd,
+	const uint8_t* params, uint8_t paramLen, uint16_t timeoutMs)
+{
+	uint8_t body[3 + 255];
+	body[0] = (uint8_t)(timeoutMs >> 8);
+	body[1] = (uint8_t)timeoutMs;
+	body[2] = cmd;
+	if (paramLen > 0)
+		memcpy(body + 3, params, paramLen);
+	return fp_ipc_request(c, FP_IPC_COMMAND, device, body, (uint16_t)(3 + paramLen));
+}
+
+esp_err_t fp_ipc_recv(fp_ipc_client_t* c, fp_ipc_msg_t* msg, uint32_t timeoutMs)
+{
+	if (c->consumed > 0)
+	{
+		memmove(c->buf, c->buf + c->consumed, c->len - c->consumed);
+		c->len -= c->consumed;
+		c->consumed = 0;
+	}
+	uint64_t deadline = fp_time_us() + (uint64_t)timeoutMs * 1000;
+	while (true)
+	{
+		int n = fp_ipc_parse(c->buf, c->len, msg);
+		if (n < 0)
+			return ESP_FAIL;
+		if (n > 0)
+		{
+			c->consumed = (uint16_t)n;
+			return ESP_OK;
+		}
+		uint64_t now = fp_time_us();
+		if (c->fd < 0 || now >= deadline)
+			return ESP_FAIL;
+		struct pollfd pfd = { c->fd, POLLIN, 0 };
+		int ready = ::poll(&pfd, 1, (int)((deadline - now + 999) / 1000));
+		if (ready < 0 && errno != EINTR)
+			return ESP_FAIL;
+		if (ready <= 0)
+			continue;
+		ssize_t got = ::recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+		if (got <= 0)
+			return ESP_FAIL; // 守护进程关闭了连接
+		c->len += (uint16_t)got;
+	}
+}
+#endif
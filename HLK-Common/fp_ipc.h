@@ -0,0 +1,130 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 本机守护进程协议：守护进程独占所有串口，门禁控制、审计日志、管理工具等多个进程
+// 经Unix域套接字共用模块，不再各自打开/dev/ttyUSB*（交接一次要复位几百毫秒）
+//
+// 消息 = 消息头(8字节) + 消息体，多字节字段大端（与模块协议一致）：
+//   类型(1) 设备号(1) 请求号(4) 消息体长度(2)
+// 同一连接上可以同时有多个请求在执行，应答按完成顺序返回、靠请求号对应；
+// 不同设备的命令并行执行，同一设备的命令由守护进程中该设备的调度器排队
+//
+// 请求                        消息体                          应答消息体
+//   FP_IPC_COMMAND  0x01     超时ms(2) 指令码(1) 参数(n)      状态(1) 标志(1) 排队us(4) 执行us(4) 应答数据区(确认码起)
+//   FP_IPC_LIST     0x02     空                              设备数(1) 每台：地址(4) 链路状态(1) 名称长度(1) 名称
+//   FP_IPC_SUBSCRIBE 0x03    事件掩码(1)                      状态(1)
+// 应答类型为请求类型 | 0x80；事件的请求号为0，只发给订阅了对应事件的连接：
+//   FP_IPC_EVENT_IDENTIFY 0xC1  确认码(1) ID(2) 得分(2)        任一连接发出的识别/搜索命令有结果时
+//   FP_IPC_EVENT_HEALTH   0xC2  原状态(1) 新状态(1)            设备链路状态变化时
+
+#define FP_IPC_HEADER_LEN 8                                       // 消息头长度
+#define FP_IPC_MAX_BODY (10 + FP_MAX_FRAME_LEN)                   // 消息体上限
+#define FP_IPC_MAX_MSG (FP_IPC_HEADER_LEN + FP_IPC_MAX_BODY)      // 消息上限
+#define FP_IPC_DEFAULT_PATH "/run/fp/daemon.sock"                 // 默认套接字路径（所在目录只允许守护进程用户写）
+#define FP_IPC_REPLY 0x80                                         // 应答类型标志
+
+// 消息类型
+#define FP_IPC_COMMAND 0x01          // 执行命令
+#define FP_IPC_LIST 0x02             // 列出设备
+#define FP_IPC_SUBSCRIBE 0x03        // 订阅事件（掩码为0取消订阅）
+#define FP_IPC_EVENT_IDENTIFY 0xC1   // 识别结果事件
+#define FP_IPC_EVENT_HEALTH 0xC2     // 链路状态变化事件
+
+// 事件掩码
+#define FP_IPC_SUB_IDENTIFY 0x01     // 识别结果
+#define FP_IPC_SUB_HEALTH 0x02       // 链路状态
+
+// 应答状态
+#define FP_IPC_OK 0x00               // 已执行（模块的确认码在应答数据区中）
+#define FP_IPC_NO_DEVICE 0x01        // 设备号不存在
+#define FP_IPC_BAD_REQUEST 0x02      // 消息体格式错误或参数过长
+#define FP_IPC_BUSY 0x03             // 设备队列满或本连接执行中的请求过多
+#define FP_IPC_UNSUPPORTED 0x04      // 不支持的消息类型或指令（设置芯片地址：守护进程按启动时的地址寻址，不能在运行中改）
+#define FP_IPC_DENIED 0x05           // 对端用户无权执行该指令（注册/存模板/下载特征或图像/删除/清空/写寄存器/设置口令只接受root或守护进程同一用户）
+
+// 命令应答标志
+#define FP_IPC_FLAG_TIMEOUT 0x01     // 模块无应答
+#define FP_IPC_FLAG_PREEMPTED 0x02   // 被取消指令抢占
+#define FP_IPC_FLAG_POSTED 0x04      // LED控制已提交到LED通道（只保留最新一条，无模块应答）
+#define FP_IPC_FLAG_LINK_ERROR 0x08  // 串口读写错误
+#define FP_IPC_FLAG_NOT_RUN 0x10     // 守护进程退出时仍在排队，未发给模块
+
+#define FP_IPC_COMMAND_REPLY_FIXED 10 // 命令应答消息体中应答数据区之前的长度
+
+typedef struct
+{
+	uint8_t type;          // 消息类型
+	uint8_t device;        // 设备号
+	uint32_t reqId;        // 请求号（事件为0）
+	uint16_t bodyLen;      // 消息体长度
+	const uint8_t* body;   // 消息体（指向输入缓冲区）
+} fp_ipc_msg_t;
+
+/**
+ * @brief 组一条消息
+ * @return 消息长度，缓冲区不足或消息体过长返回0
+ */
+uint16_t fp_ipc_build(uint8_t type, uint8_t device, uint32_t reqId,
+	const uint8_t* body, uint16_t bodyLen, uint8_t* out, uint16_t outCap);
+
+/**
+ * @brief 从缓冲区开头解析一条消息
+ * @param buf 接收缓冲区
+ * @param len 已收到的字节数
+ * @param msg 输出消息（消息体指向buf）
+ * @return 消息总长度；0表示还没收齐；<0表示消息体长度非法（连接应关闭）
+ */
+int fp_ipc_parse(const uint8_t* buf, size_t len, fp_ipc_msg_t* msg);
+
+#ifndef _WIN32
+// ========================== 客户端 ==========================
+typedef struct
+{
+	int fd;                            // 套接字
+	uint8_t buf[FP_IPC_MAX_MSG * 2];   // 接收缓冲区
+	uint16_t len;                      // 已收到的字节数
+	uint16_t consumed;                 // 上一条已交付消息的长度（下次接收前移出缓冲区）
+	uint32_t nextReqId;                // 下一个请求号
+} fp_ipc_client_t;
+
+/**
+ * @brief 连接守护进程
+ * @param c 客户端
+ * @param path 套接字路径（nullptr为FP_IPC_DEFAULT_PATH）
+ * @return 连接成功返回ESP_OK
+ */
+esp_err_t fp_ipc_connect(fp_ipc_client_t* c, const char* path);
+
+/**
+ * @brief 断开连接
+ */
+void fp_ipc_close(fp_ipc_client_t* c);
+
+/**
+ * @brief 发送一条请求（不等应答）
+ * @return 请求号，发送失败返回0
+ */
+uint32_t fp_ipc_request(fp_ipc_client_t* c, uint8_t type, uint8_t device, const uint8_t* body, uint16_t bodyLen);
+
+/**
+ * @brief 发送命令请求（不等应答，同一连接可以连续发送多条）
+ * @param c 客户端
+ * @param device 设备号
+ * @param cmd 指令码
+ * @param params 指令参数
+ * @param paramLen 参数长度
+ * @param timeoutMs 应答超时（0表示由守护进程按自适应超时）
+ * @return 请求号，发送失败返回0
+ */
+uint32_t fp_ipc_command(fp_ipc_client_t* c, uint8_t device, uint8_t cmd,
+	const uint8_t* params, uint8_t paramLen, uint16_t timeoutMs);
+
+/**
+ * @brief 接收下一条消息（应答或事件）
+ * @param c 客户端
+ * @param msg 输出消息（消息体在下次调用前有效）
+ * @param timeoutMs 最长等待时间
+ * @return 收到消息返回ESP_OK，超时、连接断开或协议错误返回ESP_FAIL
+ */
+esp_err_t fp_ipc_recv(fp_ipc_client_t* c, fp_ipc_msg_t* msg, uint32_t timeoutMs);
+#endif
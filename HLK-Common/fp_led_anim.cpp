@@ -0,0 +1,235 @@
+﻿#include <string.h>
+#include "fp_led_anim.h"
+
+#define ANIM_MAX_KEYS (FP_BLN_MAX_STEPS * FP_LED_ANIM_STEPS_PER_FRAME) // 展开循环后的关键帧数上限（320）
+#define ANIM_MAX_TIME_BIT 100 // 时间位上限（10秒）
+#define ANIM_MAX_CYCLES 100   // 循环次数上限
+#define ANIM_COST_MAX 0xFF    // 无法编码
+
+typedef struct
+{
+	uint8_t code;    // 颜色控制码（高4位起始颜色，低4位结束颜色）
+	bool gradient;   // 渐变步（不能拆成几个短步，否则渐变会重新开始）
+	uint16_t units;  // 时长（0.1秒）
+} anim_key_t;
+
+// 一帧覆盖的关键帧：keys[i, i + span * cycles)，前span个关键帧为一轮，按时间位timeBit重复cycles次；
+// timeBit为0表示该关键帧无法与其他关键帧同帧（超过10秒且不能等分为5步以内），单独按近似等分发送
+typedef struct
+{
+	uint8_t cost;    // 从此处到结尾的最少帧数
+	uint8_t timeBit; // 本帧时间位
+	uint8_t span;    // 一轮的关键帧数
+	uint8_t cycles;  // 循环次数
+} anim_choice_t;
+
+static esp_err_t convert(const fp_led_keyframe_t* keyframes, size_t count, anim_key_t* keys)
+{
+	for (size_t k = 0; k < count; k++)
+	{
+		const fp_led_keyframe_t* kf = &keyframes[k];
+		uint32_t units = (kf->durationMs + 50) / 100;
+		if (units == 0 || (kf->color & 0xF8) != 0 || (kf->endColor != FP_LED_ANIM_SAME && (kf->endColor & 0xF8) != 0))
+		{
+			return ESP_FAIL;
+		}
+		keys[k].code = (uint8_t)((0x08 | kf->color) << 4);
+		keys[k].gradient = kf->endColor != FP_LED_ANIM_SAME;
+		if (keys[k].gradient)
+		{
+			keys[k].code |= (uint8_t)(0x08 | kf->endColor);
+		}
+		keys[k].units = (uint16_t)units;
+	}
+	return ESP_OK;
+}
+
+// 关键帧按时间位timeBit占几步：不渐变的关键帧可以等分成几个同色短步，渐变的只能是一步；不能表示返回0
+static uint8_t steps_of(const anim_key_t* k, uint8_t timeBit)
+{
+	if (k->gradient)
+		return k->units == timeBit ? 1 : 0;
+	if (k->units % timeBit != 0 || k->units / timeBit > FP_LED_ANIM_STEPS_PER_FRAME)
+		return 0;
+	return (uint8_t)(k->units / timeBit);
+}
+
+static bool same_key(const anim_key_t* a, const anim_key_t* b)
+{
+	return a->code == b->code && a->gradient == b->gradient && a->units == b->units;
+}
+
+// 单独发送的长关键帧：拆成不超过10秒的近似等长步（两种时长），每种时长各自按5步一帧
+static uint8_t split_frames(const anim_key_t* k)
+{
+	uint32_t parts = (k->units + ANIM_MAX_TIME_BIT - 1) / ANIM_MAX_TIME_BIT;
+	uint32_t longer = k->units % parts;
+	uint32_t n = (longer + FP_LED_ANIM_STEPS_PER_FRAME - 1) / FP_LED_ANIM_STEPS_PER_FRAME
+		+ (parts - longer + FP_LED_ANIM_STEPS_PER_FRAME - 1) / FP_LED_ANIM_STEPS_PER_FRAME;
+	return n < ANIM_COST_MAX ? (uint8_t)n : ANIM_COST_MAX;
+}
+
+// 动态规划：choice[i]为从第i个关键帧（展开循环后，第i个即keys[i % count]）到结尾的最少帧数及首帧的选择。
+// 每帧取一个时间位，装入从i开始、按该时间位能放进5步的连续关键帧作为一轮，
+// 后面的关键帧与这一轮逐个相同时用模块的循环次数重复，不再展开
+static void plan(const anim_key_t* keys, size_t count, size_t total, anim_choice_t* choice)
+{
+	choice[total].cost = 0;
+	for (size_t i = total; i-- > 0;)
+	{
+		anim_choice_t* c = &choice[i];
+		const anim_key_t* first = &keys[i % count];
+		c->cost = ANIM_COST_MAX;
+
+		// 首个关键帧决定候选时间位：渐变为其时长，不渐变为其1-5等分
+		uint8_t candidates[FP_LED_ANIM_STEPS_PER_FRAME];
+		uint8_t nCand = 0;
+		for (uint8_t parts = 1; parts <= FP_LED_ANIM_STEPS_PER_FRAME; parts++)
+		{
+			if (first->units % parts == 0 && first->units / parts <= ANIM_MAX_TIME_BIT && (!first->gradient || parts == 1))
+				candidates[nCand++] = (uint8_t)(first->units / parts);
+		}
+		if (nCand == 0)
+		{
+			uint32_t cost = (uint32_t)split_frames(first) + choice[i + 1].cost;
+			c->cost = cost < ANIM_COST_MAX ? (uint8_t)cost : ANIM_COST_MAX;
+			c->timeBit = 0;
+			c->span = 1;
+			c->cycles = 1;
+			continue;
+		}
+
+		for (uint8_t t = 0; t < nCand; t++)
+		{
+			uint8_t timeBit = candidates[t];
+			uint8_t steps = 0;
+			for (size_t span = 1; i + span <= total; span++)
+			{
+				uint8_t st = steps_of(&keys[(i + span - 1) % count], timeBit);
+				if (st == 0 || steps + st > FP_LED_ANIM_STEPS_PER_FRAME)
+					break;
+				steps += st;
+				// 一轮之后能重复几次就试几次（只多花这一帧）
+				for (size_t cycles = 1; cycles <= ANIM_MAX_CYCLES && i + span * cycles <= total; cycles++)
+				{
+					if (cycles > 1)
+					{
+						size_t base = i + span * (cycles - 1);
+						size_t x = 0;
+						while (x < span && same_key(&keys[(base + x) % count], &keys[(i + x) % count]))
+							x++;
+						if (x < span)
+							break;
+					}
+					uint8_t rest = choice[i + span * cycles].cost;
+					if (rest < ANIM_COST_MAX && rest + 1 < c->cost)
+					{
+						c->cost = (uint8_t)(rest + 1);
+						c->timeBit = timeBit;
+						c->span = (uint8_t)span;
+						c->cycles = (uint8_t)cycles;
+					}
+				}
+			}
+		}
+	}
+}
+
+static esp_err_t append_frame(fp_bln_sequence_t* seq, const uint8_t* codes, uint8_t steps, uint8_t timeBit,
+	uint8_t cycleTimes, uint32_t atMs, const uint8_t addr[4])
+{
+	uint8_t params[8] = { 0x07, timeBit };
+	memcpy(params + 2, codes, steps); // 未用到的组保持0（无效）
+	params[7] = cycleTimes;
+	return fp_bln_append(seq, params, sizeof(params), atMs, addr);
+}
+
+// 按选择发出一帧，返回这一帧播放的时长（毫秒），失败返回0
+static uint32_t emit(fp_bln_sequence_t* seq, const anim_key_t* keys, size_t count, size_t i,
+	const anim_choice_t* c, uint8_t cycleTimes, uint32_t atMs, const uint8_t addr[4])
+{
+	uint8_t codes[FP_LED_ANIM_STEPS_PER_FRAME];
+	if (c->timeBit == 0)
+	{
+		// 长关键帧：先发较长的那种步，再发较短的
+		const anim_key_t* k = &keys[i % count];
+		uint32_t parts = (k->units + ANIM_MAX_TIME_BIT - 1) / ANIM_MAX_TIME_BIT;
+		uint32_t start = atMs;
+		for (uint32_t p = 0; p < parts;)
+		{
+			uint8_t timeBit = (uint8_t)(k->units / parts + (p < k->units % parts ? 1 : 0));
+			uint8_t n = 0;
+			while (p < parts && n < FP_LED_ANIM_STEPS_PER_FRAME
+				&& (uint8_t)(k->units / parts + (p < k->units % parts ? 1 : 0)) == timeBit)
+			{
+				codes[n++] = k->code;
+				p++;
+			}
+			if (append_frame(seq, codes, n, timeBit, 1, atMs, addr) != ESP_OK)
+				return 0;
+			atMs += (uint32_t)n * timeBit * 100;
+		}
+		return atMs - start;
+	}
+	uint8_t n = 0;
+	for (uint8_t x = 0; x < c->span; x++)
+	{
+		const anim_key_t* k = &keys[(i + x) % count];
+		for (uint8_t s = steps_of(k, c->timeBit); s > 0; s--)
+			codes[n++] = k->code;
+	}
+	if (append_frame(seq, codes, n, c->timeBit, cycleTimes, atMs, addr) != ESP_OK)
+		return 0;
+	return (uint32_t)n * c->timeBit * 100 * (cycleTimes == 0 ? 1 : cycleTimes);
+}
+
+esp_err_t fp_led_anim_compile(fp_bln_sequence_t* seq, const fp_led_keyframe_t* keyframes, size_t count,
+	uint8_t loops, const uint8_t addr[4])
+{
+	memset(seq, 0, sizeof(*seq));
+	if (loops > ANIM_MAX_CYCLES || count == 0 || count > ANIM_MAX_KEYS)
+	{
+		return ESP_FAIL;
+	}
+	anim_key_t keys[ANIM_MAX_KEYS];
+	if (convert(keyframes, count, keys) != ESP_OK)
+	{
+		return ESP_FAIL;
+	}
+	anim_choice_t choice[ANIM_MAX_KEYS + 1];
+
+	// 整个动画一帧就能表达（可能本身就是一小段的重复）：循环交给模块，主机只发一帧
+	plan(keys, count, count, choice);
+	if (choice[0].cost == 1 && choice[0].timeBit != 0 && (loops == 0 || choice[0].cycles * loops <= ANIM_MAX_CYCLES))
+	{
+		uint8_t cycleTimes = (uint8_t)(loops == 0 ? 0 : choice[0].cycles * loops);
+		uint32_t ms = emit(seq, keys, count, 0, &choice[0], cycleTimes, 0, addr);
+		if (ms == 0)
+			return ESP_FAIL;
+		seq->totalMs = ms;
+		return ESP_OK;
+	}
+
+	// 多帧动画：按展开循环后的整个序列规划，循环边界两侧的同时长步可以并进一帧，
+	// 重复的小段用循环次数表达；下一帧在上一帧播放结束的时间位边界发送
+	size_t total = count * loops;
+	if (loops == 0 || total > ANIM_MAX_KEYS)
+	{
+		return ESP_FAIL;
+	}
+	plan(keys, count, total, choice);
+	if (choice[0].cost > FP_BLN_MAX_STEPS)
+	{
+		return ESP_FAIL;
+	}
+	uint32_t atMs = 0;
+	for (size_t i = 0; i < total; i += (size_t)choice[i].span * choice[i].cycles)
+	{
+		uint32_t ms = emit(seq, keys, count, i, &choice[i], choice[i].cycles, atMs, addr);
+		if (ms == 0)
+			return ESP_FAIL;
+		atMs += ms;
+	}
+	seq->totalMs = atMs;
+	return ESP_OK;
+}
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "fp_bln_script.h"
+
+// LED关键帧动画编译：把任意长度的关键帧列表编译为最少的七彩灯帧(0x3C, 功能码0x07)链
+// 七彩灯帧最多5组颜色，每组为一步（高4位起始颜色，低4位结束颜色，bit3为有效位），
+// 同一帧内各步共用一个时间位(1-100，单位0.1秒)，帧本身还可以循环播放(循环次数1-100)，所以：
+//   不渐变的关键帧可以等分成几个同色短步，与相邻关键帧凑成同一时间位
+//   按动态规划在展开循环后的整个序列上选帧，帧数最少（循环边界两侧的步也能并进一帧）
+//   连续重复的一小段（一轮能装进5步）只发一帧，用循环次数重复
+//   整个动画能装进一帧时直接用模块的循环次数，运行时不需要主机参与
+//   否则按时间位边界预排发送时刻，交给fp_bln_run定时发送
+// 超过10秒且不能等分为5步以内的关键帧单独拆成近似等长的几步发送
+
+#define FP_LED_ANIM_SAME 0xFF        // 结束颜色与起始颜色相同（不渐变）
+#define FP_LED_ANIM_STEPS_PER_FRAME 5
+
+typedef struct
+{
+	uint8_t color;        // 起始颜色（LED_xxx，bit0-蓝，bit1-绿，bit2-红）
+	uint8_t endColor;     // 结束颜色（FP_LED_ANIM_SAME表示不渐变）
+	uint16_t durationMs;  // 持续时间（按0.1秒取整，超过10秒拆成多步；渐变超过10秒时每步重新渐变）
+} fp_led_keyframe_t;
+
+/**
+ * @brief 编译关键帧动画
+ * @param seq 输出帧序列（可直接交给fp_bln_run执行）
+ * @param keyframes 关键帧列表
+ * @param count 关键帧数（1-320，展开循环后也不超过320）
+ * @param loops 播放次数（0表示无限循环，仅整个动画装进一帧时支持）
+ * @param addr 设备地址
+ * @return 编译成功返回ESP_OK，帧数超过FP_BLN_MAX_STEPS或参数无效返回ESP_FAIL
+ */
+esp_err_t fp_led_anim_compile(fp_bln_sequence_t* seq, const fp_led_keyframe_t* keyframes, size_t count,
+	uint8_t loops, const uint8_t addr[4]);
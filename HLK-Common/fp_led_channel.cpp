@@ -0,0 +1,131 @@
+﻿#include <string.h>
+#include "fp_led_channel.h"
+
+void fp_led_channel_init(fp_led_channel_t* ch, const uint8_t addr[4])
+{
+	std::lock_guard<std::mutex> guard(ch->lock);
+	memcpy(ch->addr, addr, 4);
+	ch->len = 0;
+	ch->posted = 0;
+	ch->dropped = 0;
+	ch->deferred = 0;
+	ch->sent = 0;
+	ch->acked = 0;
+}
+
+esp_err_t fp_led_post(fp_led_channel_t* ch, const uint8_t* params, uint8_t paramLen)
+{
+	if (!fp_bln_params_valid(params, paramLen))
+	{
+		return ESP_FAIL;
+	}
+	uint8_t payload[1 + 8];
+	payload[0] = CMD_CONTROL_BLN;
+	memcpy(payload + 1, params, paramLen);
+
+	// 锁外组帧，锁内只做覆盖
+	uint8_t frame[FP_BLN_MAX_FRAME];
+	uint8_t len = (uint8_t)fp_build_frame(ch->addr, PACKET_CMD, payload, paramLen + 1, frame, sizeof(frame));
+
+	std::lock_guard<std::mutex> guard(ch->lock);
+	ch->posted++;
+	if (ch->len != 0)
+	{
+		ch->dropped++; // 上一条还没发出去就被覆盖
+	}
+	memcpy(ch->frame, frame, len);
+	ch->len = len;
+	return ESP_OK;
+}
+
+esp_err_t fp_led_post_led(fp_led_channel_t* ch, uint8_t functionCode, uint8_t startColor, uint8_t endColor, uint8_t cycleTimes)
+{
+	uint8_t params[4] = { functionCode, (uint8_t)(startColor & 0x07), (uint8_t)(endColor & 0x07), cycleTimes };
+	return fp_led_post(ch, params, sizeof(params));
+}
+
+esp_err_t fp_led_post_colorful(fp_led_channel_t* ch, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes)
+{
+	if (timeBit < 1 || timeBit > 100 || cycleTimes > 100)
+	{
+		return ESP_FAIL;
+	}
+	uint8_t params[8] = { 0x07, timeBit };
+	memcpy(params + 2, colorCodes, 5);
+	params[7] = cycleTimes;
+	return fp_led_post(ch, params, sizeof(params));
+}
+
+bool fp_led_pending(fp_led_channel_t* ch)
+{
+	std::lock_guard<std::mutex> guard(ch->lock);
+	return ch->len != 0;
+}
+
+uint8_t fp_led_take(fp_led_channel_t* ch, uint8_t* frame)
+{
+	std::lock_guard<std::mutex> guard(ch->lock);
+	uint8_t len = ch->len;
+	if (len != 0)
+	{
+		memcpy(frame, ch->frame, len);
+		ch->len = 0;
+	}
+	return len;
+}
+
+esp_err_t fp_led_service(fp_led_channel_t* ch, const fp_transport_t* tp, bool priorityPending, uint32_t timeoutMs,
+	fp_transact_result_t* result)
+{
+	memset(result, 0, sizeof(*result));
+	if (priorityPending)
+	{
+		std::lock_guard<std::mutex> guard(ch->lock);
+		if (ch->len != 0)
+			ch->deferred++;
+		return ESP_OK;
+	}
+
+	uint8_t frame[FP_BLN_MAX_FRAME];
+	uint8_t len = fp_led_take(ch, frame);
+	if (len == 0)
+	{
+		return ESP_OK;
+	}
+	return fp_led_send(ch, tp, frame, len, timeoutMs, result);
+}
+
+esp_err_t fp_led_send(fp_led_channel_t* ch, const fp_transport_t* tp, const uint8_t* frame, uint8_t len, uint32_t timeoutMs,
+	fp_transact_result_t* result)
+{
+	memset(result, 0, sizeof(*result));
+	result->frame = FP_FRAME_SHORT;
+	uint64_t start = fp_time_us();
+	if (fp_transport_send(tp, frame, len) != ESP_OK)
+	{
+		result->linkError = true;
+		return ESP_FAIL;
+	}
+
+	uint8_t resp[FP_MIN_FRAME_LEN + 4];
+	uint16_t respLen = fp_transport_recv_frame(tp, resp, sizeof(resp), timeoutMs);
+	result->latencyUs = (uint32_t)(fp_time_us() - start);
+	result->respLen = respLen;
+	if (respLen == 0)
+	{
+		result->timeout = true;
+	}
+	else
+	{
+		result->frame = fp_check_frame(resp, respLen, ch->addr);
+		if (result->frame == FP_FRAME_OK)
+			result->confirm = resp[FP_PAYLOAD_INDEX];
+	}
+	bool ok = result->frame == FP_FRAME_OK && result->confirm == 0x00;
+
+	std::lock_guard<std::mutex> guard(ch->lock);
+	ch->sent++;
+	if (ok)
+		ch->acked++;
+	return ok ? ESP_OK : ESP_FAIL;
+}
@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <mutex>
+#include "fp_bln_script.h"
+
+// 每台设备一个LED通道：只保留最新一条待发送的LED状态（后到者覆盖先到者）
+// 识别流程中应用会连续调用"扫描中/匹配成功/空闲"几次LED控制，
+// 被覆盖的请求在发送前直接丢弃，不占用串口；
+// 有识别/注册等命令排队时LED帧让路，不会插到它们前面
+
+typedef struct
+{
+	uint8_t addr[4];                  // 设备地址
+	uint8_t frame[FP_BLN_MAX_FRAME];  // 待发送的LED控制帧
+	uint8_t len;                      // 帧长度（0表示无待发送帧）
+	uint32_t posted;                  // 提交次数
+	uint32_t dropped;                 // 被后续请求覆盖而丢弃的次数
+	uint32_t deferred;                // 因高优先级命令排队而推迟发送的次数
+	uint32_t sent;                    // 实际发送帧数
+	uint32_t acked;                   // 收到确认码0x00的帧数
+	std::mutex lock;                  // 提交与取出可能在不同线程
+} fp_led_channel_t;
+
+/**
+ * @brief 初始化LED通道
+ * @param ch LED通道
+ * @param addr 设备地址
+ */
+void fp_led_channel_init(fp_led_channel_t* ch, const uint8_t addr[4]);
+
+/**
+ * @brief 提交LED控制参数（覆盖尚未发送的上一条）
+ * @param ch LED通道
+ * @param params 背光灯控制参数（功能码开始，功能码1-6为4字节，七彩灯为8字节）
+ * @param paramLen 参数长度
+ * @return 参数有效返回ESP_OK
+ */
+esp_err_t fp_led_post(fp_led_channel_t* ch, const uint8_t* params, uint8_t paramLen);
+
+/**
+ * @brief 提交普通LED控制（参数含义同各型号驱动中的control_led）
+ */
+esp_err_t fp_led_post_led(fp_led_channel_t* ch, uint8_t functionCode, uint8_t startColor, uint8_t endColor, uint8_t cycleTimes);
+
+/**
+ * @brief 提交七彩呼吸灯控制（参数含义同各型号驱动中的control_colorful_led，颜色码已合并为字节）
+ */
+esp_err_t fp_led_post_colorful(fp_led_channel_t* ch, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes);
+
+/**
+ * @brief 是否有待发送的LED帧
+ */
+bool fp_led_pending(fp_led_channel_t* ch);
+
+/**
+ * @brief 取出待发送的LED帧（取出后通道为空）
+ * @param ch LED通道
+ * @param frame 输出帧缓冲区（至少FP_BLN_MAX_FRAME字节）
+ * @return 帧长度，无待发送帧返回0
+ */
+uint8_t fp_led_take(fp_led_channel_t* ch, uint8_t* frame);
+
+/**
+ * @brief 发送待发送的LED帧并等待应答
+ * @param ch LED通道
+ * @param tp 传输接口
+ * @param priorityPending 是否有识别/注册等命令在排队（为true时不发送，LED帧继续保留）
+ * @param timeoutMs 应答超时时间（毫秒）
+ * @param result 输出交互结果（交给链路监测旁听）；没有发送时全为0（respLen为0，timeout、linkError均为false）
+ * @return 发送且收到确认码0x00返回ESP_OK，无帧可发或被推迟也返回ESP_OK
+ */
+esp_err_t fp_led_service(fp_led_channel_t* ch, const fp_transport_t* tp, bool priorityPending, uint32_t timeoutMs,
+	fp_transact_result_t* result);
+
+/**
+ * @brief 发送一帧已取出的LED帧并等待应答（调用者需要在发送前后插入其他步骤时与fp_led_take配合使用，
+ *        如口令会话：先验证，被回0x21时重新验证后重发同一帧）
+ * @param ch LED通道（只更新统计）
+ * @param tp 传输接口
+ * @param frame LED控制帧
+ * @param len 帧长度
+ * @param timeoutMs 应答超时时间（毫秒）
+ * @param result 输出交互结果
+ * @return 收到确认码0x00返回ESP_OK
+ */
+esp_err_t fp_led_send(fp_led_channel_t* ch, const fp_transport_t* tp, const uint8_t* frame, uint8_t len, uint32_t timeoutMs,
+	fp_transact_result_t* result);
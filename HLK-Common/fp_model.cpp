@@ -0,0 +1,225 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "fp_model.h"
+#include "fp_views.h"
+
+#define FP_MODEL_ENROLL_STEP_MS 10000 // 自动注册每次录入的应答超时
+
+// ========================== 指令集 ==========================
+static constexpr uint64_t cmd_bit(uint8_t cmd)
+{
+	return (uint64_t)1 << cmd;
+}
+
+// 各型号都支持的基础指令（分步注册/搜索）
+static constexpr uint64_t kBaseCommands =
+	cmd_bit(CMD_GET_IMAGE) | cmd_bit(CMD_GEN_CHAR) | cmd_bit(CMD_MATCH) | cmd_bit(CMD_SEARCH) |
+	cmd_bit(CMD_REG_MODEL) | cmd_bit(CMD_STORE_CHAR) | cmd_bit(CMD_LOAD_CHAR) | cmd_bit(CMD_UP_CHAR) |
+	cmd_bit(CMD_DOWN_CHAR) | cmd_bit(CMD_UP_IMAGE) | cmd_bit(CMD_DOWN_IMAGE) | cmd_bit(CMD_DELET_CHAR) |
+	cmd_bit(CMD_EMPTY) | cmd_bit(CMD_WRITE_REG) | cmd_bit(CMD_READ_SYSPARA) | cmd_bit(CMD_SET_PWD) |
+	cmd_bit(CMD_VFY_PWD) | cmd_bit(CMD_VALID_TEMPLATE_NUM) | cmd_bit(CMD_READ_INDEX_TABLE) | cmd_bit(CMD_HANDSHAKE);
+
+// 带自动注册/识别、休眠和背光灯控制的型号
+static constexpr uint64_t kAutoCommands = kBaseCommands |
+	cmd_bit(CMD_CANCEL) | cmd_bit(CMD_AUTO_ENROLL) | cmd_bit(CMD_AUTO_IDENTIFY) | cmd_bit(CMD_SLEEP) |
+	cmd_bit(CMD_GET_CHIP_SN) | cmd_bit(CMD_CHECK_SENSOR) | cmd_bit(CMD_CONTROL_BLN);
+
+// ========================== 自动指令实现 ==========================
+static esp_err_t auto_enroll(const fp_model_t* m, const fp_transport_t* tp, uint16_t id, uint8_t times, fp_status_t* st)
+{
+	*st = fp_status_make(CMD_AUTO_ENROLL, FP_CONFIRM_OUT_OF_RANGE, 0);
+	if (id >= m->capacity || times < 1 || times > 5)
+		return ESP_FAIL;
+	// bit2=1：不返回中间状态，只等最终结果
+	uint8_t params[5] = { (uint8_t)(id >> 8), (uint8_t)id, times, 0x00, 1 << 2 };
+	uint8_t resp[FP_MIN_FRAME_LEN + 8];
+	fp_transact_result_t result;
+	esp_err_t ok = fp_transact(tp, m->addr, CMD_AUTO_ENROLL, params, sizeof(params), resp, sizeof(resp),
+		m->fingerTimeoutMs + times * FP_MODEL_ENROLL_STEP_MS, &result);
+	*st = fp_status_from_transact(CMD_AUTO_ENROLL, &result, resp);
+	return ok;
+}
+
+static esp_err_t auto_identify(const fp_model_t* m, const fp_transport_t* tp, uint16_t* id, uint16_t* score, fp_status_t* st)
+{
+	uint8_t params[5] = { (uint8_t)m->para.scoreLevel, 0xFF, 0xFF, 0x00, 1 << 2 };
+	uint8_t resp[FP_MIN_FRAME_LEN + 8];
+	fp_transact_result_t result;
+	esp_err_t ok = fp_transact(tp, m->addr, CMD_AUTO_IDENTIFY, params, sizeof(params), resp, sizeof(resp),
+		m->fingerTimeoutMs, &result);
+	*st = fp_status_from_transact(CMD_AUTO_IDENTIFY, &result, resp);
+	fp_identify_view v;
+	if (ok != ESP_OK || !fp_view_bind(&v, resp, result.respLen))
+		return ESP_FAIL;
+	*id = v.id();
+	*score = v.score();
+	return ESP_OK;
+}
+
+static esp_err_t native_colorful_led(const fp_model_t* m, const fp_transport_t* tp, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes)
+{
+	if (timeBit < 1 || timeBit > 100 || cycleTimes > 100)
+		return ESP_FAIL;
+	uint8_t params[8] = { 0x07, timeBit, colorCodes[0], colorCodes[1], colorCodes[2], colorCodes[3], colorCodes[4], cycleTimes };
+	uint8_t resp[FP_MIN_FRAME_LEN];
+	fp_transact_result_t result;
+	return fp_transact(tp, m->addr, CMD_CONTROL_BLN, params, sizeof(params), resp, sizeof(resp), m->timeoutMs, &result);
+}
+
+// 没有七彩灯的型号：取第1组的起止颜色做普通呼吸灯
+static esp_err_t breath_colorful_led(const fp_model_t* m, const fp_transport_t* tp, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes)
+{
+	if (timeBit < 1 || timeBit > 100 || cycleTimes > 100)
+		return ESP_FAIL;
+	uint8_t params[4] = { 0x01, (uint8_t)((colorCodes[0] >> 4) & 0x07), (uint8_t)(colorCodes[0] & 0x07), cycleTimes };
+	uint8_t resp[FP_MIN_FRAME_LEN];
+	fp_transact_result_t result;
+	return fp_transact(tp, m->addr, CMD_CONTROL_BLN, params, sizeof(params), resp, sizeof(resp), m->timeoutMs, &result);
+}
+
+// ========================== 分步指令实现 ==========================
+// 未识别的型号只用基础指令：采图-生成特征-合并-存储，采图-生成特征-搜索
+
+// 等待手指并生成特征到指定缓冲区
+static esp_err_t capture_char(const fp_model_t* m, const fp_transport_t* tp, uint8_t bufferId, fp_status_t* st)
+{
+	uint8_t resp[FP_MIN_FRAME_LEN + 4];
+	fp_transact_result_t result;
+	uint64_t deadline = fp_time_us() + (uint64_t)m->fingerTimeoutMs * 1000;
+	for (;;)
+	{
+		esp_err_t ok = fp_transact(tp, m->addr, CMD_GET_IMAGE, nullptr, 0, resp, sizeof(resp), m->timeoutMs, &result);
+		*st = fp_status_from_transact(CMD_GET_IMAGE, &result, resp);
+		if (ok == ESP_OK)
+			break;
+		if (fp_status_retry(*st) == FP_RETRY_NEVER || fp_time_us() >= deadline)
+			return ESP_FAIL;
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+	}
+	esp_err_t ok = fp_transact(tp, m->addr, CMD_GEN_CHAR, &bufferId, 1, resp, sizeof(resp), m->timeoutMs, &result);
+	*st = fp_status_from_transact(CMD_GEN_CHAR, &result, resp);
+	return ok;
+}
+
+static esp_err_t step_enroll(const fp_model_t* m, const fp_transport_t* tp, uint16_t id, uint8_t times, fp_status_t* st)
+{
+	*st = fp_status_make(CMD_STORE_CHAR, FP_CONFIRM_OUT_OF_RANGE, 0);
+	if (id >= m->capacity || times < 1 || times > 5)
+		return ESP_FAIL;
+	for (uint8_t i = 1; i <= times; i++)
+	{
+		if (capture_char(m, tp, i, st) != ESP_OK)
+			return ESP_FAIL;
+	}
+	uint8_t resp[FP_MIN_FRAME_LEN + 4];
+	fp_transact_result_t result;
+	if (fp_transact(tp, m->addr, CMD_REG_MODEL, nullptr, 0, resp, sizeof(resp), m->timeoutMs, &result) != ESP_OK)
+	{
+		*st = fp_status_from_transact(CMD_REG_MODEL, &result, resp);
+		return ESP_FAIL;
+	}
+	uint8_t params[3] = { 1, (uint8_t)(id >> 8), (uint8_t)id };
+	esp_err_t ok = fp_transact(tp, m->addr, CMD_STORE_CHAR, params, sizeof(params), resp, sizeof(resp), m->timeoutMs, &result);
+	*st = fp_status_from_transact(CMD_STORE_CHAR, &result, resp);
+	return ok;
+}
+
+static esp_err_t step_identify(const fp_model_t* m, const fp_transport_t* tp, uint16_t* id, uint16_t* score, fp_status_t* st)
+{
+	if (capture_char(m, tp, 1, st) != ESP_OK)
+		return ESP_FAIL;
+	uint8_t params[5] = { 1, 0x00, 0x00, (uint8_t)(m->capacity >> 8), (uint8_t)m->capacity };
+	uint8_t resp[FP_MIN_FRAME_LEN + 8];
+	fp_transact_result_t result;
+	esp_err_t ok = fp_transact(tp, m->addr, CMD_SEARCH, params, sizeof(params), resp, sizeof(resp), m->timeoutMs, &result);
+	*st = fp_status_from_transact(CMD_SEARCH, &result, resp);
+	fp_search_view v;
+	if (ok != ESP_OK || !fp_view_bind(&v, resp, result.respLen))
+		return ESP_FAIL;
+	*id = v.id();
+	*score = v.score();
+	return ESP_OK;
+}
+
+static esp_err_t no_colorful_led(const fp_model_t*, const fp_transport_t*, uint8_t, const uint8_t*, uint8_t)
+{
+	return ESP_FAIL;
+}
+
+// ========================== 型号特性表 ==========================
+static const fp_model_ops_t kOpsAutoColorful = { auto_enroll, auto_identify, native_colorful_led };
+static const fp_model_ops_t kOpsAutoBreath = { auto_enroll, auto_identify, breath_colorful_led };
+static const fp_model_ops_t kOpsStep = { step_enroll, step_identify, no_colorful_led };
+
+// 匹配条件取各型号出厂读到的模板大小；新批次参数不同时在此补充一行，按顺序取第一个匹配项
+static const fp_model_traits_t kModels[] = {
+	{ "ZW20/ZW3020", 0x0800, 0, FP_CAP_BREATH_LED | FP_CAP_COLORFUL_LED | FP_CAP_AUTO_CMDS | FP_CAP_SLEEP | FP_CAP_INDEX_TABLE,
+		kAutoCommands, &kOpsAutoColorful },
+	{ "ZW111", 0x0400, 0, FP_CAP_BREATH_LED | FP_CAP_COLORFUL_LED | FP_CAP_AUTO_CMDS | FP_CAP_SLEEP | FP_CAP_INDEX_TABLE,
+		kAutoCommands, &kOpsAutoColorful },
+	{ "ZW0623/ZW0906", 0x0600, 0, FP_CAP_BREATH_LED | FP_CAP_AUTO_CMDS | FP_CAP_SLEEP | FP_CAP_INDEX_TABLE,
+		kAutoCommands, &kOpsAutoBreath },
+};
+
+// 未识别的型号：只用基础指令，不控制LED
+static const fp_model_traits_t kGenericModel = { "通用", 0, 0, FP_CAP_INDEX_TABLE, kBaseCommands, &kOpsStep };
+
+// ========================== 探测 ==========================
+esp_err_t fp_syspara_decode(const uint8_t* resp, uint16_t len, fp_syspara_t* out)
+{
+	fp_syspara_view v;
+	if (!fp_view_bind(&v, resp, len) || v.confirm() != 0x00)
+		return ESP_FAIL;
+	out->status = v.status();
+	out->templateSize = v.templateSize();
+	out->capacity = v.capacity();
+	out->scoreLevel = v.scoreLevel();
+	memcpy(out->addr, v.addr(), 4);
+	out->packetSize = v.packetSize();
+	out->baud = v.baud();
+	return ESP_OK;
+}
+
+const fp_model_traits_t* fp_model_match(const fp_syspara_t* para)
+{
+	for (const fp_model_traits_t& t : kModels)
+	{
+		if ((t.templateSize == 0 || t.templateSize == para->templateSize) && (t.capacity == 0 || t.capacity == para->capacity))
+			return &t;
+	}
+	return &kGenericModel;
+}
+
+esp_err_t fp_model_probe(fp_model_t* m, const fp_transport_t* tp, const uint8_t addr[4], uint32_t timeoutMs)
+{
+	memset(m, 0, sizeof(*m));
+	memcpy(m->addr, addr, 4);
+	m->timeoutMs = timeoutMs;
+	m->fingerTimeoutMs = 10000;
+
+	uint8_t resp[FP_MIN_FRAME_LEN + 32];
+	fp_transact_result_t result;
+	if (fp_transact(tp, addr, CMD_READ_SYSPARA, nullptr, 0, resp, sizeof(resp), timeoutMs, &result) != ESP_OK ||
+		fp_syspara_decode(resp, result.respLen, &m->para) != ESP_OK)
+	{
+		return ESP_FAIL;
+	}
+	m->traits = fp_model_match(&m->para);
+	m->ops = m->traits->ops;
+	m->capacity = m->para.capacity;
+	return ESP_OK;
+}
+
+void fp_model_print(const fp_model_t* m)
+{
+	printf("型号%s（地址%02X%02X%02X%02X）：容量%u，模板%u字节，数据包%u字节，波特率%u，安全等级%u\n",
+		m->traits->name, m->addr[0], m->addr[1], m->addr[2], m->addr[3], m->capacity,
+		m->para.templateSize, m->para.packetSize, m->para.baud, m->para.scoreLevel);
+	printf("  能力：%s%s%s%s\n",
+		fp_model_has(m, FP_CAP_COLORFUL_LED) ? "七彩灯 " : fp_model_has(m, FP_CAP_BREATH_LED) ? "普通LED " : "无LED ",
+		fp_model_has(m, FP_CAP_AUTO_CMDS) ? "自动注册/识别 " : "分步注册/识别 ",
+		fp_model_has(m, FP_CAP_SLEEP) ? "休眠 " : "",
+		fp_model_has(m, FP_CAP_INDEX_TABLE) ? "读索引表" : "");
+}
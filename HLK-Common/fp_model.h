@@ -0,0 +1,132 @@
+﻿#pragma once
+#include "fp_transport.h"
+#include "fp_status.h"
+
+// 型号自动识别：上电读一次模组基本参数(0x0F)，按模板大小和指纹库容量匹配型号特性表，
+// 选出容量、LED能力、支持的指令集和一组操作函数（注册/识别/七彩灯）；
+// 之后的调用都经过fp_model_t里保存的操作表，不再逐次判断型号，
+// 同一现场混用不同型号时一个程序即可驱动
+
+// 型号能力
+#define FP_CAP_BREATH_LED 0x01    // 普通LED控制（功能码1-6）
+#define FP_CAP_COLORFUL_LED 0x02  // 七彩呼吸灯（功能码7）
+#define FP_CAP_AUTO_CMDS 0x04     // 自动注册/自动识别(0x31/0x32)
+#define FP_CAP_SLEEP 0x08         // 休眠指令(0x33)
+#define FP_CAP_INDEX_TABLE 0x10   // 读索引表(0x1F)
+
+// 模组基本参数（读模组基本参数应答的解码结果）
+typedef struct
+{
+	uint16_t status;       // 状态寄存器（部分型号为已注册数）
+	uint16_t templateSize; // 模板大小（字节）
+	uint16_t capacity;     // 指纹库容量
+	uint16_t scoreLevel;   // 安全等级
+	uint8_t addr[4];       // 设备地址
+	uint16_t packetSize;   // 数据包大小（字节）
+	uint32_t baud;         // 波特率
+} fp_syspara_t;
+
+struct fp_model_s;
+
+// 按型号分派的操作（探测时选定一次）
+typedef struct
+{
+	/**
+	 * @brief 注册指纹到指定ID
+	 * @param times 录入次数（1-5）
+	 * @param st 输出状态
+	 */
+	esp_err_t (*enroll)(const struct fp_model_s* m, const fp_transport_t* tp, uint16_t id, uint8_t times, fp_status_t* st);
+	/**
+	 * @brief 识别指纹（1:N搜索整个指纹库）
+	 * @param id 输出命中的ID
+	 * @param score 输出比对得分
+	 * @param st 输出状态
+	 */
+	esp_err_t (*identify)(const struct fp_model_s* m, const fp_transport_t* tp, uint16_t* id, uint16_t* score, fp_status_t* st);
+	/**
+	 * @brief 七彩呼吸灯（不支持的型号退化为第1组颜色的普通呼吸灯）
+	 * @param colorCodes 5组颜色码（已合并为字节，同control_colorful_led）
+	 */
+	esp_err_t (*colorful_led)(const struct fp_model_s* m, const fp_transport_t* tp, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes);
+} fp_model_ops_t;
+
+// 型号特性
+typedef struct
+{
+	const char* name;           // 型号名称
+	uint16_t templateSize;      // 匹配条件：模板大小（0表示不限）
+	uint16_t capacity;          // 匹配条件：指纹库容量（0表示不限，以读到的为准）
+	uint8_t caps;               // 能力（FP_CAP_xxx）
+	uint64_t commands;          // 支持的指令集（按指令码0x00-0x3F置位）
+	const fp_model_ops_t* ops;  // 操作表
+} fp_model_traits_t;
+
+typedef struct fp_model_s
+{
+	uint8_t addr[4];                   // 设备地址
+	fp_syspara_t para;                 // 探测读到的基本参数
+	const fp_model_traits_t* traits;   // 匹配到的型号
+	const fp_model_ops_t* ops;         // 操作表（即traits->ops）
+	uint16_t capacity;                 // 有效容量（读到的库容量）
+	uint32_t timeoutMs;                // 普通命令应答超时
+	uint32_t fingerTimeoutMs;          // 等待手指的超时（注册/识别）
+} fp_model_t;
+
+/**
+ * @brief 解码读模组基本参数的应答帧
+ * @param resp 应答帧
+ * @param len 应答帧长度
+ * @param out 输出参数
+ * @return 帧足够长且确认码为0x00返回ESP_OK
+ */
+esp_err_t fp_syspara_decode(const uint8_t* resp, uint16_t len, fp_syspara_t* out);
+
+/**
+ * @brief 按基本参数匹配型号（按表顺序取第一个匹配项，都不匹配时返回通用型号）
+ */
+const fp_model_traits_t* fp_model_match(const fp_syspara_t* para);
+
+/**
+ * @brief 探测型号：读模组基本参数并选定操作表
+ * @param m 输出型号上下文
+ * @param tp 传输接口
+ * @param addr 设备地址
+ * @param timeoutMs 读参数应答超时
+ * @return 读参数成功返回ESP_OK（失败时m不可用）
+ */
+esp_err_t fp_model_probe(fp_model_t* m, const fp_transport_t* tp, const uint8_t addr[4], uint32_t timeoutMs);
+
+/**
+ * @brief 型号是否支持某条指令
+ */
+inline bool fp_model_supports(const fp_model_t* m, uint8_t cmd)
+{
+	return cmd < 64 && (m->traits->commands >> cmd) & 1;
+}
+
+inline bool fp_model_has(const fp_model_t* m, uint8_t cap)
+{
+	return (m->traits->caps & cap) != 0;
+}
+
+// 经操作表分派的调用
+inline esp_err_t fp_model_enroll(const fp_model_t* m, const fp_transport_t* tp, uint16_t id, uint8_t times, fp_status_t* st)
+{
+	return m->ops->enroll(m, tp, id, times, st);
+}
+
+inline esp_err_t fp_model_identify(const fp_model_t* m, const fp_transport_t* tp, uint16_t* id, uint16_t* score, fp_status_t* st)
+{
+	return m->ops->identify(m, tp, id, score, st);
+}
+
+inline esp_err_t fp_model_colorful_led(const fp_model_t* m, const fp_transport_t* tp, uint8_t timeBit, const uint8_t colorCodes[5], uint8_t cycleTimes)
+{
+	return m->ops->colorful_led(m, tp, timeBit, colorCodes, cycleTimes);
+}
+
+/**
+ * @brief 打印探测结果
+ */
+void fp_model_print(const fp_model_t* m);
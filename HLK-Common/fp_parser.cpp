@@ -0,0 +1,109 @@
+﻿#include <string.h>
+#include "fp_parser.h"
+
+void fp_parser_init_buf(fp_parser_t* parser, uint8_t* buf, uint16_t cap, fp_parser_cb_t cb, void* user)
+{
+	memset(parser, 0, sizeof(*parser));
+	parser->buf = buf;
+	parser->cap = cap;
+	parser->cb = cb;
+	parser->user = user;
+}
+
+void fp_parser_reset(fp_parser_t* parser)
+{
+	parser->droppedBytes += parser->have;
+	parser->have = 0;
+	parser->need = 0;
+}
+
+// 丢弃缓冲区首字节并跳到下一个可能的包头
+static void resync(fp_parser_t* parser)
+{
+	uint16_t skip = 1;
+	while (skip < parser->have && parser->buf[skip] != FP_HEADER_0)
+	{
+		skip++;
+	}
+	memmove(parser->buf, parser->buf + skip, parser->have - skip);
+	parser->have -= skip;
+	parser->need = 0;
+	parser->droppedBytes += skip;
+}
+
+void fp_parser_feed(fp_parser_t* parser, const uint8_t* data, size_t len)
+{
+	size_t pos = 0;
+	while (pos < len || parser->have > 0)
+	{
+		// 空闲状态下快速跳过非包头字节，不逐字节拷贝
+		if (parser->have == 0)
+		{
+			const uint8_t* hdr = (const uint8_t*)memchr(data + pos, FP_HEADER_0, len - pos);
+			if (hdr == nullptr)
+			{
+				parser->droppedBytes += (uint32_t)(len - pos);
+				return;
+			}
+			parser->droppedBytes += (uint32_t)(hdr - (data + pos));
+			pos = hdr - data;
+		}
+
+		uint16_t want = parser->need ? parser->need : FP_PAYLOAD_INDEX;
+		if (parser->have < want)
+		{
+			if (pos >= len)
+			{
+				return; // 等待后续数据
+			}
+			size_t n = want - parser->have;
+			if (n > len - pos)
+				n = len - pos;
+			memcpy(parser->buf + parser->have, data + pos, n);
+			parser->have += (uint16_t)n;
+			pos += n;
+		}
+
+		if (parser->have >= 2 && parser->buf[1] != FP_HEADER_1)
+		{
+			resync(parser);
+			continue;
+		}
+		if (parser->need == 0)
+		{
+			if (parser->have < FP_PAYLOAD_INDEX)
+				continue;
+			uint16_t dataLen = fp_be16(parser->buf + FP_LEN_INDEX);
+			if (dataLen < 2 || dataLen + FP_PAYLOAD_INDEX > parser->cap)
+			{
+				parser->lengthErrors++;
+				resync(parser);
+				continue;
+			}
+			parser->need = dataLen + FP_PAYLOAD_INDEX;
+			continue;
+		}
+		if (parser->have < parser->need)
+		{
+			continue;
+		}
+
+		// 收齐一帧
+		fp_frame_result_t result = fp_check_frame(parser->buf, parser->need, nullptr);
+		if (result == FP_FRAME_OK)
+		{
+			parser->frames++;
+			if (parser->cb)
+				parser->cb(parser->user, parser->buf, parser->need, result);
+			parser->have = 0;
+			parser->need = 0;
+		}
+		else
+		{
+			parser->checksumErrors += (result == FP_FRAME_BAD_CHECKSUM);
+			if (parser->cb)
+				parser->cb(parser->user, parser->buf, parser->need, result);
+			resync(parser); // 坏帧可能是丢字节造成的，从下一个包头重新找
+		}
+	}
+}
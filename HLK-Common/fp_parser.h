@@ -0,0 +1,66 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 流式帧解析器：按任意长度的字节块输入，按包头重新同步，输出完整帧
+// 不分配内存、不打印，可在接收中断之后的任务里、离线分析和回放中共用
+
+typedef void (*fp_parser_cb_t)(void* user, const uint8_t* frame, uint16_t frameLen, fp_frame_result_t result);
+
+// 解析状态，组帧缓冲区由调用者提供：容量即可接收的最长帧，长度字段超过容量的帧按长度非法丢弃
+typedef struct
+{
+	uint8_t* buf;                  // 组帧缓冲区
+	uint16_t cap;                  // 缓冲区容量（最长帧）
+	uint16_t have;                 // 已缓存字节数
+	uint16_t need;                 // 当前帧总长度（0表示尚未收齐帧头）
+	fp_parser_cb_t cb;             // 帧回调（有效帧和校验和错误帧都会回调）
+	void* user;                    // 回调参数
+	// 统计
+	uint32_t frames;               // 有效帧数
+	uint32_t checksumErrors;       // 校验和错误帧数
+	uint32_t lengthErrors;         // 长度字段非法次数
+	uint32_t droppedBytes;         // 重新同步丢弃的字节数
+} fp_parser_t;
+
+// 自带缓冲区的解析器：Cap为最长帧，主机上用FP_MAX_FRAME_LEN，MCU上按配置的最大数据包取
+template <uint16_t Cap>
+struct fp_parser_buf_t : fp_parser_t
+{
+	static_assert(Cap >= FP_MIN_FRAME_LEN && Cap <= FP_MAX_FRAME_LEN, "解析器缓冲区必须在最短帧和协议上限之间");
+	uint8_t storage[Cap];          // 组帧缓冲区
+};
+
+/**
+ * @brief 初始化解析器
+ * @param parser 解析器
+ * @param buf 组帧缓冲区（生命周期由调用者保证）
+ * @param cap 缓冲区容量（FP_MIN_FRAME_LEN到FP_MAX_FRAME_LEN）
+ * @param cb 帧回调
+ * @param user 回调参数
+ */
+void fp_parser_init_buf(fp_parser_t* parser, uint8_t* buf, uint16_t cap, fp_parser_cb_t cb, void* user);
+
+/**
+ * @brief 初始化自带缓冲区的解析器
+ * @param parser 解析器
+ * @param cb 帧回调
+ * @param user 回调参数
+ */
+template <uint16_t Cap>
+inline void fp_parser_init(fp_parser_buf_t<Cap>* parser, fp_parser_cb_t cb, void* user)
+{
+	fp_parser_init_buf(parser, parser->storage, Cap, cb, user);
+}
+
+/**
+ * @brief 输入一段接收数据
+ * @param parser 解析器
+ * @param data 数据
+ * @param len 长度
+ */
+void fp_parser_feed(fp_parser_t* parser, const uint8_t* data, size_t len);
+
+/**
+ * @brief 丢弃未完成的半帧（如链路复位后）
+ */
+void fp_parser_reset(fp_parser_t* parser);
@@ -0,0 +1,138 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_power.h"
+
+void fp_power_default_config(fp_power_config_t* cfg)
+{
+	cfg->idleMs = 10000;
+	cfg->minIdleMs = 2000;
+	cfg->maxIdleMs = 300000;
+	cfg->stepMs = 1000;
+	cfg->wakeTargetUs = 200000;
+	cfg->sleepTimeoutMs = 300;
+}
+
+void fp_power_init(fp_power_t* p, const uint8_t addr[4], const fp_power_config_t* cfg, uint64_t nowUs)
+{
+	memset(p, 0, sizeof(*p));
+	memcpy(p->addr, addr, 4);
+	p->cfg = *cfg;
+	p->state = FP_POWER_AWAKE;
+	p->idleThresholdMs = cfg->idleMs;
+	p->lastActivityUs = nowUs;
+}
+
+// 休眠结束（被命令或触摸唤醒），累计休眠时长
+static void begin_wake(fp_power_t* p, uint64_t nowUs, bool demand)
+{
+	p->asleepUs += nowUs - p->sleepStartUs;
+	p->wakeStartUs = nowUs;
+	p->wakeDemand = demand;
+	p->state = FP_POWER_WAKING;
+	p->wakes++;
+	if (demand)
+		p->demandWakes++;
+}
+
+void fp_power_before_command(fp_power_t* p, uint64_t nowUs, bool demand)
+{
+	if (p->state == FP_POWER_ASLEEP)
+	{
+		begin_wake(p, nowUs, demand);
+	}
+	p->lastActivityUs = nowUs;
+}
+
+void fp_power_on_touch(fp_power_t* p, uint64_t nowUs)
+{
+	if (p->state == FP_POWER_ASLEEP)
+	{
+		begin_wake(p, nowUs, true);
+		p->touchWakes++;
+	}
+	p->lastActivityUs = nowUs;
+}
+
+void fp_power_after_response(fp_power_t* p, uint64_t nowUs, uint32_t serviceUs)
+{
+	p->lastActivityUs = nowUs;
+	if (p->state != FP_POWER_WAKING)
+	{
+		return;
+	}
+	p->state = FP_POWER_AWAKE;
+	uint32_t latency = (uint32_t)(nowUs - p->wakeStartUs);
+	latency = latency > serviceUs ? latency - serviceUs : 0;
+	p->lastWakeLatencyUs = latency;
+	p->wakeLatencySumUs += latency;
+	if (latency > p->wakeLatencyMaxUs)
+		p->wakeLatencyMaxUs = latency;
+	if (latency > p->cfg.wakeTargetUs)
+		p->slowWakes++;
+	if (!p->wakeDemand)
+	{
+		return;
+	}
+
+	// 有人付出了唤醒耗时：睡下不到一个阈值就被叫醒，阈值加倍；睡够了，按步长缩短
+	uint32_t t = p->idleThresholdMs;
+	if (p->wakeStartUs - p->sleepStartUs < (uint64_t)t * 1000)
+	{
+		p->shortSleeps++;
+		t = t > p->cfg.maxIdleMs / 2 ? p->cfg.maxIdleMs : t * 2;
+	}
+	else
+	{
+		t = t > p->cfg.minIdleMs + p->cfg.stepMs ? t - p->cfg.stepMs : p->cfg.minIdleMs;
+	}
+	p->idleThresholdMs = t;
+}
+
+esp_err_t fp_power_wake(fp_power_t* p, const fp_transport_t* tp, uint64_t nowUs, bool demand)
+{
+	if (p->state == FP_POWER_AWAKE)
+	{
+		return ESP_OK;
+	}
+	fp_power_before_command(p, nowUs, demand);
+	uint8_t resp[FP_MIN_FRAME_LEN + 4];
+	fp_transact_result_t result;
+	esp_err_t ok = ESP_FAIL;
+	for (int attempt = 0; attempt < 2 && ok != ESP_OK; attempt++)
+	{
+		ok = fp_transact(tp, p->addr, CMD_HANDSHAKE, nullptr, 0, resp, sizeof(resp), p->cfg.sleepTimeoutMs, &result);
+	}
+	fp_power_after_response(p, fp_time_us(), 0);
+	return ok;
+}
+
+bool fp_power_poll(fp_power_t* p, const fp_transport_t* tp, uint64_t nowUs)
+{
+	if (p->state != FP_POWER_AWAKE || nowUs - p->lastActivityUs < (uint64_t)p->idleThresholdMs * 1000)
+	{
+		return false;
+	}
+	uint8_t resp[FP_MIN_FRAME_LEN + 4];
+	fp_transact_result_t result;
+	p->sleepAttempts++;
+	if (fp_transact(tp, p->addr, CMD_SLEEP, nullptr, 0, resp, sizeof(resp), p->cfg.sleepTimeoutMs, &result) != ESP_OK)
+	{
+		// 休眠失败视为一次活动，空闲计时重新开始，避免每次轮询都重发
+		p->lastActivityUs = nowUs + result.latencyUs;
+		return false;
+	}
+	p->sleepOk++;
+	p->state = FP_POWER_ASLEEP;
+	p->sleepStartUs = nowUs + result.latencyUs;
+	return true;
+}
+
+void fp_power_print_stats(const fp_power_t* p, uint64_t nowUs)
+{
+	uint64_t asleep = p->asleepUs + (p->state == FP_POWER_ASLEEP ? nowUs - p->sleepStartUs : 0);
+	printf("休眠统计（地址%02X%02X%02X%02X）：休眠%u/%u次成功，累计休眠%.1fs\n",
+		p->addr[0], p->addr[1], p->addr[2], p->addr[3], p->sleepOk, p->sleepAttempts, asleep / 1e6);
+	printf("  唤醒%u次（触摸%u次，有人等着%u次，其中睡下不久即被叫醒%u次），平均%.1fms，最大%.1fms，超过目标%u次，当前空闲阈值%ums\n",
+		p->wakes, p->touchWakes, p->demandWakes, p->shortSleeps, p->wakes ? p->wakeLatencySumUs / 1000.0 / p->wakes : 0.0,
+		p->wakeLatencyMaxUs / 1000.0, p->slowWakes, p->idleThresholdMs);
+}
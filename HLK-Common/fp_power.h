@@ -0,0 +1,116 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 每台设备的休眠策略：空闲超过阈值后发送休眠指令(0x33)，触摸或任意命令唤醒
+// 统计唤醒耗时、进入休眠成功率和休眠时长；
+// 空闲阈值自动调节，只看有人等着的唤醒（触摸或交互命令，用户为此付出了唤醒耗时）：
+// 模块睡下不到一个阈值就被用户叫醒，说明阈值短于用户之间的间隙，阈值加倍；
+// 睡了超过一个阈值才被叫醒，说明本可以早点睡，阈值按步长缩短；
+// 定时维护命令、LED等没人等的唤醒不调节阈值，只计入统计
+// 唤醒耗时只算模块醒来的开销，不含命令本身的执行时间（自动识别光等手指就几百毫秒）：
+// 用fp_power_wake在第一条命令前发握手探测单独测量；不发探测的调用者在after_response中给出命令的预期执行时间
+//
+// 接入方式：挂到调度器上（fp_sched_attach_power）由调度线程在空闲时调用poll、命令前唤醒；
+// 自行驱动时，每条命令前调用before_command（休眠中先调用fp_power_wake），应答后调用after_response，
+// 空闲时周期调用poll，且这些调用与其他命令共用串口时要由调用者互斥
+
+typedef enum
+{
+	FP_POWER_AWAKE = 0,  // 工作中
+	FP_POWER_ASLEEP,     // 已休眠
+	FP_POWER_WAKING      // 已被触摸或命令唤醒，等待第一条应答
+} fp_power_state_t;
+
+typedef struct
+{
+	uint32_t idleMs;          // 初始空闲阈值
+	uint32_t minIdleMs;       // 空闲阈值下限
+	uint32_t maxIdleMs;       // 空闲阈值上限
+	uint32_t stepMs;          // 睡得够久后阈值缩短的步长
+	uint32_t wakeTargetUs;    // 唤醒耗时目标（不含命令执行时间，只用于统计超标次数）
+	uint32_t sleepTimeoutMs;  // 休眠指令和唤醒探测的应答超时
+} fp_power_config_t;
+
+typedef struct
+{
+	uint8_t addr[4];              // 设备地址
+	fp_power_config_t cfg;        // 配置
+	fp_power_state_t state;       // 当前状态
+	uint32_t idleThresholdMs;     // 当前空闲阈值
+	uint64_t lastActivityUs;      // 最近一次命令或应答的时刻
+	uint64_t sleepStartUs;        // 进入休眠的时刻
+	uint64_t wakeStartUs;         // 唤醒开始的时刻
+	bool wakeDemand;              // 本次唤醒有人等着（触摸或交互命令）
+	// 统计
+	uint32_t sleepAttempts;       // 发送休眠指令次数
+	uint32_t sleepOk;             // 休眠成功次数
+	uint32_t wakes;               // 唤醒次数
+	uint32_t touchWakes;          // 其中由触摸唤醒的次数
+	uint32_t demandWakes;         // 其中有人等着的次数（含触摸）
+	uint32_t shortSleeps;         // 其中睡下不到一个阈值就被叫醒（阈值加倍）的次数
+	uint32_t slowWakes;           // 唤醒耗时超过目标的次数
+	uint64_t asleepUs;            // 累计休眠时长
+	uint64_t wakeLatencySumUs;    // 唤醒耗时之和
+	uint32_t wakeLatencyMaxUs;    // 最大唤醒耗时
+	uint32_t lastWakeLatencyUs;   // 最近一次唤醒耗时
+} fp_power_t;
+
+/**
+ * @brief 默认配置（空闲10秒，阈值2秒-5分钟，步长1秒，唤醒目标200ms）
+ */
+void fp_power_default_config(fp_power_config_t* cfg);
+
+/**
+ * @brief 初始化休眠策略
+ * @param p 休眠策略
+ * @param addr 设备地址
+ * @param cfg 配置
+ * @param nowUs 当前时刻（fp_time_us）
+ */
+void fp_power_init(fp_power_t* p, const uint8_t addr[4], const fp_power_config_t* cfg, uint64_t nowUs);
+
+/**
+ * @brief 发送命令前调用（模块休眠中时该命令即为唤醒命令）
+ * @param p 休眠策略
+ * @param nowUs 当前时刻
+ * @param demand 命令有人等着（交互命令为true；定时维护命令、LED为false，唤醒时不调节阈值）
+ */
+void fp_power_before_command(fp_power_t* p, uint64_t nowUs, bool demand);
+
+/**
+ * @brief 收到应答后调用（唤醒中时记录唤醒耗时，有人等着的唤醒按休眠时长调节阈值）
+ * @param p 休眠策略
+ * @param nowUs 收到应答的时刻
+ * @param serviceUs 这条命令本身的预期执行时间（从唤醒耗时中扣除；握手探测等快命令为0）
+ */
+void fp_power_after_response(fp_power_t* p, uint64_t nowUs, uint32_t serviceUs);
+
+/**
+ * @brief 唤醒探测：模块休眠中或刚被触摸唤醒时，在第一条命令前发握手(0x35)单独测量唤醒耗时
+ *        （第一帧可能在模块醒来的过程中丢失，无应答时重发一次；两次都无应答也结束唤醒，按已耗时计入）
+ * @param p 休眠策略
+ * @param tp 传输接口
+ * @param nowUs 当前时刻
+ * @param demand 触发唤醒的命令有人等着（同fp_power_before_command；已由触摸唤醒时忽略）
+ * @return 模块应答了握手返回ESP_OK；不在休眠/唤醒中时不发帧，也返回ESP_OK
+ */
+esp_err_t fp_power_wake(fp_power_t* p, const fp_transport_t* tp, uint64_t nowUs, bool demand);
+
+/**
+ * @brief 触摸中断唤醒模块时调用（唤醒耗时从触摸算起，到下一条命令的应答为止）
+ */
+void fp_power_on_touch(fp_power_t* p, uint64_t nowUs);
+
+/**
+ * @brief 周期调用：空闲超过阈值时发送休眠指令
+ * @param p 休眠策略
+ * @param tp 传输接口（与业务命令共用时由调用者保证互斥）
+ * @param nowUs 当前时刻
+ * @return 本次进入休眠返回true
+ */
+bool fp_power_poll(fp_power_t* p, const fp_transport_t* tp, uint64_t nowUs);
+
+/**
+ * @brief 打印休眠统计
+ */
+void fp_power_print_stats(const fp_power_t* p, uint64_t nowUs);
@@ -0,0 +1,145 @@
+﻿#pragma once
+#include "fp_protocol.h"
+#include "fp_parser.h"
+#include "fp_spsc.h"
+
+// 静态分配构建配置：设备数、指纹库容量、最大数据包长度和队列深度都是模板参数，
+// 所有缓冲区（含解析器的组帧缓冲区）的大小在编译期确定并检查，运行时不用堆；
+// 每个配置的RAM占用可在编译期断言（FP_PROFILE_RAM_ASSERT），也可用tools/fp_footprint打印明细
+//
+// 用法：
+//   typedef fp_profile<1, 100, 32, 64, 2> my_profile;
+//   static fp_static_pool_t<my_profile> g_pool;       // 放在.bss，不占堆
+//   FP_PROFILE_RAM_ASSERT(my_profile, 1024);
+//   fp_static_pool_init(&g_pool, addr);
+//   串口接收中断：fp_static_device_rx(&g_pool.dev[0], fifo, n);
+//   接收任务：    fp_static_device_parse(&g_pool.dev[0]);   // 字节队列 -> 解析器 -> 帧队列
+//   协议任务：    fp_spsc_pop(&g_pool.dev[0].frames, &frame);
+//
+// MCU上建议同时定义FP_CACHE_LINE=4，队列不做缓存行填充
+
+/**
+ * @brief 构建配置
+ * @tparam Devices 设备数（1-8）
+ * @tparam Slots 指纹库容量（1-255，与驱动的FP_SLOT_CAPACITY一致）
+ * @tparam MaxPacket 最大数据包长度（32/64/128/256，与模组数据包大小设置一致）
+ * @tparam RxBytes 接收字节队列深度（2的幂）
+ * @tparam Frames 帧队列深度（2的幂）
+ */
+template <uint8_t Devices, uint16_t Slots, uint16_t MaxPacket, uint32_t RxBytes, uint32_t Frames>
+struct fp_profile
+{
+	static_assert(Devices >= 1 && Devices <= 8, "设备数必须在1-8之间");
+	static_assert(Slots >= 1 && Slots <= 255, "指纹库容量必须在1-255之间");
+	static_assert(MaxPacket == 32 || MaxPacket == 64 || MaxPacket == 128 || MaxPacket == 256,
+		"数据包长度只能是32/64/128/256");
+	static_assert(RxBytes >= 2 && (RxBytes & (RxBytes - 1)) == 0, "接收字节队列深度必须是2的幂");
+	static_assert(Frames >= 2 && (Frames & (Frames - 1)) == 0, "帧队列深度必须是2的幂");
+
+	static constexpr uint8_t kDevices = Devices;
+	static constexpr uint16_t kSlots = Slots;
+	static constexpr uint16_t kMaxPacket = MaxPacket;
+	static constexpr uint32_t kRxBytes = RxBytes;
+	static constexpr uint32_t kFrames = Frames;
+	// 索引表位图字节数
+	static constexpr uint16_t kIndexBytes = (Slots + 7) / 8;
+	// 最长的应答帧：数据包，或读索引表应答（确认码+32字节位图）
+	static constexpr uint16_t kMaxFrame = (MaxPacket > 33 ? MaxPacket : 33) + FP_FRAME_OVERHEAD;
+
+	static_assert(kMaxFrame <= FP_MAX_FRAME_LEN, "最大帧长超出协议上限");
+	static_assert(kRxBytes >= kMaxFrame, "接收字节队列至少要装下一个最长帧");
+};
+
+// 单台设备的全部运行时状态
+template <typename P>
+struct fp_static_device_t
+{
+	uint8_t addr[4];                                            // 设备地址
+	uint8_t fingerCount;                                        // 已注册指纹数
+	uint8_t index[P::kIndexBytes];                              // 指纹库占用位图
+	uint8_t resp[P::kMaxFrame];                                 // 应答缓冲区
+	fp_parser_buf_t<P::kMaxFrame> parser;                       // 流式帧解析器（缓冲区按最长应答帧）
+	fp_spsc_t<uint8_t, P::kRxBytes> rx;                         // 接收字节队列（中断写入）
+	fp_spsc_t<fp_frame_buf_t<P::kMaxFrame>, P::kFrames> frames; // 解析后的帧队列
+};
+
+// 整个配置的静态设备池
+template <typename P>
+struct fp_static_pool_t
+{
+	fp_static_device_t<P> dev[P::kDevices];
+};
+
+// 解析器回调：有效帧写入本设备的帧队列（队列满计入frames.dropped）
+template <typename P>
+inline void fp_static_device_on_frame(void* user, const uint8_t* frame, uint16_t frameLen, fp_frame_result_t result)
+{
+	if (result == FP_FRAME_OK)
+		fp_spsc_push_frame(&((fp_static_device_t<P>*)user)->frames, frame, frameLen);
+}
+
+/**
+ * @brief 设备池初始化（清零各设备状态，初始化队列，解析器的输出接到帧队列）
+ */
+template <typename P>
+inline void fp_static_pool_init(fp_static_pool_t<P>* pool, const uint8_t addr[4])
+{
+	for (uint8_t i = 0; i < P::kDevices; i++)
+	{
+		fp_static_device_t<P>* d = &pool->dev[i];
+		memcpy(d->addr, addr, 4);
+		d->fingerCount = 0;
+		memset(d->index, 0, sizeof(d->index));
+		fp_spsc_init(&d->rx);
+		fp_spsc_init(&d->frames);
+		fp_parser_init(&d->parser, fp_static_device_on_frame<P>, d);
+	}
+}
+
+/**
+ * @brief 串口接收中断中调用：收到的字节写入接收字节队列（队列满的部分计入rx.dropped）
+ */
+template <typename P>
+inline void fp_static_device_rx(fp_static_device_t<P>* d, const uint8_t* data, uint32_t len)
+{
+	fp_spsc_write(&d->rx, data, len);
+}
+
+/**
+ * @brief 接收任务中调用：取出接收字节队列中的全部字节交给解析器，完整帧进入帧队列
+ * @return 本次取出的字节数（0表示队列空，可以让出CPU）
+ */
+template <typename P>
+inline uint32_t fp_static_device_parse(fp_static_device_t<P>* d)
+{
+	uint8_t chunk[32];
+	uint32_t total = 0;
+	uint32_t n;
+	while ((n = fp_spsc_read(&d->rx, chunk, sizeof(chunk))) > 0)
+	{
+		fp_parser_feed(&d->parser, chunk, n);
+		total += n;
+	}
+	return total;
+}
+
+/**
+ * @brief 配置的静态RAM占用（字节，含对齐填充）
+ */
+template <typename P>
+constexpr size_t fp_profile_ram()
+{
+	return sizeof(fp_static_pool_t<P>);
+}
+
+// 编译期检查配置的RAM预算
+#define FP_PROFILE_RAM_ASSERT(P, budget) \
+	static_assert(fp_profile_ram<P>() <= (budget), #P "的RAM占用超出预算")
+
+// ========================== 预定义配置 ==========================
+// 2KB RAM的MCU：单设备，32字节数据包，驱动占用控制在1KB以内，其余留给应用和栈
+typedef fp_profile<1, 100, 32, 64, 2> fp_profile_tiny;
+// 常规MCU：单设备，128字节数据包
+typedef fp_profile<1, 255, 128, 256, 4> fp_profile_mcu;
+// 主机：8台设备，256字节数据包，与fp_spsc.h的默认队列深度一致
+typedef fp_profile<8, 255, 256, FP_SPSC_RX_BYTES, FP_SPSC_FRAMES> fp_profile_host;
@@ -0,0 +1,75 @@
+﻿#include <string.h>
+#include "fp_protocol.h"
+
+uint16_t fp_checksum(const uint8_t* frame, uint16_t frameLen)
+{
+	if (frame == nullptr || frameLen <= FP_PID_INDEX + 2)
+	{
+		return 0;
+	}
+	uint16_t checksum = 0;
+	for (uint16_t i = FP_PID_INDEX; i < frameLen - 2; i++)
+	{
+		checksum += frame[i];
+	}
+	return checksum;
+}
+
+uint16_t fp_build_frame(const uint8_t addr[4], uint8_t pid,
+	const uint8_t* payload, uint16_t payloadLen,
+	uint8_t* out, uint16_t outCap)
+{
+	uint16_t frameLen = payloadLen + FP_FRAME_OVERHEAD;
+	if (out == nullptr || frameLen > outCap || (payloadLen > 0 && payload == nullptr))
+	{
+		return 0;
+	}
+
+	out[0] = FP_HEADER_0;
+	out[1] = FP_HEADER_1;
+	memcpy(out + FP_ADDR_INDEX, addr, 4);
+	out[FP_PID_INDEX] = pid;
+	out[FP_LEN_INDEX] = (uint8_t)((payloadLen + 2) >> 8); // 数据长度包含校验和
+	out[FP_LEN_INDEX + 1] = (uint8_t)(payloadLen + 2);
+	if (payloadLen > 0)
+	{
+		memcpy(out + FP_PAYLOAD_INDEX, payload, payloadLen);
+	}
+
+	uint16_t checksum = fp_checksum(out, frameLen);
+	out[frameLen - 2] = (uint8_t)(checksum >> 8);   // 校验和高字节
+	out[frameLen - 1] = (uint8_t)(checksum & 0xFF); // 校验和低字节
+	return frameLen;
+}
+
+fp_frame_result_t fp_check_frame(const uint8_t* frame, uint16_t frameLen, const uint8_t addr[4])
+{
+	if (frame == nullptr || frameLen < FP_MIN_FRAME_LEN)
+	{
+		return FP_FRAME_SHORT;
+	}
+	if (frame[0] != FP_HEADER_0 || frame[1] != FP_HEADER_1)
+	{
+		return FP_FRAME_BAD_HEADER;
+	}
+	if (addr != nullptr && memcmp(frame + FP_ADDR_INDEX, addr, 4) != 0)
+	{
+		return FP_FRAME_BAD_ADDRESS;
+	}
+	uint8_t pid = frame[FP_PID_INDEX];
+	if (pid != PACKET_CMD && pid != PACKET_RESPONSE && pid != PACKET_DATA_MORE && pid != PACKET_DATA_LAST)
+	{
+		return FP_FRAME_BAD_PID;
+	}
+	uint16_t expectedDataLen = fp_be16(frame + FP_LEN_INDEX);
+	if (expectedDataLen + FP_PAYLOAD_INDEX != frameLen)
+	{
+		return FP_FRAME_BAD_LENGTH;
+	}
+	uint16_t receivedChecksum = fp_be16(frame + frameLen - 2);
+	if (fp_checksum(frame, frameLen) != receivedChecksum)
+	{
+		return FP_FRAME_BAD_CHECKSUM;
+	}
+	return FP_FRAME_OK;
+}
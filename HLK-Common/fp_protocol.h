@@ -0,0 +1,130 @@
+﻿#pragma once
+#include <stddef.h>
+#include <cstdint> // 推荐使用C99标准整数类型，增强跨平台兼容性
+
+// 海凌科指纹模块通用协议定义（ZW0623/ZW20/ZW3020/ZW0906/ZW111共用）
+// 各型号工程内的驱动文件保持独立，本目录下的模块只依赖本头文件
+
+#ifndef ESP_OK
+#define esp_err_t bool
+#define ESP_OK true
+#define ESP_FAIL false
+#endif
+
+// ========================== 帧结构常量 ==========================
+// 帧格式：包头(2) + 设备地址(4) + 包标识(1) + 数据长度(2) + 数据(N) + 校验和(2)
+#define FP_HEADER_0 0xEF
+#define FP_HEADER_1 0x01
+#define FP_ADDR_INDEX 2          // 设备地址起始索引
+#define FP_PID_INDEX 6           // 包标识索引
+#define FP_LEN_INDEX 7           // 数据长度索引（高字节在前）
+#define FP_PAYLOAD_INDEX 9       // 数据起始索引（指令码/确认码）
+#define FP_FRAME_OVERHEAD 11     // 除数据外的固定开销：9字节头 + 2字节校验和
+#define FP_MIN_FRAME_LEN 12      // 最短应答帧：固定开销 + 确认码
+#define FP_MAX_FRAME_LEN 267     // 最大帧：256字节数据包 + 固定开销
+
+// 包标识定义
+#define PACKET_CMD 0x01       // 命令包
+#define PACKET_DATA_MORE 0x02 // 数据包（有后续包）
+#define PACKET_DATA_LAST 0x08 // 最后一个数据包（结束包）
+#define PACKET_RESPONSE 0x07  // 应答包
+
+// 指令码定义（各型号手册的并集）
+#define CMD_GET_IMAGE 0x01        // 获取图像
+#define CMD_GEN_CHAR 0x02         // 生成特征
+#define CMD_MATCH 0x03            // 精确比对指纹
+#define CMD_SEARCH 0x04           // 搜索指纹
+#define CMD_REG_MODEL 0x05        // 合并特征
+#define CMD_STORE_CHAR 0x06       // 存储模板
+#define CMD_LOAD_CHAR 0x07        // 读出模板
+#define CMD_UP_CHAR 0x08          // 上传特征
+#define CMD_DOWN_CHAR 0x09        // 下载特征
+#define CMD_UP_IMAGE 0x0A         // 上传图像
+#define CMD_DOWN_IMAGE 0x0B       // 下载图像
+#define CMD_DELET_CHAR 0x0C       // 删除指纹指令
+#define CMD_EMPTY 0x0D            // 清空指纹指令
+#define CMD_WRITE_REG 0x0E        // 写系统寄存器
+#define CMD_READ_SYSPARA 0x0F     // 读模组基本参数
+#define CMD_SET_PWD 0x12          // 设置口令
+#define CMD_VFY_PWD 0x13          // 验证口令
+#define CMD_SET_CHIP_ADDR 0x15    // 设置芯片地址
+#define CMD_VALID_TEMPLATE_NUM 0x1D // 读有效模板个数
+#define CMD_READ_INDEX_TABLE 0x1F // 读索引表指令
+#define CMD_CANCEL 0x30           // 取消指令
+#define CMD_AUTO_ENROLL 0x31      // 自动注册指令
+#define CMD_AUTO_IDENTIFY 0x32    // 自动识别指令
+#define CMD_SLEEP 0x33            // 休眠指令
+#define CMD_GET_CHIP_SN 0x34      // 获取芯片序列号
+#define CMD_HANDSHAKE 0x35        // 握手指令
+#define CMD_CHECK_SENSOR 0x36     // 校验传感器
+#define CMD_CONTROL_BLN 0x3C      // 背光灯控制指令
+
+// ========================== 帧校验结果 ==========================
+// 与各驱动中verify_received_data的检查顺序一致，但不打印，供热路径使用
+typedef enum
+{
+	FP_FRAME_OK = 0,       // 有效帧
+	FP_FRAME_SHORT,        // 数据为空或长度不足
+	FP_FRAME_BAD_HEADER,   // 帧头不正确
+	FP_FRAME_BAD_ADDRESS,  // 设备地址不匹配
+	FP_FRAME_BAD_PID,      // 包标识不正确
+	FP_FRAME_BAD_LENGTH,   // 数据长度不匹配
+	FP_FRAME_BAD_CHECKSUM, // 校验和不匹配
+} fp_frame_result_t;
+
+// ========================== 通用工具函数 ==========================
+/**
+ * @brief 读取大端（高字节在前）的16/32位字段
+ */
+constexpr uint16_t fp_be16(const uint8_t* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+constexpr uint32_t fp_be32(const uint8_t* p)
+{
+	return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/**
+ * @brief 计算数据帧的校验和（累加和）
+ * @param frame 数据帧缓冲区（含末尾2字节校验和位置）
+ * @param frameLen 数据帧总长度
+ * @return 从包标识到校验和前1字节的累加和，参数无效返回0
+ */
+uint16_t fp_checksum(const uint8_t* frame, uint16_t frameLen);
+
+/**
+ * @brief 组装一帧数据（包头、地址、包标识、长度、数据、校验和）
+ * @param addr 设备地址（4字节）
+ * @param pid 包标识（PACKET_xxx）
+ * @param payload 数据区（命令包为指令码+参数，数据包为原始数据）
+ * @param payloadLen 数据区长度
+ * @param out 输出缓冲区
+ * @param outCap 输出缓冲区容量
+ * @return 帧总长度，缓冲区不足返回0
+ */
+uint16_t fp_build_frame(const uint8_t addr[4], uint8_t pid,
+	const uint8_t* payload, uint16_t payloadLen,
+	uint8_t* out, uint16_t outCap);
+
+/**
+ * @brief 校验一帧接收数据（不限定包标识）
+ * @param frame 接收的数据帧
+ * @param frameLen 实际接收的字节数
+ * @param addr 期望的设备地址，传nullptr不检查地址
+ * @return 校验结果（FP_FRAME_OK表示有效）
+ */
+fp_frame_result_t fp_check_frame(const uint8_t* frame, uint16_t frameLen, const uint8_t addr[4]);
+
+/**
+ * @brief 读取帧内的数据区
+ * @param frame 已校验的数据帧
+ * @param payloadLen 输出数据区长度（不含校验和）
+ * @return 数据区起始指针
+ */
+inline const uint8_t* fp_frame_payload(const uint8_t* frame, uint16_t* payloadLen)
+{
+	*payloadLen = (uint16_t)(fp_be16(frame + FP_LEN_INDEX) - 2);
+	return frame + FP_PAYLOAD_INDEX;
+}
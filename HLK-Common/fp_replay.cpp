@@ -0,0 +1,117 @@
+﻿#include <string.h>
+#include <chrono>
+#include <thread>
+#include "fp_replay.h"
+#include "fp_transport.h"
+
+void fp_replay_run(fp_capture_reader_t* r, double speed, fp_replay_cb_t cb, void* user, fp_replay_stats_t* stats)
+{
+	fp_replay_stats_t local;
+	memset(&local, 0, sizeof(local));
+	fp_capture_record_t rec;
+	uint64_t firstTs = 0;
+	uint64_t minTs = 0;
+	uint64_t maxTs = 0;
+	uint64_t start = fp_time_us();
+
+	while (fp_capture_next(r, &rec))
+	{
+		if (local.records == 0)
+		{
+			firstTs = minTs = maxTs = rec.tsUs;
+		}
+		if (speed > 0)
+		{
+			// 按绝对时间点等待，避免逐条累计误差；并发写入的记录时间戳可能略有倒序，早于第一条的按0处理
+			uint64_t offset = rec.tsUs < firstTs ? 0 : rec.tsUs - firstTs;
+			uint64_t due = start + (uint64_t)(offset / speed);
+			uint64_t now = fp_time_us();
+			if (now < due)
+			{
+				std::this_thread::sleep_for(std::chrono::microseconds(due - now));
+			}
+			else if (now - due > local.maxLagUs)
+			{
+				local.maxLagUs = now - due;
+			}
+		}
+		cb(user, &rec);
+		local.records++;
+		local.bytes += rec.len;
+		if (rec.tsUs < minTs)
+			minTs = rec.tsUs;
+		if (rec.tsUs > maxTs)
+			maxTs = rec.tsUs;
+	}
+	local.capturedUs = maxTs - minTs;
+	local.elapsedUs = fp_time_us() - start;
+	if (stats != nullptr)
+	{
+		*stats = local;
+	}
+}
+
+// ========================== 回放到解析器 ==========================
+void fp_replay_parsers_init(fp_replay_parsers_t* p, fp_parser_cb_t txCb, fp_parser_cb_t rxCb, void* user)
+{
+	fp_parser_init(&p->tx, txCb, user);
+	fp_parser_init(&p->rx, rxCb, user);
+}
+
+void fp_replay_to_parsers(void* user, const fp_capture_record_t* rec)
+{
+	fp_replay_parsers_t* p = (fp_replay_parsers_t*)user;
+	fp_parser_feed(rec->dir == FP_DIR_TX ? &p->tx : &p->rx, rec->data, rec->len);
+}
+
+// ========================== 回放到模拟器 ==========================
+static void on_sim_command(void* user, const uint8_t* frame, uint16_t frameLen, fp_frame_result_t result)
+{
+	fp_replay_sim_t* rs = (fp_replay_sim_t*)user;
+	if (result != FP_FRAME_OK || rs->count == FP_REPLAY_PENDING)
+	{
+		return;
+	}
+	uint8_t slot = (uint8_t)((rs->head + rs->count) % FP_REPLAY_PENDING);
+	uint16_t len = fp_sim_handle(rs->sim, frame, frameLen, rs->pending[slot], FP_MAX_FRAME_LEN);
+	if (len > 0)
+	{
+		rs->pendingLen[slot] = len;
+		rs->count++;
+	}
+}
+
+static void on_real_response(void* user, const uint8_t* frame, uint16_t frameLen, fp_frame_result_t result)
+{
+	fp_replay_sim_t* rs = (fp_replay_sim_t*)user;
+	if (result != FP_FRAME_OK || memcmp(frame + FP_ADDR_INDEX, rs->sim->addr, 4) != 0)
+	{
+		return;
+	}
+	if (rs->count == 0)
+	{
+		rs->unexpected++;
+		return;
+	}
+	const uint8_t* expect = rs->pending[rs->head];
+	if (rs->pendingLen[rs->head] == frameLen && memcmp(expect, frame, frameLen) == 0)
+		rs->matched++;
+	else
+		rs->mismatched++;
+	rs->head = (uint8_t)((rs->head + 1) % FP_REPLAY_PENDING);
+	rs->count--;
+}
+
+void fp_replay_sim_init(fp_replay_sim_t* rs, fp_sim_t* sim)
+{
+	memset(rs, 0, sizeof(*rs));
+	rs->sim = sim;
+	fp_parser_init(&rs->tx, on_sim_command, rs);
+	fp_parser_init(&rs->rx, on_real_response, rs);
+}
+
+void fp_replay_to_sim(void* user, const fp_capture_record_t* rec)
+{
+	fp_replay_sim_t* rs = (fp_replay_sim_t*)user;
+	fp_parser_feed(rec->dir == FP_DIR_TX ? &rs->tx : &rs->rx, rec->data, rec->len);
+}
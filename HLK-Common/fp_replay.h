@@ -0,0 +1,60 @@
+﻿#pragma once
+#include "fp_capture.h"
+#include "fp_parser.h"
+#include "fp_simulator.h"
+
+// 抓包回放：把现场抓到的流量按原始节奏（或最快速度）重新送入解析器或模拟器，
+// 用真实流量做确定性的回归测试和性能测试
+
+typedef void (*fp_replay_cb_t)(void* user, const fp_capture_record_t* rec);
+
+typedef struct
+{
+	uint32_t records;     // 回放的记录数
+	uint64_t bytes;       // 回放的字节数
+	uint64_t capturedUs;  // 抓包覆盖的时间跨度
+	uint64_t elapsedUs;   // 实际回放耗时
+	uint64_t maxLagUs;    // 1x回放时相对原始节奏的最大滞后
+} fp_replay_stats_t;
+
+/**
+ * @brief 回放抓包
+ * @param r 抓包读取器（从当前位置开始）
+ * @param speed 回放倍速（1.0为原速，<=0为最快速度）
+ * @param cb 记录回调
+ * @param user 回调参数
+ * @param stats 回放统计（可为nullptr）
+ */
+void fp_replay_run(fp_capture_reader_t* r, double speed, fp_replay_cb_t cb, void* user, fp_replay_stats_t* stats);
+
+// ========================== 回放到解析器 ==========================
+// 两个方向各用一个解析器，统计帧数、校验和错误和丢弃字节
+typedef struct
+{
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> tx; // 主机 -> 模块
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> rx; // 模块 -> 主机
+} fp_replay_parsers_t;
+
+void fp_replay_parsers_init(fp_replay_parsers_t* p, fp_parser_cb_t txCb, fp_parser_cb_t rxCb, void* user);
+void fp_replay_to_parsers(void* user, const fp_capture_record_t* rec);
+
+// ========================== 回放到模拟器 ==========================
+// 抓到的命令送入模拟器，模拟器的应答与抓到的真实应答逐帧比对
+#define FP_REPLAY_PENDING 8
+
+typedef struct
+{
+	fp_sim_t* sim;                                       // 模拟器（只处理与其地址相同的帧）
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> tx;                // 命令解析
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> rx;                // 真实应答解析
+	uint8_t pending[FP_REPLAY_PENDING][FP_MAX_FRAME_LEN];// 模拟器应答队列
+	uint16_t pendingLen[FP_REPLAY_PENDING];
+	uint8_t head;
+	uint8_t count;
+	uint32_t matched;                                    // 应答一致
+	uint32_t mismatched;                                 // 应答不一致
+	uint32_t unexpected;                                 // 真实应答没有对应的模拟应答
+} fp_replay_sim_t;
+
+void fp_replay_sim_init(fp_replay_sim_t* rs, fp_sim_t* sim);
+void fp_replay_to_sim(void* user, const fp_capture_record_t* rec);
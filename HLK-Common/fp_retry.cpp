@@ -0,0 +1,339 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include "fp_retry.h"
+#include "fp_dispatch.h"
+
+#define FP_RETRY_DEFAULT_TIMEOUT_MS 1000 // 没有自适应超时时的默认应答超时
+
+static const char* const kCauseNames[FP_CAUSE_COUNT] = {
+	"应答超时", "链路错误", "帧长度不足", "包头错误", "地址不匹配", "包标识错误", "长度字段错误", "校验和错误", "模块收包错误",
+};
+
+fp_idempotency_t fp_idempotency_of(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	// 写FLASH：上一次可能已经生效
+	case CMD_AUTO_ENROLL:
+	case CMD_STORE_CHAR:
+	case CMD_DELET_CHAR:
+	case CMD_EMPTY:
+		return FP_IDEM_RECONCILE;
+	// 改配置：重发的结果无法核对（口令、地址改了以后连握手都会失败）
+	case CMD_SET_PWD:
+	case CMD_SET_CHIP_ADDR:
+	case CMD_WRITE_REG:
+		return FP_IDEM_NEVER;
+	default:
+		return FP_IDEM_SAFE;
+	}
+}
+
+void fp_retry_default_config(fp_retry_config_t* cfg)
+{
+	cfg->maxAttempts = FP_RETRY_MAX_ATTEMPTS;
+	cfg->baseBackoffMs = 20;
+	cfg->maxBackoffMs = 500;
+	cfg->seed = 0x2545F491;
+}
+
+void fp_retry_init(fp_retrier_t* r, const fp_retry_config_t* cfg, fp_index_t* index, fp_timeout_t* timeouts)
+{
+	memset(r, 0, sizeof(*r));
+	r->cfg = *cfg;
+	if (r->cfg.maxAttempts < 1)
+		r->cfg.maxAttempts = 1;
+	r->rng = cfg->seed ? cfg->seed : 1;
+	r->index = index;
+	r->timeouts = timeouts;
+}
+
+// xorshift32，只用于退避抖动
+static uint32_t next_rand(fp_retrier_t* r)
+{
+	uint32_t x = r->rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	r->rng = x;
+	return x;
+}
+
+// 第n次重试前的等待：在[上限/2, 上限]内随机，上限从base起每次翻倍
+static uint32_t backoff_ms(fp_retrier_t* r, uint8_t retry)
+{
+	uint64_t ceil = (uint64_t)r->cfg.baseBackoffMs << (retry > 16 ? 16 : retry - 1);
+	if (ceil > r->cfg.maxBackoffMs)
+		ceil = r->cfg.maxBackoffMs;
+	uint32_t half = (uint32_t)(ceil / 2);
+	return half + (uint32_t)(next_rand(r) % ((uint32_t)ceil - half + 1));
+}
+
+static fp_retry_cause_t cause_of(fp_status_t st)
+{
+	switch (st.source)
+	{
+	case FP_SOURCE_TIMEOUT: return FP_CAUSE_TIMEOUT;
+	case FP_SOURCE_LINK: return FP_CAUSE_LINK;
+	case FP_SOURCE_FRAME:
+		switch (st.code)
+		{
+		case FP_FRAME_SHORT: return FP_CAUSE_SHORT;
+		case FP_FRAME_BAD_HEADER: return FP_CAUSE_HEADER;
+		case FP_FRAME_BAD_ADDRESS: return FP_CAUSE_ADDRESS;
+		case FP_FRAME_BAD_PID: return FP_CAUSE_PID;
+		case FP_FRAME_BAD_LENGTH: return FP_CAUSE_LENGTH;
+		default: return FP_CAUSE_CHECKSUM;
+		}
+	default: return FP_CAUSE_MODULE;
+	}
+}
+
+// 超时后线路上可能还有迟到的应答，读到安静为止再重发
+static void drain(const fp_transport_t* tp)
+{
+	uint8_t buf[64];
+	while (tp->read(tp->ctx, buf, sizeof(buf), 20) > 0)
+	{
+	}
+}
+
+// 自动注册/识别超时后模块可能还在等手指，先取消再重发，否则新命令会被忽略
+static void cancel_auto(const fp_transport_t* tp, const uint8_t addr[4], uint32_t timeoutMs)
+{
+	uint8_t resp[FP_MIN_FRAME_LEN + 8];
+	fp_transact_result_t result;
+	fp_transact(tp, addr, CMD_CANCEL, nullptr, 0, resp, sizeof(resp), timeoutMs, &result);
+	drain(tp);
+}
+
+// 一次命令交互（同fp_transact），自动注册/识别收齐阶段应答直到最终阶段，timeoutMs为整个流程的超时
+static esp_err_t transact_until_final(const fp_transport_t* tp, const uint8_t addr[4],
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result)
+{
+	uint64_t start = fp_time_us();
+	esp_err_t ok = fp_transact(tp, addr, cmd, params, paramLen, resp, respCap, timeoutMs, result);
+	while (ok == ESP_OK && !fp_auto_is_final(cmd, resp, result->respLen))
+	{
+		uint64_t elapsedMs = (fp_time_us() - start) / 1000;
+		uint32_t remainMs = elapsedMs < timeoutMs ? (uint32_t)(timeoutMs - elapsedMs) : 0;
+		result->respLen = remainMs > 0 ? fp_transport_recv_frame(tp, resp, respCap, remainMs) : 0;
+		result->latencyUs = (uint32_t)(fp_time_us() - start);
+		if (result->respLen == 0)
+		{
+			// 中间阶段之后没等到最终结果，按超时处理（模块可能还在流程中，由调用方取消）
+			result->timeout = true;
+			result->frame = FP_FRAME_SHORT;
+			result->confirm = 0;
+			return ESP_FAIL;
+		}
+		result->frame = fp_check_frame(resp, result->respLen, addr);
+		if (result->frame == FP_FRAME_OK && resp[FP_PID_INDEX] != PACKET_RESPONSE)
+			result->frame = FP_FRAME_BAD_PID;
+		if (result->frame != FP_FRAME_OK)
+			return ESP_FAIL;
+		result->confirm = resp[FP_PAYLOAD_INDEX];
+		ok = result->confirm == 0x00 ? ESP_OK : ESP_FAIL;
+	}
+	return ok;
+}
+
+// 写FLASH命令影响的ID范围
+static bool target_range(uint8_t cmd, const uint8_t* params, uint8_t paramLen, uint16_t* first, uint16_t* count)
+{
+	switch (cmd)
+	{
+	case CMD_AUTO_ENROLL: // ID(2) 录入次数(1) 参数(2)
+		if (paramLen < 2)
+			return false;
+		*first = fp_be16(params);
+		*count = 1;
+		return true;
+	case CMD_STORE_CHAR: // 缓冲区号(1) 位置号(2)
+		if (paramLen < 3)
+			return false;
+		*first = fp_be16(params + 1);
+		*count = 1;
+		return true;
+	case CMD_DELET_CHAR: // 起始ID(2) 个数(2)
+		if (paramLen < 4)
+			return false;
+		*first = fp_be16(params);
+		*count = fp_be16(params + 2);
+		return true;
+	default:
+		return false;
+	}
+}
+
+typedef enum
+{
+	RECONCILE_DONE = 0, // 上一次已生效
+	RECONCILE_RESEND,   // 未生效，可重发
+	RECONCILE_UNKNOWN,  // 无法判断，不重发
+	RECONCILE_FAILED    // 读索引表失败，稍后再核对
+} reconcile_t;
+
+static reconcile_t reconcile(fp_retrier_t* r, const fp_transport_t* tp, uint8_t cmd,
+	const uint8_t* params, uint8_t paramLen, bool wasFree, uint32_t timeoutMs)
+{
+	fp_index_t* idx = r->index;
+	if (idx == nullptr)
+		return RECONCILE_UNKNOWN;
+	if (fp_index_resync(idx, tp, timeoutMs) != ESP_OK)
+		return RECONCILE_FAILED;
+	if (cmd == CMD_EMPTY)
+		return idx->count == 0 ? RECONCILE_DONE : RECONCILE_RESEND;
+
+	uint16_t first, count;
+	if (!target_range(cmd, params, paramLen, &first, &count))
+		return RECONCILE_UNKNOWN;
+	if (cmd == CMD_DELET_CHAR)
+	{
+		for (uint32_t id = first; id < (uint32_t)first + count && id < idx->capacity; id++)
+		{
+			if (fp_index_occupied(idx, (uint16_t)id))
+				return RECONCILE_RESEND;
+		}
+		return RECONCILE_DONE;
+	}
+	// 注册/存储：之前空、现在占用才能确定是上一次写入的（覆盖写入分不清新旧模板）
+	if (!fp_index_occupied(idx, first))
+		return RECONCILE_RESEND;
+	return wasFree ? RECONCILE_DONE : RECONCILE_UNKNOWN;
+}
+
+// 成功后同步更新位图，省掉下一次核对前的整库同步
+static void apply_index(fp_index_t* idx, uint8_t cmd, const uint8_t* params, uint8_t paramLen)
+{
+	if (idx == nullptr || !idx->valid)
+		return;
+	if (cmd == CMD_EMPTY)
+	{
+		memset(idx->bitmap, 0, sizeof(idx->bitmap));
+		idx->count = 0;
+		return;
+	}
+	uint16_t first, count;
+	if (!target_range(cmd, params, paramLen, &first, &count))
+		return;
+	for (uint32_t id = first; id < (uint32_t)first + count && id < idx->capacity; id++)
+		fp_index_set(idx, (uint16_t)id, cmd != CMD_DELET_CHAR);
+}
+
+static uint32_t page_timeout_ms(fp_retrier_t* r)
+{
+	return r->timeouts != nullptr ? fp_timeout_ms(r->timeouts, CMD_READ_INDEX_TABLE, FP_MIN_FRAME_LEN + 1)
+		: FP_RETRY_DEFAULT_TIMEOUT_MS;
+}
+
+esp_err_t fp_retry_transact(fp_retrier_t* r, const fp_transport_t* tp, const uint8_t addr[4],
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result, fp_status_t* st)
+{
+	r->calls++;
+	fp_idempotency_t idem = fp_idempotency_of(cmd);
+	uint16_t frameLen = (uint16_t)(FP_FRAME_OVERHEAD + 1 + paramLen);
+
+	// 注册/存储前记下目标ID是否为空，核对时才能区分"上一次写入"和"原本就有"
+	bool wasFree = false;
+	uint16_t first, count;
+	if (idem == FP_IDEM_RECONCILE && r->index != nullptr && r->index->valid
+		&& target_range(cmd, params, paramLen, &first, &count))
+	{
+		wasFree = !fp_index_occupied(r->index, first);
+	}
+
+	bool pendingReconcile = false;
+	for (uint8_t attempt = 1; attempt <= r->cfg.maxAttempts; attempt++)
+	{
+		if (attempt > 1)
+		{
+			r->retries++;
+			std::this_thread::sleep_for(std::chrono::milliseconds(backoff_ms(r, attempt - 1)));
+		}
+		uint32_t ms = timeoutMs != 0 ? timeoutMs
+			: r->timeouts != nullptr ? fp_timeout_cmd_ms(r->timeouts, cmd, params, paramLen)
+			: FP_RETRY_DEFAULT_TIMEOUT_MS;
+
+		if (pendingReconcile)
+		{
+			reconcile_t rc = reconcile(r, tp, cmd, params, paramLen, wasFree, page_timeout_ms(r));
+			if (rc == RECONCILE_DONE)
+			{
+				r->reconciled++;
+				r->recovered++;
+				*st = fp_status_make(cmd, FP_CONFIRM_OK, 0);
+				return ESP_OK;
+			}
+			if (rc == RECONCILE_UNKNOWN)
+			{
+				r->refused++;
+				return ESP_FAIL;
+			}
+			if (rc == RECONCILE_FAILED)
+				continue;
+			pendingReconcile = false;
+		}
+
+		esp_err_t ok = transact_until_final(tp, addr, cmd, params, paramLen, resp, respCap, ms, result);
+		*st = fp_status_from_transact(cmd, result, resp);
+		if (r->timeouts != nullptr)
+		{
+			if (result->timeout)
+				fp_timeout_expired(r->timeouts, cmd);
+			else if (result->respLen != 0)
+				fp_timeout_observe(r->timeouts, cmd, frameLen, result->respLen, result->latencyUs);
+		}
+		if (ok == ESP_OK)
+		{
+			if (attempt > 1)
+				r->recovered++;
+			if (idem == FP_IDEM_RECONCILE)
+				apply_index(r->index, cmd, params, paramLen);
+			return ESP_OK;
+		}
+		// 业务结果、需要用户配合或参数错误：交给调用者
+		if (fp_status_retry(*st) != FP_RETRY_IMMEDIATE)
+			return ESP_FAIL;
+
+		r->byCause[cause_of(*st)]++;
+		if (idem == FP_IDEM_NEVER)
+		{
+			r->refused++;
+			return ESP_FAIL;
+		}
+		if (result->timeout || result->linkError)
+			drain(tp);
+		if (result->timeout && (cmd == CMD_AUTO_ENROLL || cmd == CMD_AUTO_IDENTIFY))
+			cancel_auto(tp, addr, r->timeouts != nullptr ? fp_timeout_ms(r->timeouts, CMD_CANCEL, FP_MIN_FRAME_LEN) : FP_RETRY_DEFAULT_TIMEOUT_MS);
+		// 模块明确回了收包错误说明命令没有执行，不必核对
+		pendingReconcile = idem == FP_IDEM_RECONCILE && st->source != FP_SOURCE_MODULE;
+	}
+	// 最后一次也失败了，但它可能已在模块上生效：放弃前再核对一次
+	if (pendingReconcile && reconcile(r, tp, cmd, params, paramLen, wasFree, page_timeout_ms(r)) == RECONCILE_DONE)
+	{
+		r->reconciled++;
+		r->recovered++;
+		*st = fp_status_make(cmd, FP_CONFIRM_OK, 0);
+		return ESP_OK;
+	}
+	r->gaveUp++;
+	return ESP_FAIL;
+}
+
+void fp_retry_print_stats(const fp_retrier_t* r)
+{
+	printf("重试：调用%u次，重发%u次，重试后成功%u次（其中核对索引表确认%u次），拒绝重发%u次，放弃%u次\n",
+		r->calls, r->retries, r->recovered, r->reconciled, r->refused, r->gaveUp);
+	for (uint8_t c = 0; c < FP_CAUSE_COUNT; c++)
+	{
+		if (r->byCause[c] != 0)
+			printf("  %-14s %u\n", kCauseNames[c], r->byCause[c]);
+	}
+}
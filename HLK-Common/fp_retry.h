@@ -0,0 +1,99 @@
+﻿#pragma once
+#include "fp_index.h"
+#include "fp_status.h"
+#include "fp_timeout.h"
+
+// 命令重试层：应答超时、帧校验失败（校验和、截断、地址不符等）或模块报收包错误时，
+// 按指令的幂等类别决定能否重发：
+//   可重发     LED、读索引表、识别、休眠等，重发不改变模块状态
+//   需核对     自动注册、存储模板、删除、清空：上一次可能已在模块上生效，
+//              先重新读索引表核对，已生效则视为成功，未生效再重发
+//   不重发     设置口令、写寄存器等，失败直接返回
+// 重试间隔指数退避并加随机抖动，避免多台设备同时重发；按失败原因分别计数
+// 自动注册/识别不要求参数bit2置位：中间阶段应答照收，等到最终阶段才算一次交互；
+// 尝试次数用尽时若最后一次失败的结果不明（超时、坏帧），放弃前再核对一次索引表
+
+#define FP_RETRY_MAX_ATTEMPTS 4 // 默认最多尝试次数（含第一次）
+
+// 幂等类别
+typedef enum
+{
+	FP_IDEM_SAFE = 0,   // 可直接重发
+	FP_IDEM_RECONCILE,  // 重发前核对索引表
+	FP_IDEM_NEVER       // 不重发
+} fp_idempotency_t;
+
+// 失败原因
+typedef enum
+{
+	FP_CAUSE_TIMEOUT = 0, // 等待应答超时
+	FP_CAUSE_LINK,        // 链路读写错误
+	FP_CAUSE_SHORT,       // 帧长度不足
+	FP_CAUSE_HEADER,      // 包头错误
+	FP_CAUSE_ADDRESS,     // 设备地址不匹配
+	FP_CAUSE_PID,         // 包标识错误
+	FP_CAUSE_LENGTH,      // 长度字段错误
+	FP_CAUSE_CHECKSUM,    // 校验和错误
+	FP_CAUSE_MODULE,      // 模块报收包错误等可重发的确认码
+	FP_CAUSE_COUNT
+} fp_retry_cause_t;
+
+typedef struct
+{
+	uint8_t maxAttempts;    // 最多尝试次数（含第一次）
+	uint32_t baseBackoffMs; // 第一次重试前的退避上限
+	uint32_t maxBackoffMs;  // 退避上限
+	uint32_t seed;          // 抖动随机数种子（各设备取不同值）
+} fp_retry_config_t;
+
+typedef struct
+{
+	fp_retry_config_t cfg;
+	uint32_t rng;                             // 抖动随机数状态
+	fp_index_t* index;                        // 核对用的索引表（nullptr时需核对的指令不重发）
+	fp_timeout_t* timeouts;                   // 自适应超时（nullptr时timeoutMs为0的调用用默认值）
+	// 统计
+	uint32_t calls;                           // 调用次数
+	uint32_t retries;                         // 重发次数
+	uint32_t byCause[FP_CAUSE_COUNT];         // 各原因的失败次数
+	uint32_t recovered;                       // 重试后成功的调用数
+	uint32_t reconciled;                      // 核对索引表发现已生效的次数
+	uint32_t refused;                         // 因幂等类别不重发的次数
+	uint32_t gaveUp;                          // 尝试次数用尽的调用数
+} fp_retrier_t;
+
+/**
+ * @brief 指令的幂等类别
+ */
+fp_idempotency_t fp_idempotency_of(uint8_t cmd);
+
+/**
+ * @brief 默认配置（最多4次，退避20ms起、上限500ms）
+ */
+void fp_retry_default_config(fp_retry_config_t* cfg);
+
+/**
+ * @brief 初始化重试层
+ * @param r 重试层
+ * @param cfg 配置
+ * @param index 核对用的索引表（可为nullptr）
+ * @param timeouts 自适应超时（可为nullptr）
+ */
+void fp_retry_init(fp_retrier_t* r, const fp_retry_config_t* cfg, fp_index_t* index, fp_timeout_t* timeouts);
+
+/**
+ * @brief 带重试的命令交互（参数同fp_transact）
+ * @param r 重试层
+ * @param timeoutMs 应答超时，0表示按自适应超时（自动注册/识别为整个流程的超时）
+ * @param st 输出最后一次交互的状态
+ * @return 成功（或核对索引表确认已生效）返回ESP_OK；核对确认时resp和result保留失败那次的内容
+ */
+esp_err_t fp_retry_transact(fp_retrier_t* r, const fp_transport_t* tp, const uint8_t addr[4],
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result, fp_status_t* st);
+
+/**
+ * @brief 打印重试统计
+ */
+void fp_retry_print_stats(const fp_retrier_t* r);
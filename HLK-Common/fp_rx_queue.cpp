@@ -0,0 +1,111 @@
+﻿#include <chrono>
+#include "fp_rx_queue.h"
+
+static void wake(fp_rx_queue_t* q)
+{
+	{
+		std::lock_guard<std::mutex> g(q->lock);
+	}
+	q->ready.notify_one();
+}
+
+static void reader_loop(fp_rx_queue_t* q)
+{
+	uint8_t buf[FP_RX_QUEUE_CHUNK];
+	while (q->running.load())
+	{
+		int n = q->inner.read(q->inner.ctx, buf, sizeof(buf), FP_RX_QUEUE_SLICE_MS);
+		if (n < 0)
+		{
+			q->error.store(n);
+			wake(q);
+			return;
+		}
+		if (n == 0)
+		{
+			continue;
+		}
+		q->reads++;
+		uint32_t off = 0;
+		while (off < (uint32_t)n)
+		{
+			uint32_t space = fp_spsc_space(&q->bytes);
+			if (space == 0)
+			{
+				// 消费者跟不上：让它取一些再写，字节留在本地缓冲区
+				q->stalls++;
+				wake(q);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				if (!q->running.load())
+					return;
+				continue;
+			}
+			uint32_t want = (uint32_t)n - off;
+			off += fp_spsc_write(&q->bytes, buf + off, want < space ? want : space);
+		}
+		uint32_t size = fp_spsc_size(&q->bytes);
+		if (size > q->peak)
+			q->peak = size;
+		wake(q);
+	}
+}
+
+static int rxq_write(void* ctx, const uint8_t* data, uint16_t len)
+{
+	fp_rx_queue_t* q = (fp_rx_queue_t*)ctx;
+	return q->inner.write(q->inner.ctx, data, len);
+}
+
+static int rxq_read(void* ctx, uint8_t* buf, uint16_t cap, uint32_t timeoutMs)
+{
+	fp_rx_queue_t* q = (fp_rx_queue_t*)ctx;
+	uint32_t n = fp_spsc_read(&q->bytes, buf, cap);
+	if (n > 0)
+	{
+		return (int)n;
+	}
+	{
+		std::unique_lock<std::mutex> g(q->lock);
+		q->ready.wait_for(g, std::chrono::milliseconds(timeoutMs), [q] {
+			return fp_spsc_size(&q->bytes) > 0 || q->error.load() < 0 || !q->running.load();
+		});
+	}
+	n = fp_spsc_read(&q->bytes, buf, cap);
+	if (n > 0)
+	{
+		return (int)n;
+	}
+	int err = q->error.load();
+	if (err < 0)
+		return err;
+	return q->running.load() ? 0 : -1; // 读线程已停止，按链路错误处理
+}
+
+void fp_rx_queue_start(fp_rx_queue_t* q, const fp_transport_t* inner)
+{
+	fp_spsc_init(&q->bytes);
+	q->inner = *inner;
+	q->error.store(0);
+	q->reads = 0;
+	q->stalls = 0;
+	q->peak = 0;
+	q->running.store(true);
+	q->reader = std::thread(reader_loop, q);
+}
+
+void fp_rx_queue_stop(fp_rx_queue_t* q)
+{
+	q->running.store(false);
+	if (q->reader.joinable())
+	{
+		q->reader.join();
+	}
+	wake(q);
+}
+
+void fp_transport_from_rx_queue(fp_transport_t* tp, fp_rx_queue_t* q)
+{
+	tp->ctx = q;
+	tp->write = rxq_write;
+	tp->read = rxq_read;
+}
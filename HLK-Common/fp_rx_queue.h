@@ -0,0 +1,52 @@
+﻿#pragma once
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "fp_spsc.h"
+#include "fp_transport.h"
+
+// 接收队列传输：读线程持续读取被包装的传输，写入接收字节队列（fp_spsc.h），
+// 上层（调度器、fp_transact）照常通过传输接口读取，从队列里取字节；
+// 协议线程忙于回调、休眠策略或链路探测时串口照样有人收；
+// 队列满时读线程等待消费者，不丢字节（等待期间由串口的内核缓冲区暂存）
+//
+// 被包装传输的读只在读线程中调用，写仍在调用者线程中直接调用，
+// 因此要求被包装传输允许读写在不同线程同时进行（串口/pty/socketpair的fd满足，模拟器传输不满足）
+// 结构体含缓存行对齐的队列，请静态分配或按alignof对齐分配（C++17之前new不保证超对齐）
+
+#define FP_RX_QUEUE_SLICE_MS 20   // 读线程单次读取的最长等待（停止时的最长响应时间）
+#define FP_RX_QUEUE_CHUNK 64      // 读线程单次读取的字节数
+
+typedef struct
+{
+	fp_rx_byte_queue_t bytes;         // 接收字节队列（读线程写入，传输读取方取出）
+	fp_transport_t inner;             // 被包装的传输
+	std::thread reader;               // 读线程
+	std::atomic<bool> running;        // 读线程运行中
+	std::atomic<int> error;           // 读线程遇到的链路错误（<0，队列取空后交给读取方）
+	std::mutex lock;                  // 只用于等待/唤醒，不保护队列
+	std::condition_variable ready;    // 队列有数据、出错或停止
+	// 统计（读线程写）
+	uint32_t reads;                   // 读到数据的次数
+	uint32_t stalls;                  // 队列满而等待消费者的次数
+	uint32_t peak;                    // 队列中的最大字节数
+} fp_rx_queue_t;
+
+/**
+ * @brief 初始化并启动读线程
+ * @param q 接收队列
+ * @param inner 被包装的传输
+ */
+void fp_rx_queue_start(fp_rx_queue_t* q, const fp_transport_t* inner);
+
+/**
+ * @brief 停止读线程（队列中未取走的字节保留，读取方仍可取完）
+ */
+void fp_rx_queue_stop(fp_rx_queue_t* q);
+
+/**
+ * @brief 以接收队列作为传输（读从队列取，写直通被包装传输）
+ * @param tp 输出传输接口
+ * @param q 已启动的接收队列（生命周期由调用者保证）
+ */
+void fp_transport_from_rx_queue(fp_transport_t* tp, fp_rx_queue_t* q);
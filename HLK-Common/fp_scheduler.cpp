@@ -0,0 +1,583 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "fp_scheduler.h"
+#include "fp_status.h"
+
+#define SCHED_PICK_NONE -1
+#define SCHED_PICK_LED FP_SCHED_COSMETIC
+
+static const char* const kClassNames[FP_SCHED_CLASSES] = { "控制", "交互", "维护", "装饰" };
+
+fp_sched_class_t fp_sched_class_of(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case CMD_CANCEL:
+	case CMD_SLEEP:
+	case CMD_HANDSHAKE:
+		return FP_SCHED_CONTROL;
+	case CMD_AUTO_IDENTIFY:
+	case CMD_AUTO_ENROLL:
+	case CMD_GET_IMAGE:
+	case CMD_GEN_CHAR:
+	case CMD_MATCH:
+	case CMD_SEARCH:
+	case CMD_REG_MODEL:
+	case CMD_STORE_CHAR:
+		return FP_SCHED_INTERACTIVE;
+	case CMD_CONTROL_BLN:
+		return FP_SCHED_COSMETIC;
+	default:
+		return FP_SCHED_HOUSEKEEPING;
+	}
+}
+
+static bool is_auto_command(uint8_t cmd)
+{
+	return cmd == CMD_AUTO_IDENTIFY || cmd == CMD_AUTO_ENROLL;
+}
+
+static void on_frame(void* user, const uint8_t* frame, uint16_t frameLen, fp_frame_result_t result)
+{
+	fp_scheduler_t* s = (fp_scheduler_t*)user;
+	if (memcmp(frame + FP_ADDR_INDEX, s->addr, 4) != 0)
+	{
+		return;
+	}
+	if (result != FP_FRAME_OK)
+	{
+		s->rxCorrupt = true;
+		return;
+	}
+	memcpy(s->rxFrame, frame, frameLen);
+	s->rxLen = frameLen;
+}
+
+void fp_sched_init(fp_scheduler_t* s, const uint8_t addr[4], const fp_transport_t* tp)
+{
+	memcpy(s->addr, addr, 4);
+	s->transport = *tp;
+	fp_led_channel_init(&s->led, addr);
+	s->ledPostUs = 0;
+	memset(s->queues, 0, sizeof(s->queues));
+	memset(s->stats, 0, sizeof(s->stats));
+	memset(s->starvationMs, 0, sizeof(s->starvationMs));
+	s->starvationMs[FP_SCHED_HOUSEKEEPING] = 2000;
+	s->inflightCmd = 0;
+	s->preempt = false;
+	s->running = false;
+	fp_parser_init(&s->parser, on_frame, s);
+	s->rxLen = 0;
+	s->rxCorrupt = false;
+	fp_timeout_init(&s->timeouts, 57600, 100);
+	fp_health_config_t health;
+	fp_health_default_config(&health);
+	fp_health_init(&s->health, &health, nullptr, nullptr);
+	s->moduleAsleep = false;
+	s->power = nullptr;
+	s->touched = false;
+	s->session = nullptr;
+	s->reconnected = false;
+	s->dispatch = nullptr;
+}
+
+// ========================== 统计 ==========================
+static void record_wait(fp_sched_class_stats_t* st, uint64_t waitUs)
+{
+	uint32_t w = waitUs > 0xFFFFFFFFull ? 0xFFFFFFFFu : (uint32_t)waitUs;
+	uint32_t bucket = 0;
+	while (bucket < FP_SCHED_WAIT_BUCKETS - 1 && (w >> bucket) != 0)
+	{
+		bucket++;
+	}
+	st->waitHist[bucket]++;
+	st->waitSumUs += w;
+	if (w > st->waitMaxUs)
+		st->waitMaxUs = w;
+}
+
+uint32_t fp_sched_wait_percentile(const fp_sched_class_stats_t* st, uint32_t permille)
+{
+	uint64_t total = 0;
+	for (uint32_t i = 0; i < FP_SCHED_WAIT_BUCKETS; i++)
+		total += st->waitHist[i];
+	if (total == 0)
+		return 0;
+	uint64_t target = (total * permille + 999) / 1000;
+	uint64_t seen = 0;
+	for (uint32_t i = 0; i < FP_SCHED_WAIT_BUCKETS; i++)
+	{
+		seen += st->waitHist[i];
+		if (seen >= target)
+		{
+			uint32_t bound = i == 0 ? 0 : (1u << i) - 1;
+			return bound < st->waitMaxUs ? bound : st->waitMaxUs;
+		}
+	}
+	return st->waitMaxUs;
+}
+
+void fp_sched_print_stats(fp_scheduler_t* s)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	printf("调度统计（地址%02X%02X%02X%02X）：\n", s->addr[0], s->addr[1], s->addr[2], s->addr[3]);
+	for (int c = 0; c < FP_SCHED_CLASSES; c++)
+	{
+		const fp_sched_class_stats_t* st = &s->stats[c];
+		printf("  %s：提交%u 完成%u 拒绝%u 抢占%u 提前%u 等待p50=%.1fms p99=%.1fms 最大=%.1fms\n",
+			kClassNames[c], st->submitted, st->completed, st->rejected, st->preempted, st->aged,
+			fp_sched_wait_percentile(st, 500) / 1000.0, fp_sched_wait_percentile(st, 990) / 1000.0,
+			st->waitMaxUs / 1000.0);
+	}
+	printf("  LED被覆盖丢弃%u次，让路%u次\n", s->led.dropped, s->led.deferred);
+}
+
+// ========================== 提交 ==========================
+esp_err_t fp_sched_submit(fp_scheduler_t* s, const fp_sched_request_t* req)
+{
+	fp_sched_class_t cls = fp_sched_class_of(req->cmd);
+	if (cls == FP_SCHED_COSMETIC)
+	{
+		return fp_sched_post_led(s, req->params, req->paramLen);
+	}
+	if (req->paramLen > FP_SCHED_MAX_PARAMS || req->cmd == CMD_SET_CHIP_ADDR)
+	{
+		return ESP_FAIL;
+	}
+
+	std::lock_guard<std::mutex> guard(s->lock);
+	fp_sched_queue_t* q = &s->queues[cls];
+	if (q->count == FP_SCHED_QUEUE_DEPTH)
+	{
+		s->stats[cls].rejected++;
+		return ESP_FAIL;
+	}
+	fp_sched_request_t* slot = &q->queue[(q->head + q->count) % FP_SCHED_QUEUE_DEPTH];
+	*slot = *req;
+	slot->enqueueUs = fp_time_us();
+	q->count++;
+	s->stats[cls].submitted++;
+
+	// 自动识别/注册可能要等几秒手指，控制类命令不能排在它后面
+	if (cls == FP_SCHED_CONTROL && is_auto_command(s->inflightCmd))
+	{
+		s->preempt = true;
+	}
+	s->wake.notify_one();
+	return ESP_OK;
+}
+
+esp_err_t fp_sched_post_led(fp_scheduler_t* s, const uint8_t* params, uint8_t paramLen)
+{
+	if (fp_led_post(&s->led, params, paramLen) != ESP_OK)
+	{
+		return ESP_FAIL;
+	}
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->ledPostUs = fp_time_us();
+	s->stats[FP_SCHED_COSMETIC].submitted++;
+	s->wake.notify_one();
+	return ESP_OK;
+}
+
+void fp_sched_attach_power(fp_scheduler_t* s, fp_power_t* power)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->power = power;
+}
+
+void fp_sched_attach_session(fp_scheduler_t* s, fp_session_t* session)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->session = session;
+}
+
+void fp_sched_attach_dispatch(fp_scheduler_t* s, fp_dispatch_t* dispatch)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->dispatch = dispatch;
+}
+
+void fp_sched_notify_reconnect(fp_scheduler_t* s)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->reconnected = true;
+	s->wake.notify_one();
+}
+
+void fp_sched_on_touch(fp_scheduler_t* s)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->touched = true;
+	s->wake.notify_one();
+}
+
+void fp_sched_set_asleep(fp_scheduler_t* s, bool asleep)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	s->moduleAsleep = asleep;
+	s->wake.notify_one();
+}
+
+// ========================== 选择 ==========================
+// 在持锁状态下调用，返回要执行的类别
+static int pick_next(fp_scheduler_t* s, uint64_t now)
+{
+	if (s->queues[FP_SCHED_CONTROL].count > 0)
+	{
+		return FP_SCHED_CONTROL;
+	}
+	// 饥饿上限：等待过久的低优先级命令插到交互类前面执行一次
+	const fp_sched_queue_t* hk = &s->queues[FP_SCHED_HOUSEKEEPING];
+	uint32_t hkLimit = s->starvationMs[FP_SCHED_HOUSEKEEPING];
+	if (hkLimit != 0 && hk->count > 0 && now - hk->queue[hk->head].enqueueUs >= (uint64_t)hkLimit * 1000)
+	{
+		if (s->queues[FP_SCHED_INTERACTIVE].count > 0)
+			s->stats[FP_SCHED_HOUSEKEEPING].aged++;
+		return FP_SCHED_HOUSEKEEPING;
+	}
+	uint32_t ledLimit = s->starvationMs[FP_SCHED_COSMETIC];
+	bool ledPending = fp_led_pending(&s->led);
+	if (ledLimit != 0 && ledPending && now - s->ledPostUs >= (uint64_t)ledLimit * 1000)
+	{
+		if (s->queues[FP_SCHED_INTERACTIVE].count + hk->count > 0)
+			s->stats[FP_SCHED_COSMETIC].aged++;
+		return SCHED_PICK_LED;
+	}
+	if (s->queues[FP_SCHED_INTERACTIVE].count > 0)
+	{
+		return FP_SCHED_INTERACTIVE;
+	}
+	if (hk->count > 0)
+	{
+		return FP_SCHED_HOUSEKEEPING;
+	}
+	return ledPending ? SCHED_PICK_LED : SCHED_PICK_NONE;
+}
+
+// ========================== 执行 ==========================
+static void execute(fp_scheduler_t* s, const fp_sched_request_t* req, fp_sched_result_t* result)
+{
+	fp_transact_result_t* x = &result->xfer;
+	x->frame = FP_FRAME_SHORT;
+
+	uint8_t payload[1 + FP_SCHED_MAX_PARAMS];
+	payload[0] = req->cmd;
+	memcpy(payload + 1, req->params, req->paramLen);
+	uint8_t frame[FP_MIN_FRAME_LEN + FP_SCHED_MAX_PARAMS];
+	uint16_t frameLen = fp_build_frame(s->addr, PACKET_CMD, payload, req->paramLen + 1, frame, sizeof(frame));
+
+	fp_parser_reset(&s->parser);
+	s->rxLen = 0;
+	s->rxCorrupt = false;
+	uint64_t start = fp_time_us();
+	if (fp_transport_send(&s->transport, frame, frameLen) != ESP_OK)
+	{
+		x->linkError = true;
+		return;
+	}
+
+	uint32_t timeoutMs = req->timeoutMs != 0 ? req->timeoutMs : fp_timeout_cmd_ms(&s->timeouts, req->cmd, req->params, req->paramLen);
+	uint64_t deadline = start + (uint64_t)timeoutMs * 1000;
+	bool cancelled = false;
+	while (true)
+	{
+		if (!cancelled && is_auto_command(req->cmd) && s->preempt.load())
+		{
+			// 取消指令只能中止自动识别/注册，收到取消应答即结束
+			uint8_t cancelCmd = CMD_CANCEL;
+			frameLen = fp_build_frame(s->addr, PACKET_CMD, &cancelCmd, 1, frame, sizeof(frame));
+			if (fp_transport_send(&s->transport, frame, frameLen) != ESP_OK)
+			{
+				x->linkError = true;
+				break;
+			}
+			cancelled = true;
+			result->preempted = true;
+			deadline = fp_time_us() + 1000 * 1000;
+		}
+
+		uint64_t now = fp_time_us();
+		if (now >= deadline)
+		{
+			x->timeout = true;
+			break;
+		}
+		uint32_t remainMs = (uint32_t)((deadline - now + 999) / 1000);
+		uint8_t buf[64];
+		int n = s->transport.read(s->transport.ctx, buf, sizeof(buf), remainMs < FP_SCHED_SLICE_MS ? remainMs : FP_SCHED_SLICE_MS);
+		if (n < 0)
+		{
+			x->linkError = true;
+			break;
+		}
+		fp_parser_feed(&s->parser, buf, (size_t)n);
+		if (s->rxCorrupt && !cancelled && !is_auto_command(req->cmd))
+		{
+			// 一问一答的应答已经到了只是坏了，不必等到超时
+			x->frame = FP_FRAME_BAD_CHECKSUM;
+			break;
+		}
+		if (s->rxLen == 0)
+		{
+			continue;
+		}
+
+		uint16_t len = s->rxLen;
+		s->rxLen = 0;
+		x->respLen = len;
+		memcpy(result->resp, s->rxFrame, len < sizeof(result->resp) ? len : sizeof(result->resp));
+		if (cancelled || fp_auto_is_final(req->cmd, s->rxFrame, len))
+		{
+			x->frame = s->rxFrame[FP_PID_INDEX] == PACKET_RESPONSE ? FP_FRAME_OK : FP_FRAME_BAD_PID;
+			x->confirm = s->rxFrame[FP_PAYLOAD_INDEX];
+			break;
+		}
+	}
+
+	if (cancelled)
+	{
+		// 被中止的命令可能还会补发一帧应答，等线路安静后再执行下一条
+		uint8_t buf[64];
+		while (s->transport.read(s->transport.ctx, buf, sizeof(buf), FP_SCHED_SLICE_MS) > 0)
+		{
+		}
+	}
+	x->latencyUs = (uint32_t)(fp_time_us() - start);
+	if (!cancelled && !x->linkError)
+	{
+		if (x->timeout)
+			fp_timeout_expired(&s->timeouts, req->cmd);
+		else if (x->frame == FP_FRAME_OK)
+			fp_timeout_observe(&s->timeouts, req->cmd, frameLen, x->respLen, x->latencyUs);
+	}
+	if (!cancelled)
+		fp_health_observe(&s->health, req->cmd, x);
+	result->ok = !result->preempted && x->frame == FP_FRAME_OK && x->confirm == 0x00 && !x->timeout;
+}
+
+// 在口令会话内执行：需要时先验证口令，命令被回0x21（模块重启后忘了验证状态）时重新验证并重发一次
+static void execute_in_session(fp_scheduler_t* s, const fp_sched_request_t* req, fp_sched_result_t* result)
+{
+	if (s->session == nullptr)
+	{
+		execute(s, req, result);
+		return;
+	}
+	uint32_t waitUs = result->waitUs;
+	uint32_t vfyTimeoutMs = fp_timeout_ms(&s->timeouts, CMD_VFY_PWD, FP_SESSION_VFY_FRAME_LEN);
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		memset(result, 0, sizeof(*result));
+		result->waitUs = waitUs;
+		if (fp_session_ensure(s->session, &s->transport, vfyTimeoutMs, &result->xfer) != ESP_OK)
+		{
+			fp_health_observe(&s->health, CMD_VFY_PWD, &result->xfer);
+			result->ok = ESP_FAIL;
+			return;
+		}
+		execute(s, req, result);
+		fp_session_observe(s->session, req->cmd, req->params, req->paramLen, &result->xfer);
+		const fp_transact_result_t* x = &result->xfer;
+		if (result->preempted || x->frame != FP_FRAME_OK || x->confirm != FP_CONFIRM_NEED_PASSWORD)
+			return;
+	}
+}
+
+// 发送LED帧：与命令一样在口令会话内发送（模块休眠/重启后只有LED流量时也会重新验证），
+// 被回0x21时重新验证并重发同一帧一次；验证失败时丢弃该帧（下一次提交再试）
+static void execute_led(fp_scheduler_t* s)
+{
+	uint8_t frame[FP_BLN_MAX_FRAME];
+	uint8_t len = fp_led_take(&s->led, frame);
+	uint32_t timeoutMs = fp_timeout_ms(&s->timeouts, CMD_CONTROL_BLN, FP_BLN_MAX_FRAME);
+	for (int attempt = 0; attempt < 2 && len != 0; attempt++)
+	{
+		fp_transact_result_t xfer;
+		if (s->session != nullptr)
+		{
+			uint32_t vfyTimeoutMs = fp_timeout_ms(&s->timeouts, CMD_VFY_PWD, FP_SESSION_VFY_FRAME_LEN);
+			if (fp_session_ensure(s->session, &s->transport, vfyTimeoutMs, &xfer) != ESP_OK)
+			{
+				fp_health_observe(&s->health, CMD_VFY_PWD, &xfer);
+				return;
+			}
+		}
+		fp_led_send(&s->led, &s->transport, frame, len, timeoutMs, &xfer);
+		fp_health_observe(&s->health, CMD_CONTROL_BLN, &xfer);
+		if (s->session == nullptr)
+			return;
+		fp_session_observe(s->session, CMD_CONTROL_BLN, frame + FP_PAYLOAD_INDEX + 1, (uint8_t)(len - FP_FRAME_OVERHEAD - 1), &xfer);
+		if (xfer.frame != FP_FRAME_OK || xfer.confirm != FP_CONFIRM_NEED_PASSWORD)
+			return;
+	}
+}
+
+// 完成：收到应答的先交给分派器按指令码解码和回调，再调用该命令的完成回调
+static void complete(fp_scheduler_t* s, const fp_sched_request_t* req, const fp_sched_result_t* result)
+{
+	const fp_transact_result_t* x = &result->xfer;
+	if (s->dispatch != nullptr && !result->preempted && !x->timeout && x->frame == FP_FRAME_OK)
+	{
+		uint16_t len = x->respLen < sizeof(result->resp) ? x->respLen : sizeof(result->resp);
+		fp_dispatch(s->dispatch, req->cmd, result->resp, len);
+	}
+	if (req->done != nullptr)
+	{
+		req->done(req->user, req->cmd, result);
+	}
+}
+
+static void worker_loop(fp_scheduler_t* s)
+{
+	std::unique_lock<std::mutex> lk(s->lock);
+	while (s->running)
+	{
+		if (s->reconnected)
+		{
+			s->reconnected = false;
+			if (s->session != nullptr)
+				fp_session_invalidate(s->session, FP_SESSION_RECONNECT);
+		}
+		uint64_t now = fp_time_us();
+		int cls = pick_next(s, now);
+		if (s->power != nullptr && (s->touched || (cls != SCHED_PICK_NONE && s->moduleAsleep)))
+		{
+			// 有触摸或有命令要发：先单独测量唤醒耗时，再回到选择（唤醒期间可能来了控制类命令）
+			// 只有触摸和交互类命令算有人等着，控制类（握手、休眠、取消）、维护类和LED唤醒不调节空闲阈值
+			bool touched = s->touched;
+			bool demand = cls == FP_SCHED_INTERACTIVE;
+			s->touched = false;
+			lk.unlock();
+			if (touched)
+				fp_power_on_touch(s->power, now);
+			fp_power_wake(s->power, &s->transport, fp_time_us(), demand);
+			lk.lock();
+			s->moduleAsleep = false;
+			continue;
+		}
+		if (cls == SCHED_PICK_NONE)
+		{
+			if (s->power != nullptr && !s->moduleAsleep)
+			{
+				lk.unlock();
+				bool slept = fp_power_poll(s->power, &s->transport, now);
+				lk.lock();
+				if (slept)
+				{
+					// 唤醒即重新上电，口令要重新验证
+					if (s->session != nullptr)
+						fp_session_invalidate(s->session, FP_SESSION_SLEEP);
+					s->moduleAsleep = true;
+					continue;
+				}
+			}
+			uint32_t dueMs = s->moduleAsleep ? 100 : fp_health_due_ms(&s->health);
+			if (dueMs == 0)
+			{
+				uint8_t probe = s->health.cfg.probeCmd;
+				lk.unlock();
+				fp_health_probe(&s->health, &s->transport, s->addr, fp_timeout_ms(&s->timeouts, probe, FP_MIN_FRAME_LEN));
+				lk.lock();
+				continue;
+			}
+			s->wake.wait_for(lk, std::chrono::milliseconds(dueMs < 100 ? dueMs : 100));
+			continue;
+		}
+
+		if (cls == SCHED_PICK_LED)
+		{
+			record_wait(&s->stats[FP_SCHED_COSMETIC], now - s->ledPostUs);
+			lk.unlock();
+			if (s->power != nullptr)
+				fp_power_before_command(s->power, fp_time_us(), false);
+			execute_led(s);
+			if (s->power != nullptr)
+				fp_power_after_response(s->power, fp_time_us(), 0);
+			lk.lock();
+			s->stats[FP_SCHED_COSMETIC].completed++;
+			continue;
+		}
+
+		fp_sched_queue_t* q = &s->queues[cls];
+		fp_sched_request_t req = q->queue[q->head];
+		q->head = (uint8_t)((q->head + 1) % FP_SCHED_QUEUE_DEPTH);
+		q->count--;
+		record_wait(&s->stats[cls], now - req.enqueueUs);
+		s->inflightCmd = req.cmd;
+		s->preempt = false;
+		lk.unlock();
+
+		fp_sched_result_t result;
+		memset(&result, 0, sizeof(result));
+		result.waitUs = (uint32_t)(now - req.enqueueUs);
+		if (s->power != nullptr)
+			fp_power_before_command(s->power, fp_time_us(), cls == FP_SCHED_INTERACTIVE);
+		execute_in_session(s, &req, &result);
+		if (s->power != nullptr)
+			fp_power_after_response(s->power, fp_time_us(), 0); // 唤醒已由探测单独计量
+
+		lk.lock();
+		s->inflightCmd = 0;
+		s->preempt = false;
+		s->stats[cls].completed++;
+		if (result.preempted)
+			s->stats[cls].preempted++;
+		lk.unlock();
+		complete(s, &req, &result);
+		lk.lock();
+	}
+}
+
+void fp_sched_start(fp_scheduler_t* s)
+{
+	std::lock_guard<std::mutex> guard(s->lock);
+	if (s->running)
+	{
+		return;
+	}
+	s->running = true;
+	s->worker = std::thread(worker_loop, s);
+}
+
+void fp_sched_stop(fp_scheduler_t* s)
+{
+	{
+		std::lock_guard<std::mutex> guard(s->lock);
+		s->running = false;
+		s->wake.notify_one();
+	}
+	if (s->worker.joinable())
+	{
+		s->worker.join();
+	}
+
+	// 调度线程已退出，把各队列里剩下的命令取出来（持锁），逐条回调（不持锁，回调里可以再提交）
+	std::vector<fp_sched_request_t> leftover;
+	{
+		std::lock_guard<std::mutex> guard(s->lock);
+		for (int cls = 0; cls < FP_SCHED_COSMETIC; cls++)
+		{
+			fp_sched_queue_t* q = &s->queues[cls];
+			for (; q->count > 0; q->count--)
+			{
+				leftover.push_back(q->queue[q->head]);
+				q->head = (uint8_t)((q->head + 1) % FP_SCHED_QUEUE_DEPTH);
+			}
+		}
+	}
+	uint64_t now = fp_time_us();
+	for (const fp_sched_request_t& req : leftover)
+	{
+		if (req.done == nullptr)
+			continue;
+		fp_sched_result_t result;
+		memset(&result, 0, sizeof(result));
+		result.ok = ESP_FAIL;
+		result.notRun = true;
+		result.waitUs = (uint32_t)(now - req.enqueueUs);
+		req.done(req.user, req.cmd, &result);
+	}
+}
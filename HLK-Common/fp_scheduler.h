@@ -0,0 +1,199 @@
+﻿#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "fp_dispatch.h"
+#include "fp_health.h"
+#include "fp_led_channel.h"
+#include "fp_parser.h"
+#include "fp_power.h"
+#include "fp_session.h"
+#include "fp_timeout.h"
+
+// 每台设备的优先级命令调度器
+// 优先级从高到低：
+//   控制类   取消、休眠、握手（唤醒）
+//   交互类   自动识别、自动注册及分步采图/比对等有用户在等待的命令
+//   维护类   读索引表、模板同步等后台命令
+//   装饰类   LED（通过LED通道，只保留最新一条，有其他命令排队时不发送）
+// 自动识别/自动注册执行中提交控制类命令时，调度器先发送取消指令(0x30)中止当前命令；
+// 维护类命令等待超过饥饿上限后优先于交互类执行一次；
+// 各类别的排队等待时间按对数直方图统计，可直接对比p50/p99；
+// 执行的每条命令（含LED帧）都交给链路监测旁听，所有队列都空且空闲到期时才发探测，
+// 探测期间到达的命令最多等一次快命令超时；模块休眠中不发探测（探测会把模块唤醒）
+// 挂接休眠策略后，调度线程在所有队列都空时按策略发休眠指令，休眠中有命令要发或有触摸时
+// 先发握手探测单独测量唤醒耗时，再执行命令
+// 挂接口令会话后，每条命令（含LED帧）前按需验证口令，被回0x21时重新验证并重发一次；
+// 休眠策略让模块休眠、调用者通知串口重新打开时会话失效；
+// 挂接应答分派器后，每条命令收到应答（未被抢占）时先按指令码分派给注册的回调，再调用该命令的完成回调；
+// 设置芯片地址(0x15)不接受（调度器按初始化时的地址组帧和过滤应答，改地址要停止后重新初始化）
+
+#define FP_SCHED_QUEUE_DEPTH 16   // 每个类别的队列深度
+#define FP_SCHED_MAX_PARAMS 16    // 命令参数上限
+#define FP_SCHED_WAIT_BUCKETS 25  // 等待时间直方图桶数（2的幂微秒，最大约16秒）
+#define FP_SCHED_SLICE_MS 20      // 等待应答时检查抢占的间隔
+
+typedef enum
+{
+	FP_SCHED_CONTROL = 0,     // 控制类
+	FP_SCHED_INTERACTIVE,     // 交互类
+	FP_SCHED_HOUSEKEEPING,    // 维护类
+	FP_SCHED_COSMETIC,        // 装饰类（LED）
+	FP_SCHED_CLASSES
+} fp_sched_class_t;
+
+typedef struct
+{
+	fp_transact_result_t xfer;  // 交互结果（确认码、超时、帧校验、执行耗时）
+	esp_err_t ok;               // 是否成功（确认码为0x00）；口令验证失败时xfer为验证命令的结果
+	bool preempted;             // 被取消指令抢占
+	bool notRun;                // 调度器停止时仍在队列中，未发送（ok为ESP_FAIL，xfer全为0）
+	uint32_t waitUs;            // 排队等待时间
+	uint8_t resp[64];           // 最后一帧应答
+} fp_sched_result_t;
+
+/**
+ * @brief 命令完成回调（在调度线程中调用）
+ */
+typedef void (*fp_sched_done_t)(void* user, uint8_t cmd, const fp_sched_result_t* result);
+
+typedef struct
+{
+	uint8_t cmd;                           // 指令码
+	uint8_t params[FP_SCHED_MAX_PARAMS];   // 指令参数
+	uint8_t paramLen;                      // 参数长度
+	uint32_t timeoutMs;                    // 应答超时（自动识别/注册为整个流程的超时，0表示按自适应超时）
+	fp_sched_done_t done;                  // 完成回调（可为nullptr）
+	void* user;                            // 回调参数
+	uint64_t enqueueUs;                    // 入队时刻（由调度器填写）
+} fp_sched_request_t;
+
+typedef struct
+{
+	uint32_t submitted;                       // 提交数
+	uint32_t completed;                       // 执行完成数
+	uint32_t rejected;                        // 队列满拒绝数
+	uint32_t preempted;                       // 被抢占数
+	uint32_t aged;                            // 因饥饿上限提前执行的次数
+	uint64_t waitSumUs;                       // 等待时间之和
+	uint32_t waitMaxUs;                       // 最大等待时间
+	uint32_t waitHist[FP_SCHED_WAIT_BUCKETS]; // 等待时间直方图（桶i为[2^(i-1), 2^i)微秒）
+} fp_sched_class_stats_t;
+
+typedef struct
+{
+	fp_sched_request_t queue[FP_SCHED_QUEUE_DEPTH];
+	uint8_t head;
+	uint8_t count;
+} fp_sched_queue_t;
+
+typedef struct
+{
+	uint8_t addr[4];                                  // 设备地址
+	fp_transport_t transport;                         // 设备所在端口
+	fp_led_channel_t led;                             // 装饰类：LED通道
+	uint64_t ledPostUs;                               // 最新LED请求的提交时刻
+	fp_sched_queue_t queues[FP_SCHED_COSMETIC];       // 控制/交互/维护类队列
+	uint32_t starvationMs[FP_SCHED_CLASSES];          // 各类别饥饿上限（0表示不提前）
+	fp_sched_class_stats_t stats[FP_SCHED_CLASSES];   // 各类别统计
+	uint8_t inflightCmd;                              // 执行中的指令码（0表示空闲）
+	std::atomic<bool> preempt;                        // 请求中止执行中的自动识别/注册
+	bool running;                                     // 调度线程运行中
+	std::mutex lock;
+	std::condition_variable wake;
+	std::thread worker;
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> parser;         // 应答组帧
+	uint8_t rxFrame[FP_MAX_FRAME_LEN];                // 最近收到的应答帧
+	uint16_t rxLen;                                   // 最近收到的应答帧长度（0表示无）
+	bool rxCorrupt;                                   // 收到了校验和错误的应答帧
+	fp_timeout_t timeouts;                            // 各指令的自适应应答超时（只由调度线程更新）
+	fp_health_t health;                               // 链路监测（只由调度线程更新，回调在调度线程中调用）
+	bool moduleAsleep;                                // 模块休眠中，暂停空闲探测（由休眠策略设置）
+	fp_power_t* power;                                // 休眠策略（nullptr表示不休眠；挂接后只由调度线程访问）
+	bool touched;                                     // 有触摸唤醒待交给休眠策略
+	fp_session_t* session;                            // 口令会话（nullptr表示模块无口令；挂接后只由调度线程访问）
+	bool reconnected;                                 // 串口重新打开，待使会话失效
+	fp_dispatch_t* dispatch;                          // 应答分派器（nullptr表示不分派；回调在调度线程中调用）
+} fp_scheduler_t;
+
+/**
+ * @brief 指令码所属的优先级类别
+ */
+fp_sched_class_t fp_sched_class_of(uint8_t cmd);
+
+/**
+ * @brief 初始化调度器（默认维护类饥饿上限2秒，LED不设饥饿上限；
+ *        自适应超时按57600波特率、100枚容量初始化，启动前可用fp_timeout_init重设；
+ *        链路监测按默认配置、无回调初始化，启动前可用fp_health_init重设）
+ * @param s 调度器
+ * @param addr 设备地址
+ * @param tp 传输接口
+ */
+void fp_sched_init(fp_scheduler_t* s, const uint8_t addr[4], const fp_transport_t* tp);
+
+/**
+ * @brief 启动调度线程
+ */
+void fp_sched_start(fp_scheduler_t* s);
+
+/**
+ * @brief 停止调度线程（执行中的命令完成后退出；队列中未执行的命令在调用线程中
+ *        以notRun结果逐条回调，调用者按请求保存的状态都能释放，等待完成的一方不会一直挂起）
+ */
+void fp_sched_stop(fp_scheduler_t* s);
+
+/**
+ * @brief 提交命令（LED控制命令转入LED通道，不回调）
+ * @param s 调度器
+ * @param req 命令（复制入队）
+ * @return 入队成功返回ESP_OK，队列满、参数过长或设置芯片地址返回ESP_FAIL
+ */
+esp_err_t fp_sched_submit(fp_scheduler_t* s, const fp_sched_request_t* req);
+
+/**
+ * @brief 提交LED控制（参数含义同fp_led_post）
+ */
+esp_err_t fp_sched_post_led(fp_scheduler_t* s, const uint8_t* params, uint8_t paramLen);
+
+/**
+ * @brief 挂接休眠策略（启动前调用，nullptr为不休眠）
+ */
+void fp_sched_attach_power(fp_scheduler_t* s, fp_power_t* power);
+
+/**
+ * @brief 挂接口令会话（启动前调用，nullptr为模块无口令；会话地址须与调度器一致）
+ */
+void fp_sched_attach_session(fp_scheduler_t* s, fp_session_t* session);
+
+/**
+ * @brief 挂接应答分派器（启动前调用，nullptr为不分派；回调参数取分派器初始化时给的user）
+ */
+void fp_sched_attach_dispatch(fp_scheduler_t* s, fp_dispatch_t* dispatch);
+
+/**
+ * @brief 串口重新打开后调用（会话失效，下一条命令前重新验证口令）
+ */
+void fp_sched_notify_reconnect(fp_scheduler_t* s);
+
+/**
+ * @brief 触摸中断唤醒模块时调用（代替fp_power_on_touch，调度线程随即发唤醒探测）
+ */
+void fp_sched_on_touch(fp_scheduler_t* s);
+
+/**
+ * @brief 通知调度器模块进入/退出休眠（休眠中不发空闲探测，有命令提交时照常发送）
+ */
+void fp_sched_set_asleep(fp_scheduler_t* s, bool asleep);
+
+/**
+ * @brief 等待时间百分位（返回所在桶的上界，微秒）
+ * @param st 类别统计
+ * @param permille 千分位（500为p50，990为p99）
+ */
+uint32_t fp_sched_wait_percentile(const fp_sched_class_stats_t* st, uint32_t permille);
+
+/**
+ * @brief 打印各类别排队等待统计
+ */
+void fp_sched_print_stats(fp_scheduler_t* s);
@@ -0,0 +1,135 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_session.h"
+#include "fp_status.h"
+
+static const char* const kReasonNames[FP_SESSION_REASONS] = { "断电重启", "休眠唤醒", "地址变更", "重新连接" };
+
+static void build_vfy_frame(fp_session_t* s)
+{
+	uint8_t payload[5] = { CMD_VFY_PWD, (uint8_t)(s->password >> 24), (uint8_t)(s->password >> 16),
+		(uint8_t)(s->password >> 8), (uint8_t)s->password };
+	fp_build_frame(s->addr, PACKET_CMD, payload, sizeof(payload), s->vfyFrame, sizeof(s->vfyFrame));
+}
+
+void fp_session_init(fp_session_t* s, const uint8_t addr[4], uint32_t password)
+{
+	memset(s, 0, sizeof(*s));
+	memcpy(s->addr, addr, 4);
+	s->password = password;
+	s->verified = password == 0;
+	build_vfy_frame(s);
+}
+
+void fp_session_invalidate(fp_session_t* s, fp_session_reason_t reason)
+{
+	if (reason < FP_SESSION_REASONS)
+		s->invalidations[reason]++;
+	s->verified = s->password == 0;
+}
+
+// 发送预先组好的验证帧，结果按fp_transact的约定填写
+static esp_err_t verify(fp_session_t* s, const fp_transport_t* tp, uint32_t timeoutMs, fp_transact_result_t* result)
+{
+	memset(result, 0, sizeof(*result));
+	result->frame = FP_FRAME_SHORT;
+	s->verifications++;
+	uint8_t resp[FP_MIN_FRAME_LEN];
+	uint64_t start = fp_time_us();
+	if (fp_transport_send(tp, s->vfyFrame, sizeof(s->vfyFrame)) != ESP_OK)
+	{
+		result->linkError = true;
+	}
+	else if ((result->respLen = fp_transport_recv_frame(tp, resp, sizeof(resp), timeoutMs)) == 0)
+	{
+		result->timeout = true;
+	}
+	else
+	{
+		result->latencyUs = (uint32_t)(fp_time_us() - start);
+		result->frame = fp_check_frame(resp, result->respLen, s->addr);
+		if (result->frame == FP_FRAME_OK && resp[FP_PID_INDEX] != PACKET_RESPONSE)
+			result->frame = FP_FRAME_BAD_PID;
+		if (result->frame == FP_FRAME_OK)
+			result->confirm = resp[FP_PAYLOAD_INDEX];
+	}
+	if (result->frame != FP_FRAME_OK || result->confirm != 0x00)
+	{
+		s->failures++;
+		return ESP_FAIL;
+	}
+	s->verified = true;
+	s->verifiedUs = fp_time_us();
+	return ESP_OK;
+}
+
+esp_err_t fp_session_ensure(fp_session_t* s, const fp_transport_t* tp, uint32_t timeoutMs, fp_transact_result_t* result)
+{
+	if (s->verified)
+	{
+		s->reused++;
+		return ESP_OK;
+	}
+	return verify(s, tp, timeoutMs, result);
+}
+
+void fp_session_observe(fp_session_t* s, uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	const fp_transact_result_t* result)
+{
+	if (result->timeout || result->linkError || result->frame != FP_FRAME_OK)
+		return;
+	if (result->confirm == FP_CONFIRM_NEED_PASSWORD && s->password != 0)
+	{
+		fp_session_invalidate(s, FP_SESSION_POWER_CYCLE);
+		return;
+	}
+	if (result->confirm != 0x00)
+		return;
+	if (cmd == CMD_SLEEP)
+	{
+		fp_session_invalidate(s, FP_SESSION_SLEEP);
+	}
+	else if (cmd == CMD_SET_CHIP_ADDR && paramLen >= 4)
+	{
+		memcpy(s->addr, params, 4);
+		build_vfy_frame(s);
+		fp_session_invalidate(s, FP_SESSION_ADDRESS);
+	}
+	else if (cmd == CMD_SET_PWD && paramLen >= 4)
+	{
+		// 新口令本次上电已生效，会话保持
+		s->password = fp_be32(params);
+		build_vfy_frame(s);
+	}
+}
+
+esp_err_t fp_session_transact(fp_session_t* s, const fp_transport_t* tp,
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result)
+{
+	for (int attempt = 0; attempt < 2; attempt++)
+	{
+		if (s->verified)
+			s->reused++;
+		else if (verify(s, tp, timeoutMs, result) != ESP_OK)
+			return ESP_FAIL; // result为验证命令的结果（口令错误为0x13）
+		esp_err_t ok = fp_transact(tp, s->addr, cmd, params, paramLen, resp, respCap, timeoutMs, result);
+		fp_session_observe(s, cmd, params, paramLen, result);
+		if (ok == ESP_OK || result->frame != FP_FRAME_OK || result->confirm != FP_CONFIRM_NEED_PASSWORD)
+			return ok;
+	}
+	return ESP_FAIL;
+}
+
+void fp_session_print_stats(const fp_session_t* s)
+{
+	printf("口令会话（地址%02X%02X%02X%02X）：%s，验证%u次（失败%u次），沿用会话%u次\n",
+		s->addr[0], s->addr[1], s->addr[2], s->addr[3], s->password == 0 ? "无口令" : s->verified ? "已验证" : "未验证",
+		s->verifications, s->failures, s->reused);
+	for (int r = 0; r < FP_SESSION_REASONS; r++)
+	{
+		if (s->invalidations[r] != 0)
+			printf("  失效（%s）%u次\n", kReasonNames[r], s->invalidations[r]);
+	}
+}
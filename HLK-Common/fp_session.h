@@ -0,0 +1,85 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 握手口令会话：设置了口令的模块上电后要先验证口令(0x13)，否则其他命令都回0x21。
+// 每次链路会话只验证一次，之后的命令直接发送；以下事件使会话失效，下一条命令前重新验证：
+//   断电重启   命令被回0x21（模块忘了验证状态），或链路监测从断开恢复时由调用者通知
+//   休眠唤醒   休眠指令成功后（唤醒即重新上电）
+//   地址变更   设置芯片地址(0x15)成功后，验证帧按新地址重新生成
+//   重新连接   串口重新打开时由调用者通知
+// 验证帧在初始化和地址变更时预先组好，验证时直接发送，不再组帧
+
+#define FP_SESSION_VFY_FRAME_LEN (FP_MIN_FRAME_LEN + 4) // 验证口令帧长度（指令码+4字节口令）
+
+// 会话失效原因
+typedef enum
+{
+	FP_SESSION_POWER_CYCLE = 0, // 模块断电重启
+	FP_SESSION_SLEEP,           // 休眠唤醒
+	FP_SESSION_ADDRESS,         // 地址变更
+	FP_SESSION_RECONNECT,       // 链路重新连接
+	FP_SESSION_REASONS
+} fp_session_reason_t;
+
+typedef struct
+{
+	uint8_t addr[4];                                 // 设备地址
+	uint32_t password;                               // 口令（0表示模块不需要验证）
+	uint8_t vfyFrame[FP_SESSION_VFY_FRAME_LEN];      // 预先组好的验证口令帧
+	bool verified;                                   // 本次会话已验证
+	uint64_t verifiedUs;                             // 最近一次验证成功的时刻
+	// 统计
+	uint32_t verifications;                          // 发出的验证次数
+	uint32_t failures;                               // 验证失败次数（口令错误或无应答）
+	uint32_t reused;                                 // 直接沿用会话的命令数
+	uint32_t invalidations[FP_SESSION_REASONS];      // 各原因的失效次数
+} fp_session_t;
+
+/**
+ * @brief 初始化会话并预先组好验证帧
+ * @param s 会话
+ * @param addr 设备地址
+ * @param password 口令（0表示不需要验证，所有命令直接发送）
+ */
+void fp_session_init(fp_session_t* s, const uint8_t addr[4], uint32_t password);
+
+/**
+ * @brief 会话失效（下一条命令前重新验证）
+ */
+void fp_session_invalidate(fp_session_t* s, fp_session_reason_t reason);
+
+/**
+ * @brief 确保会话已验证（已验证时不发帧）
+ * @param s 会话
+ * @param tp 传输接口
+ * @param timeoutMs 验证应答超时
+ * @param result 输出验证命令的交互结果（已验证时不填写）
+ * @return 已验证或验证成功返回ESP_OK
+ */
+esp_err_t fp_session_ensure(fp_session_t* s, const fp_transport_t* tp, uint32_t timeoutMs, fp_transact_result_t* result);
+
+/**
+ * @brief 按一次命令交互的结果更新会话（休眠、地址变更、0x21）
+ * @param s 会话
+ * @param cmd 指令码
+ * @param params 指令参数
+ * @param paramLen 参数长度
+ * @param result 交互结果
+ */
+void fp_session_observe(fp_session_t* s, uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	const fp_transact_result_t* result);
+
+/**
+ * @brief 在会话内发送一条命令（参数同fp_transact）
+ *        需要时先验证口令；命令被回0x21时重新验证并重发一次；
+ *        验证失败时result为验证命令的交互结果
+ */
+esp_err_t fp_session_transact(fp_session_t* s, const fp_transport_t* tp,
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result);
+
+/**
+ * @brief 打印会话统计
+ */
+void fp_session_print_stats(const fp_session_t* s);
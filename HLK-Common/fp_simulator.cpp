@@ -0,0 +1,342 @@
+﻿#include <string.h>
+#include <chrono>
+#include <thread>
+#include "fp_simulator.h"
+
+void fp_sim_init(fp_sim_t* sim, uint16_t capacity)
+{
+	memset(sim, 0, sizeof(*sim));
+	memset(sim->addr, 0xFF, sizeof(sim->addr));
+	sim->capacity = capacity > FP_SIM_MAX_CAPACITY ? FP_SIM_MAX_CAPACITY : capacity;
+	sim->templateSize = 0x0600;
+	sim->scoreLevel = 3;
+	sim->packetSizeCode = 2;
+	sim->baudMultiple = 6;
+	sim->identifyId = 0xFFFF;
+	sim->wakeUs = 30000;
+}
+
+bool fp_sim_occupied(const fp_sim_t* sim, uint16_t id)
+{
+	return id < sim->capacity && (sim->index[id >> 3] & (1 << (id & 7)));
+}
+
+void fp_sim_set_occupied(fp_sim_t* sim, uint16_t id, bool occupied)
+{
+	if (id >= sim->capacity)
+		return;
+	if (occupied)
+		sim->index[id >> 3] |= (uint8_t)(1 << (id & 7));
+	else
+		sim->index[id >> 3] &= (uint8_t)~(1 << (id & 7));
+}
+
+void fp_sim_power_cycle(fp_sim_t* sim)
+{
+	sim->verified = false;
+	sim->asleep = false;
+}
+
+static uint16_t count_occupied(const fp_sim_t* sim)
+{
+	uint16_t n = 0;
+	for (uint16_t id = 0; id < sim->capacity; id++)
+	{
+		n += fp_sim_occupied(sim, id);
+	}
+	return n;
+}
+
+static void put16(uint8_t* p, uint16_t v)
+{
+	p[0] = (uint8_t)(v >> 8);
+	p[1] = (uint8_t)v;
+}
+
+// 识别/搜索命中的ID：优先identifyId，否则取最小的已注册ID，都没有返回0xFFFF
+static uint16_t find_match(const fp_sim_t* sim)
+{
+	if (sim->identifyId != 0xFFFF && fp_sim_occupied(sim, sim->identifyId))
+		return sim->identifyId;
+	for (uint16_t id = 0; id < sim->capacity; id++)
+		if (fp_sim_occupied(sim, id))
+			return id;
+	return 0xFFFF;
+}
+
+// 各命令的模拟处理耗时（微秒），量级参考实测
+static uint32_t service_time(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case CMD_AUTO_IDENTIFY: return 350000;
+	case CMD_AUTO_ENROLL: return 1500000;
+	case CMD_EMPTY: return 200000;
+	case CMD_DELET_CHAR: return 30000;
+	case CMD_GET_IMAGE: return 60000;
+	case CMD_GEN_CHAR: return 40000;
+	case CMD_SEARCH: return 50000;
+	case CMD_READ_SYSPARA:
+	case CMD_READ_INDEX_TABLE:
+	case CMD_VALID_TEMPLATE_NUM: return 3000;
+	default: return 1000;
+	}
+}
+
+uint16_t fp_sim_handle(fp_sim_t* sim, const uint8_t* frame, uint16_t frameLen, uint8_t* out, uint16_t outCap)
+{
+	fp_frame_result_t check = fp_check_frame(frame, frameLen, nullptr);
+	if (check == FP_FRAME_SHORT || check == FP_FRAME_BAD_HEADER || memcmp(frame + FP_ADDR_INDEX, sim->addr, 4) != 0)
+	{
+		return 0; // 不是发给本模块的帧，不应答
+	}
+
+	uint8_t resp[64];
+	uint16_t respLen = 1;
+	resp[0] = 0x00;
+	sim->serviceUs = 0;
+	if (check != FP_FRAME_OK || frame[FP_PID_INDEX] != PACKET_CMD)
+	{
+		sim->badFrames++;
+		resp[0] = 0x01; // 收包有错
+		return fp_build_frame(sim->addr, PACKET_RESPONSE, resp, respLen, out, outCap);
+	}
+
+	uint16_t payloadLen = 0;
+	const uint8_t* payload = fp_frame_payload(frame, &payloadLen);
+	uint8_t cmd = payload[0];
+	const uint8_t* param = payload + 1;
+	uint16_t paramLen = payloadLen - 1;
+	sim->commands++;
+	sim->serviceUs = service_time(cmd);
+	if (sim->asleep)
+	{
+		sim->serviceUs += sim->wakeUs; // 任意命令（或触摸）唤醒模块
+		sim->asleep = false;
+		sim->verified = false;         // 唤醒即重新上电，口令需要重新验证
+	}
+	if (sim->password != 0 && !sim->verified && cmd != CMD_VFY_PWD && cmd != CMD_HANDSHAKE)
+	{
+		sim->pwdRejects++;
+		resp[0] = 0x21; // 未验证口令
+		return fp_build_frame(sim->addr, PACKET_RESPONSE, resp, respLen, out, outCap);
+	}
+
+	uint8_t newAddr[4];
+	bool addrChanged = false;
+	switch (cmd)
+	{
+	case CMD_HANDSHAKE:
+	case CMD_CHECK_SENSOR:
+	case CMD_CANCEL:
+		break;
+	case CMD_SLEEP:
+		sim->asleep = true;
+		break;
+	case CMD_CONTROL_BLN:
+		sim->lastLedLen = (uint8_t)(paramLen > sizeof(sim->lastLed) ? sizeof(sim->lastLed) : paramLen);
+		memcpy(sim->lastLed, param, sim->lastLedLen);
+		break;
+	case CMD_GET_IMAGE:
+		resp[0] = sim->fingerPresent ? 0x00 : 0x02; // 0x02：传感器上无手指
+		break;
+	case CMD_READ_SYSPARA:
+		put16(resp + 1, 0);                           // 状态寄存器
+		put16(resp + 3, sim->templateSize);           // 模板大小
+		put16(resp + 5, sim->capacity);               // 指纹库大小
+		put16(resp + 7, sim->scoreLevel);             // 安全等级
+		memcpy(resp + 9, sim->addr, 4);               // 设备地址
+		put16(resp + 13, sim->packetSizeCode);        // 数据包大小
+		put16(resp + 15, sim->baudMultiple);          // 波特率
+		respLen = 17;
+		break;
+	case CMD_VALID_TEMPLATE_NUM:
+		put16(resp + 1, count_occupied(sim));
+		respLen = 3;
+		break;
+	case CMD_READ_INDEX_TABLE:
+	{
+		uint8_t page = paramLen >= 1 ? param[0] : 0;
+		memset(resp + 1, 0, 32);
+		for (uint16_t i = 0; i < 32; i++)
+		{
+			uint32_t byteIndex = (uint32_t)page * 32 + i;
+			if (byteIndex < (uint32_t)(sim->capacity + 7) / 8)
+				resp[1 + i] = sim->index[byteIndex];
+		}
+		respLen = 33;
+		break;
+	}
+	case CMD_AUTO_ENROLL:
+	{
+		uint16_t id = paramLen >= 2 ? fp_be16(param) : 0xFFFF;
+		uint16_t flags = paramLen >= 5 ? fp_be16(param + 3) : 0;
+		if (id >= sim->capacity)
+			resp[0] = 0x0B; // 地址超出指纹库范围
+		else if (fp_sim_occupied(sim, id) && !(flags & (1 << 3)))
+			resp[0] = 0x22; // 指纹模板非空
+		else
+			fp_sim_set_occupied(sim, id, true);
+		resp[1] = 0x06; // 阶段：存储模板
+		resp[2] = 0xF2;
+		respLen = 3;
+		break;
+	}
+	case CMD_AUTO_IDENTIFY:
+	{
+		uint16_t found = find_match(sim);
+		resp[0] = found == 0xFFFF ? 0x09 : 0x00; // 0x09：没搜索到指纹
+		resp[1] = 0x05;                          // 阶段：搜索结果
+		put16(resp + 2, found == 0xFFFF ? 0 : found);
+		put16(resp + 4, found == 0xFFFF ? 0 : 100); // 比对得分
+		respLen = 6;
+		break;
+	}
+	case CMD_GEN_CHAR:
+		resp[0] = sim->fingerPresent ? 0x00 : 0x15; // 0x15：缓冲区内没有有效原始图
+		break;
+	case CMD_REG_MODEL:
+		break;
+	case CMD_STORE_CHAR:
+	{
+		uint16_t id = paramLen >= 3 ? fp_be16(param + 1) : 0xFFFF;
+		if (id >= sim->capacity)
+			resp[0] = 0x0B; // 地址超出指纹库范围
+		else
+			fp_sim_set_occupied(sim, id, true);
+		break;
+	}
+	case CMD_SEARCH:
+	{
+		uint16_t found = find_match(sim);
+		resp[0] = found == 0xFFFF ? 0x09 : 0x00; // 0x09：没搜索到指纹
+		put16(resp + 1, found == 0xFFFF ? 0 : found);
+		put16(resp + 3, found == 0xFFFF ? 0 : 100);
+		respLen = 5;
+		break;
+	}
+	case CMD_DELET_CHAR:
+	{
+		uint16_t id = paramLen >= 2 ? fp_be16(param) : 0xFFFF;
+		uint16_t count = paramLen >= 4 ? fp_be16(param + 2) : 0;
+		if (id >= sim->capacity || count == 0)
+		{
+			resp[0] = 0x10; // 删除模板失败
+			break;
+		}
+		for (uint16_t i = 0; i < count && id + i < sim->capacity; i++)
+			fp_sim_set_occupied(sim, id + i, false);
+		break;
+	}
+	case CMD_EMPTY:
+		memset(sim->index, 0, sizeof(sim->index));
+		break;
+	case CMD_VFY_PWD:
+		if (paramLen < 4 || fp_be32(param) != sim->password)
+			resp[0] = 0x13; // 口令不正确
+		else
+			sim->verified = true;
+		break;
+	case CMD_SET_PWD:
+		if (paramLen < 4)
+			resp[0] = 0x01;
+		else
+			sim->password = fp_be32(param);
+		break;
+	case CMD_SET_CHIP_ADDR:
+		if (paramLen < 4)
+		{
+			resp[0] = 0x01;
+			break;
+		}
+		memcpy(newAddr, param, 4); // 应答仍用旧地址发出，之后按新地址接收
+		addrChanged = true;
+		break;
+	default:
+		resp[0] = 0x01; // 不支持的命令按收包错误应答
+		break;
+	}
+
+	uint16_t n = fp_build_frame(sim->addr, PACKET_RESPONSE, resp, respLen, out, outCap);
+	if (addrChanged)
+		memcpy(sim->addr, newAddr, 4);
+	return n;
+}
+
+// ========================== 模拟器传输 ==========================
+// 已读出的应答移出缓冲区，只留未读完的帧（读了一半的帧仍算排队中）
+static void compact_tx(fp_sim_link_t* link)
+{
+	uint16_t keep = (uint16_t)(link->txLen - link->txPos);
+	memmove(link->tx, link->tx + link->txPos, keep);
+	uint8_t frames = 0;
+	for (uint8_t i = 0; i < link->txFrames; i++)
+	{
+		if (link->txEnd[i] > link->txPos)
+			link->txEnd[frames++] = (uint16_t)(link->txEnd[i] - link->txPos);
+	}
+	link->txFrames = frames;
+	link->txLen = keep;
+	link->txPos = 0;
+}
+
+static int sim_write(void* ctx, const uint8_t* data, uint16_t len)
+{
+	fp_sim_link_t* link = (fp_sim_link_t*)ctx;
+	for (uint16_t i = 0; i < len; i++)
+	{
+		if (link->rxLen == 0 && data[i] != FP_HEADER_0)
+			continue; // 丢弃包头前的杂散字节
+		link->rx[link->rxLen++] = data[i];
+		if (link->rxLen < FP_PAYLOAD_INDEX)
+			continue;
+		uint16_t total = fp_be16(link->rx + FP_LEN_INDEX) + FP_PAYLOAD_INDEX;
+		if (total > sizeof(link->rx) || link->rxLen == sizeof(link->rx))
+		{
+			link->rxLen = 0;
+			continue;
+		}
+		if (link->rxLen < total)
+			continue;
+
+		compact_tx(link);
+		uint16_t n = 0;
+		if (link->txFrames < FP_SIM_LINK_PIPELINE)
+			n = fp_sim_handle(link->sim, link->rx, total, link->tx + link->txLen, FP_MAX_FRAME_LEN);
+		link->txLen += n;
+		if (n > 0)
+			link->txEnd[link->txFrames++] = link->txLen;
+		link->rxLen = 0;
+		if (link->realTime && n > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(link->sim->serviceUs));
+		}
+	}
+	return len;
+}
+
+static int sim_read(void* ctx, uint8_t* buf, uint16_t cap, uint32_t timeoutMs)
+{
+	fp_sim_link_t* link = (fp_sim_link_t*)ctx;
+	if (link->txPos >= link->txLen)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(timeoutMs)); // 模块不应答，等满超时
+		return 0;
+	}
+	uint16_t n = link->txLen - link->txPos;
+	if (n > cap)
+		n = cap;
+	memcpy(buf, link->tx + link->txPos, n);
+	link->txPos += n;
+	return n;
+}
+
+void fp_transport_from_sim(fp_transport_t* tp, fp_sim_link_t* link, fp_sim_t* sim, bool realTime)
+{
+	memset(link, 0, sizeof(*link));
+	link->sim = sim;
+	link->realTime = realTime;
+	tp->ctx = link;
+	tp->write = sim_write;
+	tp->read = sim_read;
+}
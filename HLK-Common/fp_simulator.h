@@ -0,0 +1,87 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 指纹模块模拟器：按手册行为应答命令包，用于回放、回归测试和压测，不需要硬件
+// 模拟器本身是纯函数式的（输入命令帧、输出应答帧），处理耗时通过serviceUs给出，
+// 由调用者决定是否真实等待
+
+#define FP_SIM_MAX_CAPACITY 4096 // 模拟的最大指纹库容量（16页索引表，超过流水线深度，能触发深度减半）
+
+typedef struct
+{
+	uint8_t addr[4];                           // 设备地址
+	uint16_t capacity;                         // 指纹库容量
+	uint16_t templateSize;                     // 模板大小（字节）
+	uint16_t scoreLevel;                       // 安全等级
+	uint8_t packetSizeCode;                    // 数据包大小（0=32,1=64,2=128,3=256）
+	uint8_t baudMultiple;                      // 波特率（9600的倍数）
+	uint8_t index[FP_SIM_MAX_CAPACITY / 8];    // 指纹库占用位图
+	bool fingerPresent;                        // 传感器上是否有手指
+	uint16_t identifyId;                       // 自动识别命中的ID（0xFFFF表示命中最小已注册ID）
+	bool asleep;                               // 是否处于休眠
+	uint32_t wakeUs;                           // 休眠唤醒耗时（微秒）
+	uint32_t serviceUs;                        // 最近一条命令的模拟处理耗时（微秒）
+	uint8_t lastLed[16];                       // 最近一次LED控制参数
+	uint8_t lastLedLen;                        // LED控制参数长度
+	uint32_t password;                         // 握手口令（0表示不需要验证）
+	bool verified;                             // 本次上电后是否已验证口令
+	// 统计
+	uint32_t commands;                         // 处理的命令数
+	uint32_t badFrames;                        // 校验失败的命令帧数
+	uint32_t pwdRejects;                       // 未验证口令被拒绝的命令数
+} fp_sim_t;
+
+/**
+ * @brief 初始化模拟器（默认地址FFFFFFFF、57600波特率、128字节数据包）
+ * @param sim 模拟器
+ * @param capacity 指纹库容量（不超过FP_SIM_MAX_CAPACITY）
+ */
+void fp_sim_init(fp_sim_t* sim, uint16_t capacity);
+
+/**
+ * @brief 处理一帧命令并生成应答
+ * @param sim 模拟器
+ * @param frame 命令帧
+ * @param frameLen 命令帧长度
+ * @param out 应答缓冲区
+ * @param outCap 应答缓冲区容量
+ * @return 应答帧长度，地址不匹配等模块不应答的情况返回0
+ */
+uint16_t fp_sim_handle(fp_sim_t* sim, const uint8_t* frame, uint16_t frameLen, uint8_t* out, uint16_t outCap);
+
+/**
+ * @brief 查询/设置指纹库中某个ID是否已注册
+ */
+bool fp_sim_occupied(const fp_sim_t* sim, uint16_t id);
+void fp_sim_set_occupied(fp_sim_t* sim, uint16_t id, bool occupied);
+
+/**
+ * @brief 模拟模块断电重启（口令验证状态和休眠状态清除，指纹库、口令、地址保留）
+ */
+void fp_sim_power_cycle(fp_sim_t* sim);
+
+// ========================== 模拟器传输 ==========================
+// 把模拟器包装成fp_transport_t，写入命令帧后即可读到应答，便于直接驱动上层模块
+// 还没读完的应答达到FP_SIM_LINK_PIPELINE帧时丢弃后续命令，模拟模块接收缓冲溢出
+#define FP_SIM_LINK_PIPELINE 4
+typedef struct
+{
+	fp_sim_t* sim;                 // 模拟器
+	bool realTime;                 // 是否按serviceUs真实等待
+	uint8_t rx[FP_MAX_FRAME_LEN];  // 命令组帧缓冲
+	uint16_t rxLen;
+	uint8_t tx[FP_MAX_FRAME_LEN * FP_SIM_LINK_PIPELINE]; // 待读出的应答（连续发送的命令依次排队）
+	uint16_t txLen;
+	uint16_t txPos;
+	uint8_t txFrames;              // 还没读完的应答帧数
+	uint16_t txEnd[FP_SIM_LINK_PIPELINE]; // 各应答帧在tx中的结束位置
+} fp_sim_link_t;
+
+/**
+ * @brief 以模拟器作为传输
+ * @param tp 输出传输接口
+ * @param link 模拟器链路（生命周期由调用者保证）
+ * @param sim 模拟器
+ * @param realTime 是否按模拟处理耗时真实等待
+ */
+void fp_transport_from_sim(fp_transport_t* tp, fp_sim_link_t* link, fp_sim_t* sim, bool realTime);
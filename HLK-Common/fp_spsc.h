@@ -0,0 +1,201 @@
+﻿#pragma once
+#include <atomic>
+#include <string.h>
+#include "fp_protocol.h"
+
+// 单生产者/单消费者无锁队列：串口接收中断（或接收线程）写入，协议任务读取
+// 只靠两个原子下标同步，不关中断、不加锁；生产者和消费者的下标各占一条缓存行，避免伪共享
+// 生产者一侧另外缓存一份消费者下标（消费者一侧同理），队列不满/不空时不用读对方的缓存行
+//
+// 用法约定：
+//   同一队列只能有一个生产者和一个消费者（中断和任务、两个线程均可）
+//   MCU上要求std::atomic<uint32_t>为无锁实现（Cortex-M3及以上满足），中断里只调用push/write
+//   结构体按缓存行对齐，请静态分配或放在栈上（C++17之前new不保证超对齐）
+//
+// 容量估算：写FLASH期间协议任务可能几十毫秒不取数据，57600波特率约5.8字节/毫秒，
+// 接收字节队列取1024字节可覆盖约170毫秒的停顿
+
+#ifndef FP_CACHE_LINE
+#define FP_CACHE_LINE 64         // 缓存行大小（无缓存的MCU可定义为4，省去填充）
+#endif
+#define FP_SPSC_RX_BYTES 1024    // 接收字节队列默认容量
+#define FP_SPSC_FRAMES 8         // 帧队列默认容量
+
+template <typename T, uint32_t N>
+struct fp_spsc_t
+{
+	static_assert(N >= 2 && (N & (N - 1)) == 0, "容量必须是2的幂");
+
+	// 生产者缓存行
+	alignas(FP_CACHE_LINE) std::atomic<uint32_t> head; // 下一个写入位置（只由生产者写）
+	uint32_t tailCache;                                // 生产者看到的消费者下标
+	uint32_t dropped;                                  // 队列满丢弃的元素数（只由生产者写）
+	// 消费者缓存行
+	alignas(FP_CACHE_LINE) std::atomic<uint32_t> tail; // 下一个读取位置（只由消费者写）
+	uint32_t headCache;                                // 消费者看到的生产者下标
+	// 数据
+	alignas(FP_CACHE_LINE) T items[N];
+};
+
+/**
+ * @brief 初始化队列（必须在生产者和消费者开始工作之前调用）
+ */
+template <typename T, uint32_t N>
+inline void fp_spsc_init(fp_spsc_t<T, N>* q)
+{
+	q->head.store(0, std::memory_order_relaxed);
+	q->tail.store(0, std::memory_order_relaxed);
+	q->tailCache = 0;
+	q->headCache = 0;
+	q->dropped = 0;
+}
+
+/**
+ * @brief 生产者：写入一个元素
+ * @return 队列满时返回false并计入dropped
+ */
+template <typename T, uint32_t N>
+inline bool fp_spsc_push(fp_spsc_t<T, N>* q, const T& item)
+{
+	uint32_t head = q->head.load(std::memory_order_relaxed);
+	if (head - q->tailCache == N)
+	{
+		q->tailCache = q->tail.load(std::memory_order_acquire);
+		if (head - q->tailCache == N)
+		{
+			q->dropped++;
+			return false;
+		}
+	}
+	q->items[head & (N - 1)] = item;
+	q->head.store(head + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * @brief 生产者：批量写入（接收中断一次搬运整个FIFO）
+ * @return 实际写入个数，写不下的部分计入dropped
+ */
+template <typename T, uint32_t N>
+inline uint32_t fp_spsc_write(fp_spsc_t<T, N>* q, const T* data, uint32_t count)
+{
+	uint32_t head = q->head.load(std::memory_order_relaxed);
+	uint32_t space = N - (head - q->tailCache);
+	if (space < count)
+	{
+		q->tailCache = q->tail.load(std::memory_order_acquire);
+		space = N - (head - q->tailCache);
+	}
+	uint32_t n = count < space ? count : space;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		q->items[(head + i) & (N - 1)] = data[i];
+	}
+	q->head.store(head + n, std::memory_order_release);
+	q->dropped += count - n;
+	return n;
+}
+
+/**
+ * @brief 生产者：当前可写入的元素个数（不想丢数据的生产者先查空间再写）
+ */
+template <typename T, uint32_t N>
+inline uint32_t fp_spsc_space(fp_spsc_t<T, N>* q)
+{
+	q->tailCache = q->tail.load(std::memory_order_acquire);
+	return N - (q->head.load(std::memory_order_relaxed) - q->tailCache);
+}
+
+/**
+ * @brief 消费者：取出一个元素
+ * @return 队列空返回false
+ */
+template <typename T, uint32_t N>
+inline bool fp_spsc_pop(fp_spsc_t<T, N>* q, T* item)
+{
+	uint32_t tail = q->tail.load(std::memory_order_relaxed);
+	if (tail == q->headCache)
+	{
+		q->headCache = q->head.load(std::memory_order_acquire);
+		if (tail == q->headCache)
+			return false;
+	}
+	*item = q->items[tail & (N - 1)];
+	q->tail.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+/**
+ * @brief 消费者：批量读取（直接喂给fp_parser_feed）
+ * @return 实际读取个数
+ */
+template <typename T, uint32_t N>
+inline uint32_t fp_spsc_read(fp_spsc_t<T, N>* q, T* out, uint32_t cap)
+{
+	uint32_t tail = q->tail.load(std::memory_order_relaxed);
+	uint32_t avail = q->headCache - tail;
+	if (avail < cap)
+	{
+		q->headCache = q->head.load(std::memory_order_acquire);
+		avail = q->headCache - tail;
+	}
+	uint32_t n = avail < cap ? avail : cap;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		out[i] = q->items[(tail + i) & (N - 1)];
+	}
+	q->tail.store(tail + n, std::memory_order_release);
+	return n;
+}
+
+/**
+ * @brief 当前元素个数（任一侧调用都只是近似值）
+ */
+template <typename T, uint32_t N>
+inline uint32_t fp_spsc_size(const fp_spsc_t<T, N>* q)
+{
+	return q->head.load(std::memory_order_acquire) - q->tail.load(std::memory_order_acquire);
+}
+
+// ========================== 帧队列 ==========================
+// 解析后的完整帧，解析器回调里写入，协议任务取出；容量按最大帧长取模板参数
+template <uint16_t Cap>
+struct fp_frame_buf_t
+{
+	uint16_t len;      // 帧长度
+	uint8_t data[Cap]; // 帧数据
+};
+
+typedef fp_frame_buf_t<FP_MAX_FRAME_LEN> fp_spsc_frame_t;
+
+typedef fp_spsc_t<uint8_t, FP_SPSC_RX_BYTES> fp_rx_byte_queue_t;
+typedef fp_spsc_t<fp_spsc_frame_t, FP_SPSC_FRAMES> fp_rx_frame_queue_t;
+
+/**
+ * @brief 生产者：写入一帧（帧队列的元素较大，直接在队列槽位里拷贝，不经过临时变量）
+ * @return 队列满或帧过长返回false
+ */
+template <uint16_t Cap, uint32_t N>
+inline bool fp_spsc_push_frame(fp_spsc_t<fp_frame_buf_t<Cap>, N>* q, const uint8_t* frame, uint16_t len)
+{
+	uint32_t head = q->head.load(std::memory_order_relaxed);
+	if (len > Cap)
+	{
+		q->dropped++;
+		return false;
+	}
+	if (head - q->tailCache == N)
+	{
+		q->tailCache = q->tail.load(std::memory_order_acquire);
+		if (head - q->tailCache == N)
+		{
+			q->dropped++;
+			return false;
+		}
+	}
+	fp_frame_buf_t<Cap>* slot = &q->items[head & (N - 1)];
+	slot->len = len;
+	memcpy(slot->data, frame, len);
+	q->head.store(head + 1, std::memory_order_release);
+	return true;
+}
@@ -0,0 +1,134 @@
+﻿#include <stdio.h>
+#include "fp_dispatch.h"
+#include "fp_status.h"
+
+static const char* const kConfirmMessages[FP_CONFIRM_MAX + 1] = {
+	"指令执行完毕或OK",                       // 0x00
+	"数据包接收错误",                         // 0x01
+	"传感器上没有手指",                       // 0x02
+	"录入指纹图像失败",                       // 0x03
+	"指纹图像太干、太淡而生不成特征",         // 0x04
+	"指纹图像太湿、太糊而生不成特征",         // 0x05
+	"指纹图像太乱而生不成特征",               // 0x06
+	"指纹图像正常，但特征点太少而生不成特征", // 0x07
+	"指纹不匹配",                             // 0x08
+	"没搜索到指纹",                           // 0x09
+	"特征合并失败",                           // 0x0A
+	"访问指纹库时地址序号超出指纹库范围",     // 0x0B
+	"从指纹库读模板出错或无效",               // 0x0C
+	"上传特征失败",                           // 0x0D
+	"模块不能接收后续数据包",                 // 0x0E
+	"上传图像失败",                           // 0x0F
+	"删除模板失败",                           // 0x10
+	"清空指纹库失败",                         // 0x11
+	"不能进入低功耗状态",                     // 0x12
+	"口令不正确",                             // 0x13
+	"系统复位失败",                           // 0x14
+	"缓冲区内没有有效原始图而生不成图像",     // 0x15
+	"在线升级失败",                           // 0x16
+	"残留指纹或两次采集之间手指没有移动过",   // 0x17
+	"读写FLASH出错",                          // 0x18
+	"随机数生成失败",                         // 0x19
+	"无效寄存器号",                           // 0x1A
+	"寄存器设定内容错误",                     // 0x1B
+	"记事本页码指定错误",                     // 0x1C
+	"端口操作失败",                           // 0x1D
+	"自动注册失败",                           // 0x1E
+	"指纹库满",                               // 0x1F
+	"设备地址错误",                           // 0x20
+	"密码有误",                               // 0x21
+	"指纹模板非空",                           // 0x22
+	"指纹模板为空",                           // 0x23
+	"指纹库为空",                             // 0x24
+	"录入次数设置错误",                       // 0x25
+	"超时",                                   // 0x26
+	"指纹已存在",                             // 0x27
+	"指纹模板有关联",                         // 0x28
+	"传感器初始化失败",                       // 0x29
+	"模组信息非空",                           // 0x2A
+	"模组信息为空",                           // 0x2B
+	"OTP操作失败",                            // 0x2C
+	"秘钥生成失败",                           // 0x2D
+	"秘钥不存在",                             // 0x2E
+	"安全算法执行失败",                       // 0x2F
+	"安全算法加解密结果有误",                 // 0x30
+	"功能与加密等级不匹配",                   // 0x31
+	"秘钥已锁定",                             // 0x32
+	"图像面积小",                             // 0x33
+	"图像不可用",                             // 0x34
+	"非法数据",                               // 0x35
+};
+
+static const char* const kFrameMessages[] = {
+	"帧正确", "帧长度不足", "包头错误", "设备地址不匹配", "包标识错误", "长度字段错误", "校验和错误",
+};
+
+// 自动注册和自动识别的应答带阶段字节（失败应答长度够时也带）
+static void take_enroll_stage(void* user, const fp_decoded_t* d)
+{
+	if (d->bound)
+		((fp_status_t*)user)->stage = d->enroll.stage();
+}
+
+static void take_identify_stage(void* user, const fp_decoded_t* d)
+{
+	if (d->bound)
+		((fp_status_t*)user)->stage = d->identify.stage();
+}
+
+fp_status_t fp_status_from_transact(uint8_t cmd, const fp_transact_result_t* result, const uint8_t* resp)
+{
+	fp_status_t st = { FP_SOURCE_MODULE, 0, cmd, 0 };
+	if (result->linkError)
+	{
+		st.source = FP_SOURCE_LINK;
+	}
+	else if (result->timeout)
+	{
+		st.source = FP_SOURCE_TIMEOUT;
+	}
+	else if (result->frame != FP_FRAME_OK)
+	{
+		st.source = FP_SOURCE_FRAME;
+		st.code = (uint8_t)result->frame;
+	}
+	else
+	{
+		st.code = result->confirm;
+		fp_dispatch_t d;
+		fp_dispatch_init(&d, &st);
+		fp_dispatch_on(&d, CMD_AUTO_ENROLL, take_enroll_stage);
+		fp_dispatch_on(&d, CMD_AUTO_IDENTIFY, take_identify_stage);
+		fp_dispatch(&d, cmd, resp, result->respLen);
+	}
+	return st;
+}
+
+const char* fp_confirm_message(uint8_t code)
+{
+	return code <= FP_CONFIRM_MAX ? kConfirmMessages[code] : "未定义的确认码";
+}
+
+const char* fp_status_format(fp_status_t st, char* buf, size_t cap)
+{
+	switch (st.source)
+	{
+	case FP_SOURCE_LINK:
+		snprintf(buf, cap, "0x%02X: 链路读写错误", st.cmd);
+		break;
+	case FP_SOURCE_TIMEOUT:
+		snprintf(buf, cap, "0x%02X: 等待应答超时", st.cmd);
+		break;
+	case FP_SOURCE_FRAME:
+		snprintf(buf, cap, "0x%02X: 应答帧%s", st.cmd,
+			st.code < sizeof(kFrameMessages) / sizeof(kFrameMessages[0]) ? kFrameMessages[st.code] : "错误");
+		break;
+	default:
+		if (st.stage != 0)
+			snprintf(buf, cap, "0x%02X 阶段%02X: 0x%02X %s", st.cmd, st.stage, st.code, fp_confirm_message(st.code));
+		else
+			snprintf(buf, cap, "0x%02X: 0x%02X %s", st.cmd, st.code, fp_confirm_message(st.code));
+		break;
+	}
+	return buf;
+}
@@ -0,0 +1,135 @@
+﻿#pragma once
+#include "fp_transport.h"
+
+// 确认码解码与状态类型
+// esp_err_t只有成败两种取值，调用者分不清"无手指"、"未搜索到"和"校验和错误"；
+// fp_status_t用4字节带回来源、确认码、指令码和阶段，热路径只查constexpr属性表，
+// 提示文字只在打印日志时按需查表
+
+// 常用确认码
+#define FP_CONFIRM_OK 0x00             // 指令执行完毕或OK
+#define FP_CONFIRM_PACKET_ERROR 0x01   // 数据包接收错误
+#define FP_CONFIRM_NO_FINGER 0x02      // 传感器上没有手指
+#define FP_CONFIRM_NOT_MATCH 0x08      // 指纹不匹配
+#define FP_CONFIRM_NOT_FOUND 0x09      // 没搜索到指纹
+#define FP_CONFIRM_OUT_OF_RANGE 0x0B   // 地址序号超出指纹库范围
+#define FP_CONFIRM_BAD_PASSWORD 0x13   // 口令不正确
+#define FP_CONFIRM_NEED_PASSWORD 0x21  // 密码有误（上电后未验证口令）
+#define FP_CONFIRM_LIBRARY_FULL 0x1F   // 指纹库满
+#define FP_CONFIRM_NOT_EMPTY 0x22      // 指纹模板非空
+#define FP_CONFIRM_EMPTY 0x23          // 指纹模板为空
+#define FP_CONFIRM_TIMEOUT 0x26        // 超时
+#define FP_CONFIRM_DUPLICATE 0x27      // 指纹已存在
+#define FP_CONFIRM_MAX 0x35            // 手册定义的最大确认码
+
+// 确认码属性
+#define FP_CONFIRM_F_RESULT 0x01       // 确定的业务结果（不匹配、未搜索到等），不是故障
+#define FP_CONFIRM_F_RETRY_NOW 0x02    // 重发同一条命令即可（传输错误）
+#define FP_CONFIRM_F_RETRY_USER 0x04   // 需要用户重新按手指后再试
+#define FP_CONFIRM_F_FATAL 0x08        // 参数、存储或配置错误，重试无意义
+
+// 按确认码索引的属性表，超出范围的确认码视为FATAL
+static constexpr uint8_t kFpConfirmFlags[FP_CONFIRM_MAX + 1] = {
+	0,                                                                      // 0x00 成功
+	FP_CONFIRM_F_RETRY_NOW,                                                 // 0x01 收包有错
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x02 无手指
+	FP_CONFIRM_F_RETRY_USER, FP_CONFIRM_F_RETRY_USER, FP_CONFIRM_F_RETRY_USER, // 0x03-0x05 采图失败、太干、太湿
+	FP_CONFIRM_F_RETRY_USER, FP_CONFIRM_F_RETRY_USER,                       // 0x06-0x07 太乱、特征点太少
+	FP_CONFIRM_F_RESULT, FP_CONFIRM_F_RESULT,                               // 0x08-0x09 不匹配、未搜索到
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x0A 特征合并失败
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,                                 // 0x0B-0x0C 地址越界、读模板出错
+	FP_CONFIRM_F_RETRY_NOW, FP_CONFIRM_F_RETRY_NOW, FP_CONFIRM_F_RETRY_NOW, // 0x0D-0x0F 上传特征失败、不能接收后续包、上传图像失败
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,                                 // 0x10-0x11 删除失败、清空失败
+	FP_CONFIRM_F_RETRY_NOW,                                                 // 0x12 不能进入低功耗
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,                                 // 0x13-0x14 口令不正确、复位失败
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x15 无有效原始图
+	FP_CONFIRM_F_FATAL,                                                     // 0x16 在线升级失败
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x17 残留指纹或手指未移动
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_RETRY_NOW,                             // 0x18-0x19 读写FLASH出错、随机数失败
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,             // 0x1A-0x1C 寄存器号、寄存器内容、记事本页码
+	FP_CONFIRM_F_RETRY_NOW,                                                 // 0x1D 端口操作失败
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x1E 自动注册失败
+	FP_CONFIRM_F_RESULT,                                                    // 0x1F 指纹库满
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,                                 // 0x20-0x21 地址错误、密码有误
+	FP_CONFIRM_F_RESULT, FP_CONFIRM_F_RESULT, FP_CONFIRM_F_RESULT,          // 0x22-0x24 模板非空、模板为空、库为空
+	FP_CONFIRM_F_FATAL,                                                     // 0x25 录入次数设置错误
+	FP_CONFIRM_F_RETRY_USER,                                                // 0x26 超时（等手指超时）
+	FP_CONFIRM_F_RESULT, FP_CONFIRM_F_RESULT,                               // 0x27-0x28 指纹已存在、模板有关联
+	FP_CONFIRM_F_FATAL,                                                     // 0x29 传感器初始化失败
+	FP_CONFIRM_F_RESULT, FP_CONFIRM_F_RESULT,                               // 0x2A-0x2B 模组信息非空、为空
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,             // 0x2C-0x2E OTP、秘钥生成、秘钥不存在
+	FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL, FP_CONFIRM_F_FATAL,             // 0x2F-0x31 安全算法、加解密结果、加密等级
+	FP_CONFIRM_F_FATAL,                                                     // 0x32 秘钥已锁定
+	FP_CONFIRM_F_RETRY_USER, FP_CONFIRM_F_RETRY_USER,                       // 0x33-0x34 图像面积小、图像不可用
+	FP_CONFIRM_F_FATAL,                                                     // 0x35 非法数据
+};
+
+constexpr uint8_t fp_confirm_flags(uint8_t code)
+{
+	return code <= FP_CONFIRM_MAX ? kFpConfirmFlags[code] : FP_CONFIRM_F_FATAL;
+}
+
+// 状态来源
+typedef enum
+{
+	FP_SOURCE_MODULE = 0,  // 模块应答，code为确认码
+	FP_SOURCE_FRAME,       // 应答帧校验失败，code为fp_frame_result_t
+	FP_SOURCE_TIMEOUT,     // 等待应答超时
+	FP_SOURCE_LINK         // 链路读写错误
+} fp_status_source_t;
+
+// 重试建议
+typedef enum
+{
+	FP_RETRY_NONE = 0,     // 成功或确定的业务结果，不重试
+	FP_RETRY_IMMEDIATE,    // 传输类错误，可直接重发
+	FP_RETRY_AFTER_USER,   // 需要用户重新按手指
+	FP_RETRY_NEVER         // 重试无意义
+} fp_retry_t;
+
+typedef struct
+{
+	uint8_t source; // 来源（fp_status_source_t）
+	uint8_t code;   // 确认码或帧错误码
+	uint8_t cmd;    // 指令码
+	uint8_t stage;  // 自动注册/识别的阶段（其他命令为0）
+} fp_status_t;
+
+/**
+ * @brief 由一次命令交互的结果生成状态
+ * @param cmd 指令码
+ * @param result 交互结果
+ * @param resp 应答帧（可为nullptr）
+ */
+fp_status_t fp_status_from_transact(uint8_t cmd, const fp_transact_result_t* result, const uint8_t* resp);
+
+constexpr fp_status_t fp_status_make(uint8_t cmd, uint8_t code, uint8_t stage)
+{
+	return fp_status_t{ FP_SOURCE_MODULE, code, cmd, stage };
+}
+
+constexpr bool fp_status_ok(fp_status_t st)
+{
+	return st.source == FP_SOURCE_MODULE && st.code == FP_CONFIRM_OK;
+}
+
+constexpr fp_retry_t fp_status_retry(fp_status_t st)
+{
+	return st.source != FP_SOURCE_MODULE ? FP_RETRY_IMMEDIATE
+		: st.code == FP_CONFIRM_OK ? FP_RETRY_NONE
+		: (fp_confirm_flags(st.code) & FP_CONFIRM_F_RETRY_NOW) ? FP_RETRY_IMMEDIATE
+		: (fp_confirm_flags(st.code) & FP_CONFIRM_F_RETRY_USER) ? FP_RETRY_AFTER_USER
+		: (fp_confirm_flags(st.code) & FP_CONFIRM_F_RESULT) ? FP_RETRY_NONE
+		: FP_RETRY_NEVER;
+}
+
+/**
+ * @brief 确认码的提示文字（只在需要显示时调用）
+ */
+const char* fp_confirm_message(uint8_t code);
+
+/**
+ * @brief 把状态格式化为一行文字，如"0x32 阶段05: 0x09 没搜索到指纹"
+ * @return buf
+ */
+const char* fp_status_format(fp_status_t st, char* buf, size_t cap);
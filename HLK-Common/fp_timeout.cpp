@@ -0,0 +1,176 @@
+﻿#include <stdio.h>
+#include <string.h>
+#include "fp_timeout.h"
+#include "fp_dispatch.h"
+
+// 指令的超时参数
+typedef struct
+{
+	uint32_t floorMs;  // 下限
+	uint32_t ceilMs;   // 上限
+	uint32_t initUs;   // 无样本时的处理耗时估计
+	uint16_t respLen;  // 预期应答帧长度
+} limits_t;
+
+// 1:N比对每个模板的耗时估计（微秒），用于按容量放大搜索类指令的初始估计
+#define FP_TIMEOUT_PER_TEMPLATE_US 500
+
+static limits_t limits_of(uint8_t cmd, uint16_t capacity)
+{
+	uint32_t scan = (uint32_t)capacity * FP_TIMEOUT_PER_TEMPLATE_US;
+	switch (cmd)
+	{
+	// 快命令：不读写FLASH、不采图
+	case CMD_CONTROL_BLN:
+	case CMD_CANCEL:
+	case CMD_HANDSHAKE:
+	case CMD_SLEEP:
+	case CMD_VFY_PWD:
+	case CMD_GET_CHIP_SN:
+	case CMD_VALID_TEMPLATE_NUM:
+		return { 20, 500, 5000, FP_MIN_FRAME_LEN + 2 };
+	case CMD_READ_SYSPARA:
+		return { 20, 500, 5000, FP_MIN_FRAME_LEN + 16 };
+	case CMD_READ_INDEX_TABLE:
+		return { 20, 500, 5000, FP_MIN_FRAME_LEN + 32 };
+	// 采图和特征处理
+	case CMD_GET_IMAGE:
+	case CMD_GEN_CHAR:
+	case CMD_REG_MODEL:
+	case CMD_MATCH:
+	case CMD_LOAD_CHAR:
+	case CMD_CHECK_SENSOR:
+		return { 100, 2000, 300000, FP_MIN_FRAME_LEN };
+	// 写FLASH
+	case CMD_STORE_CHAR:
+	case CMD_DELET_CHAR:
+	case CMD_EMPTY:
+	case CMD_WRITE_REG:
+	case CMD_SET_PWD:
+	case CMD_SET_CHIP_ADDR:
+		return { 100, 3000, 300000, FP_MIN_FRAME_LEN };
+	// 1:N搜索
+	case CMD_SEARCH:
+		return { 100, 5000, 100000 + scan, FP_MIN_FRAME_LEN + 4 };
+	// 含等待手指的自动流程
+	case CMD_AUTO_IDENTIFY:
+		return { 1000, 20000, 1000000 + scan, FP_MIN_FRAME_LEN + 5 };
+	case CMD_AUTO_ENROLL:
+		return { 2000, 60000, 5000000, FP_MIN_FRAME_LEN + 2 };
+	// 上传/下载的应答之后还有数据包，这里只管应答本身
+	default:
+		return { 100, 5000, 500000, FP_MIN_FRAME_LEN };
+	}
+}
+
+uint32_t fp_timeout_wire_us(uint32_t baud, uint32_t bytes)
+{
+	return baud == 0 ? 0 : (uint32_t)((uint64_t)bytes * 10 * 1000000 / baud);
+}
+
+void fp_timeout_init(fp_timeout_t* t, uint32_t baud, uint16_t capacity)
+{
+	memset(t, 0, sizeof(*t));
+	t->baud = baud;
+	t->capacity = capacity;
+	t->fingerTimeoutMs = 10000;
+	for (uint8_t c = 0; c < FP_TIMEOUT_CMDS; c++)
+	{
+		limits_t l = limits_of(c, capacity);
+		t->cmd[c].srttUs = l.initUs;
+		t->cmd[c].rttvarUs = l.initUs / 2;
+	}
+}
+
+void fp_timeout_set_baud(fp_timeout_t* t, uint32_t baud)
+{
+	t->baud = baud;
+}
+
+void fp_timeout_set_finger(fp_timeout_t* t, uint32_t fingerTimeoutMs)
+{
+	t->fingerTimeoutMs = fingerTimeoutMs;
+}
+
+// presses为流程中要等手指的次数（自动识别1次，自动注册按参数）
+static uint32_t timeout_ms(fp_timeout_t* t, uint8_t cmd, uint16_t cmdLen, uint8_t presses)
+{
+	if (cmd >= FP_TIMEOUT_CMDS)
+		return limits_of(cmd, t->capacity).ceilMs;
+	limits_t l = limits_of(cmd, t->capacity);
+	if (cmd == CMD_AUTO_IDENTIFY || cmd == CMD_AUTO_ENROLL)
+	{
+		// 用户按手指前模块一直在等，不能按上一位用户的快样本缩短；
+		// 每次按手指都可能等满，上限也跟着放大，否则多次注册会在模块放弃之前被判超时
+		uint64_t fingerFloorMs = (uint64_t)presses * t->fingerTimeoutMs + l.initUs / 1000;
+		if (fingerFloorMs > l.floorMs)
+			l.floorMs = fingerFloorMs < UINT32_MAX ? (uint32_t)fingerFloorMs : UINT32_MAX;
+		if (l.floorMs > l.ceilMs)
+			l.ceilMs = l.floorMs;
+	}
+	fp_rtt_t* r = &t->cmd[cmd];
+	uint64_t us = fp_timeout_wire_us(t->baud, cmdLen + l.respLen) + (uint64_t)r->srttUs + 4 * (uint64_t)r->rttvarUs;
+	uint32_t ms = (uint32_t)((us + 999) / 1000);
+	ms = ms < l.floorMs ? l.floorMs : ms > l.ceilMs ? l.ceilMs : ms;
+	r->lastMs = ms;
+	return ms;
+}
+
+uint32_t fp_timeout_ms(fp_timeout_t* t, uint8_t cmd, uint16_t cmdLen)
+{
+	return timeout_ms(t, cmd, cmdLen, 1);
+}
+
+uint32_t fp_timeout_cmd_ms(fp_timeout_t* t, uint8_t cmd, const uint8_t* params, uint8_t paramLen)
+{
+	// 自动注册参数：编号(2) 次数(1) 控制位(2)；次数为0时按一次
+	uint8_t presses = cmd == CMD_AUTO_ENROLL && paramLen >= 3 && params[2] != 0 ? params[2] : 1;
+	return timeout_ms(t, cmd, (uint16_t)(FP_MIN_FRAME_LEN + paramLen), presses);
+}
+
+void fp_timeout_observe(fp_timeout_t* t, uint8_t cmd, uint16_t cmdLen, uint16_t respLen, uint32_t latencyUs)
+{
+	if (cmd >= FP_TIMEOUT_CMDS)
+		return;
+	fp_rtt_t* r = &t->cmd[cmd];
+	uint32_t wire = fp_timeout_wire_us(t->baud, (uint32_t)cmdLen + respLen);
+	uint32_t service = latencyUs > wire ? latencyUs - wire : 0;
+	if (r->samples == 0)
+	{
+		// 第一个样本直接替换初始估计
+		r->srttUs = service;
+		r->rttvarUs = service / 2;
+	}
+	else
+	{
+		// srtt += (x - srtt) / 8，rttvar += (|x - srtt| - rttvar) / 4
+		uint32_t err = service > r->srttUs ? service - r->srttUs : r->srttUs - service;
+		r->rttvarUs = (uint32_t)(((uint64_t)r->rttvarUs * 3 + err) / 4);
+		r->srttUs = (uint32_t)(((uint64_t)r->srttUs * 7 + service) / 8);
+	}
+	r->samples++;
+}
+
+void fp_timeout_expired(fp_timeout_t* t, uint8_t cmd)
+{
+	if (cmd >= FP_TIMEOUT_CMDS)
+		return;
+	fp_rtt_t* r = &t->cmd[cmd];
+	r->timeouts++;
+	// 偏差加倍，下一次超时随之放宽（最终受上限约束）
+	r->rttvarUs = r->rttvarUs > 0x7FFFFFFF ? 0xFFFFFFFF : (r->rttvarUs ? r->rttvarUs * 2 : 1000);
+}
+
+void fp_timeout_print_stats(const fp_timeout_t* t)
+{
+	printf("自适应超时（%u波特，容量%u）：\n", t->baud, t->capacity);
+	printf("  %-6s %-18s %8s %10s %10s %8s %6s\n", "指令", "名称", "样本", "平滑(ms)", "偏差(ms)", "超时(ms)", "超时数");
+	for (uint8_t c = 0; c < FP_TIMEOUT_CMDS; c++)
+	{
+		const fp_rtt_t* r = &t->cmd[c];
+		if (r->samples == 0 && r->timeouts == 0)
+			continue;
+		printf("  0x%02X   %-18s %8u %10.1f %10.1f %8u %6u\n", c, fp_dispatch_name(c), r->samples,
+			r->srttUs / 1000.0, r->rttvarUs / 1000.0, r->lastMs, r->timeouts);
+	}
+}
@@ -0,0 +1,93 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 每台设备、每条指令的自适应应答超时
+// 超时 = 线路传输时间（按当前波特率和命令帧、预期应答帧长度计算）
+//      + 平滑处理耗时 + 4倍耗时偏差（与TCP重传超时的估计方法相同）
+// 再按指令类别限定上下限：LED、取消等快命令很快判定失败，
+// 自动识别/搜索的初始估计按指纹库容量放大，库满时也有足够的时间；
+// 超时后偏差加倍（不用超时样本更新平滑值），避免模块偶尔变慢时连续超时；
+// 自动识别/注册的耗时主要是等用户按手指，样本再快也不能代表下一位用户，
+// 下限取模块等手指的超时再加上处理时间，平滑值变小时超时不会缩到模块自己放弃之前；
+// 自动注册要按多次手指（次数在参数第3字节），每次都可能等满一个等手指超时，下限按次数放大
+
+#define FP_TIMEOUT_CMDS 0x40 // 覆盖的指令码范围（0x00-0x3F）
+
+typedef struct
+{
+	uint32_t srttUs;    // 平滑处理耗时（微秒，不含线路传输）
+	uint32_t rttvarUs;  // 处理耗时偏差
+	uint32_t samples;   // 样本数
+	uint32_t timeouts;  // 超时次数
+	uint32_t lastMs;    // 最近一次给出的超时
+} fp_rtt_t;
+
+typedef struct
+{
+	uint32_t baud;                   // 当前波特率
+	uint16_t capacity;               // 指纹库容量（用于1:N搜索的初始估计）
+	uint32_t fingerTimeoutMs;        // 模块等手指的超时（自动识别/注册超时的下限，默认10秒）
+	fp_rtt_t cmd[FP_TIMEOUT_CMDS];   // 各指令的耗时估计
+} fp_timeout_t;
+
+/**
+ * @brief 初始化（各指令按初始估计）
+ * @param t 超时估计
+ * @param baud 波特率
+ * @param capacity 指纹库容量
+ */
+void fp_timeout_init(fp_timeout_t* t, uint32_t baud, uint16_t capacity);
+
+/**
+ * @brief 波特率变化后调用（只影响线路传输时间，耗时估计保留）
+ */
+void fp_timeout_set_baud(fp_timeout_t* t, uint32_t baud);
+
+/**
+ * @brief 设置模块等手指的超时（与模块配置一致，自动识别/注册的超时不低于它加处理时间）
+ */
+void fp_timeout_set_finger(fp_timeout_t* t, uint32_t fingerTimeoutMs);
+
+/**
+ * @brief 按长度计算线路传输时间（8N1，每字节10位）
+ */
+uint32_t fp_timeout_wire_us(uint32_t baud, uint32_t bytes);
+
+/**
+ * @brief 某条指令当前的应答超时（自动注册按一次手指计下限，知道参数时用fp_timeout_cmd_ms）
+ * @param t 超时估计
+ * @param cmd 指令码
+ * @param cmdLen 命令帧长度
+ * @return 超时（毫秒）
+ */
+uint32_t fp_timeout_ms(fp_timeout_t* t, uint8_t cmd, uint16_t cmdLen);
+
+/**
+ * @brief 某条命令当前的应答超时（按参数确定自动注册的按手指次数，其余同fp_timeout_ms）
+ * @param t 超时估计
+ * @param cmd 指令码
+ * @param params 指令参数
+ * @param paramLen 参数长度（命令帧长度由它推出）
+ * @return 超时（毫秒）
+ */
+uint32_t fp_timeout_cmd_ms(fp_timeout_t* t, uint8_t cmd, const uint8_t* params, uint8_t paramLen);
+
+/**
+ * @brief 收到应答后记录一次样本
+ * @param t 超时估计
+ * @param cmd 指令码
+ * @param cmdLen 命令帧长度
+ * @param respLen 应答帧长度
+ * @param latencyUs 发送开始到收齐应答的耗时
+ */
+void fp_timeout_observe(fp_timeout_t* t, uint8_t cmd, uint16_t cmdLen, uint16_t respLen, uint32_t latencyUs);
+
+/**
+ * @brief 等待应答超时后调用
+ */
+void fp_timeout_expired(fp_timeout_t* t, uint8_t cmd);
+
+/**
+ * @brief 打印有样本的指令的估计值
+ */
+void fp_timeout_print_stats(const fp_timeout_t* t);
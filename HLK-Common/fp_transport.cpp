@@ -0,0 +1,226 @@
+﻿#include <string.h>
+#include <chrono>
+#include "fp_transport.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#endif
+
+uint64_t fp_time_us(void)
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+esp_err_t fp_transport_send(const fp_transport_t* tp, const uint8_t* frame, uint16_t len)
+{
+	uint16_t sent = 0;
+	while (sent < len)
+	{
+		int n = tp->write(tp->ctx, frame + sent, len - sent);
+		if (n <= 0)
+		{
+			return ESP_FAIL;
+		}
+		sent += (uint16_t)n;
+	}
+	return ESP_OK;
+}
+
+// 丢弃缓冲区开头不可能是包头的字节，返回剩余字节数
+static uint16_t resync(uint8_t* buf, uint16_t have)
+{
+	uint16_t skip = 1;
+	while (skip < have && buf[skip] != FP_HEADER_0)
+	{
+		skip++;
+	}
+	memmove(buf, buf + skip, have - skip);
+	return have - skip;
+}
+
+uint16_t fp_transport_recv_frame(const fp_transport_t* tp, uint8_t* buf, uint16_t cap, uint32_t timeoutMs)
+{
+	if (cap < FP_MIN_FRAME_LEN)
+	{
+		return 0;
+	}
+	uint64_t deadline = fp_time_us() + (uint64_t)timeoutMs * 1000;
+	uint16_t have = 0;
+	uint16_t total = FP_PAYLOAD_INDEX; // 先收齐9字节头再确定整帧长度
+
+	while (true)
+	{
+		// 包头不对立即重新同步，避免被线路噪声拖到超时
+		if ((have >= 1 && buf[0] != FP_HEADER_0) || (have >= 2 && buf[1] != FP_HEADER_1))
+		{
+			have = resync(buf, have);
+			total = FP_PAYLOAD_INDEX;
+			continue;
+		}
+		if (have >= FP_PAYLOAD_INDEX && total == FP_PAYLOAD_INDEX)
+		{
+			uint16_t dataLen = fp_be16(buf + FP_LEN_INDEX);
+			if (dataLen < 2 || dataLen + FP_PAYLOAD_INDEX > cap)
+			{
+				have = resync(buf, have);
+				continue;
+			}
+			total = dataLen + FP_PAYLOAD_INDEX;
+		}
+		if (have >= total)
+		{
+			return total;
+		}
+
+		uint64_t now = fp_time_us();
+		if (now >= deadline)
+		{
+			return 0;
+		}
+		uint32_t remainMs = (uint32_t)((deadline - now + 999) / 1000);
+		int n = tp->read(tp->ctx, buf + have, total - have, remainMs);
+		if (n < 0)
+		{
+			return 0;
+		}
+		have += (uint16_t)n;
+	}
+}
+
+esp_err_t fp_transact(const fp_transport_t* tp, const uint8_t addr[4],
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result)
+{
+	memset(result, 0, sizeof(*result));
+	result->frame = FP_FRAME_SHORT;
+
+	uint8_t payload[1 + 255];
+	payload[0] = cmd;
+	if (paramLen > 0)
+	{
+		memcpy(payload + 1, params, paramLen);
+	}
+	uint8_t frame[FP_MAX_FRAME_LEN];
+	uint16_t frameLen = fp_build_frame(addr, PACKET_CMD, payload, paramLen + 1, frame, sizeof(frame));
+
+	uint64_t start = fp_time_us();
+	if (frameLen == 0 || fp_transport_send(tp, frame, frameLen) != ESP_OK)
+	{
+		result->linkError = true;
+		return ESP_FAIL;
+	}
+	result->respLen = fp_transport_recv_frame(tp, resp, respCap, timeoutMs);
+	result->latencyUs = (uint32_t)(fp_time_us() - start);
+	if (result->respLen == 0)
+	{
+		result->timeout = true;
+		return ESP_FAIL;
+	}
+
+	result->frame = fp_check_frame(resp, result->respLen, addr);
+	if (result->frame != FP_FRAME_OK)
+	{
+		return ESP_FAIL;
+	}
+	if (resp[FP_PID_INDEX] != PACKET_RESPONSE)
+	{
+		result->frame = FP_FRAME_BAD_PID;
+		return ESP_FAIL;
+	}
+	result->confirm = resp[FP_PAYLOAD_INDEX];
+	return result->confirm == 0x00 ? ESP_OK : ESP_FAIL;
+}
+
+#ifndef _WIN32
+// ========================== POSIX文件描述符传输 ==========================
+static int fd_write(void* ctx, const uint8_t* data, uint16_t len)
+{
+	int fd = *(int*)ctx;
+	while (true)
+	{
+		ssize_t n = ::write(fd, data, len);
+		if (n >= 0)
+			return (int)n;
+		if (errno != EINTR && errno != EAGAIN)
+			return -1;
+		struct pollfd pfd = { fd, POLLOUT, 0 };
+		::poll(&pfd, 1, 100);
+	}
+}
+
+static int fd_read(void* ctx, uint8_t* buf, uint16_t cap, uint32_t timeoutMs)
+{
+	int fd = *(int*)ctx;
+	struct pollfd pfd = { fd, POLLIN, 0 };
+	int ready = ::poll(&pfd, 1, (int)timeoutMs);
+	if (ready == 0)
+		return 0;
+	if (ready < 0)
+		return errno == EINTR ? 0 : -1;
+	ssize_t n = ::read(fd, buf, cap);
+	if (n < 0)
+		return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+	if (n == 0)
+		return -1; // 对端关闭
+	return (int)n;
+}
+
+void fp_transport_from_fd(fp_transport_t* tp, int* fd)
+{
+	tp->ctx = fd;
+	tp->write = fd_write;
+	tp->read = fd_read;
+}
+
+static speed_t baud_to_speed(uint32_t baud)
+{
+	switch (baud)
+	{
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600; // 模块出厂波特率
+	case 115200: return B115200;
+	default: return B0;        // 28800、48000等模块支持但termios没有标准值的速率
+	}
+}
+
+int fp_serial_open(const char* path, uint32_t baud)
+{
+	speed_t speed = baud_to_speed(baud);
+	if (speed == B0)
+	{
+		errno = EINVAL; // 按错误速率打开只会收到乱码，不如直接失败
+		return -1;
+	}
+	int fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+	if (fd < 0)
+	{
+		return -1;
+	}
+	struct termios tio;
+	if (tcgetattr(fd, &tio) != 0)
+	{
+		::close(fd);
+		return -1;
+	}
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cflag &= ~(CSTOPB | PARENB);
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	if (tcsetattr(fd, TCSANOW, &tio) != 0)
+	{
+		::close(fd);
+		return -1;
+	}
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+#endif
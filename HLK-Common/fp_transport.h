@@ -0,0 +1,90 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 串口传输抽象：驱动只通过读写函数指针收发字节，
+// 具体实现可以是UART、POSIX文件描述符（串口/pty/socketpair）或模拟器
+
+typedef struct
+{
+	void* ctx; // 实现私有上下文
+	/**
+	 * @brief 写入数据
+	 * @return 实际写入字节数，<0表示链路错误
+	 */
+	int (*write)(void* ctx, const uint8_t* data, uint16_t len);
+	/**
+	 * @brief 读取数据，最多等待timeoutMs毫秒
+	 * @return 实际读取字节数，0表示超时，<0表示链路错误
+	 */
+	int (*read)(void* ctx, uint8_t* buf, uint16_t cap, uint32_t timeoutMs);
+} fp_transport_t;
+
+// 一次命令交互的结果
+typedef struct
+{
+	uint16_t respLen;             // 应答帧长度（0表示未收到）
+	uint8_t confirm;              // 确认码（应答帧第9字节）
+	bool timeout;                 // 等待应答超时
+	bool linkError;               // 链路读写错误
+	fp_frame_result_t frame;      // 应答帧校验结果
+	uint32_t latencyUs;           // 发送开始到收齐应答的耗时（微秒）
+} fp_transact_result_t;
+
+/**
+ * @brief 发送完整的一帧（处理部分写入）
+ * @param tp 传输接口
+ * @param frame 数据帧
+ * @param len 帧长度
+ * @return 全部写入返回ESP_OK
+ */
+esp_err_t fp_transport_send(const fp_transport_t* tp, const uint8_t* frame, uint16_t len);
+
+/**
+ * @brief 接收一帧（按包头重新同步，按长度字段收齐）
+ * @param tp 传输接口
+ * @param buf 接收缓冲区
+ * @param cap 缓冲区容量
+ * @param timeoutMs 整帧超时时间（毫秒）
+ * @return 收到的帧长度，超时或出错返回0（不校验校验和）
+ */
+uint16_t fp_transport_recv_frame(const fp_transport_t* tp, uint8_t* buf, uint16_t cap, uint32_t timeoutMs);
+
+/**
+ * @brief 发送一条命令并等待应答
+ * @param tp 传输接口
+ * @param addr 设备地址
+ * @param cmd 指令码
+ * @param params 指令参数（可为nullptr）
+ * @param paramLen 参数长度
+ * @param resp 应答缓冲区（至少FP_MIN_FRAME_LEN字节）
+ * @param respCap 应答缓冲区容量
+ * @param timeoutMs 应答超时时间（毫秒）
+ * @param result 输出交互结果
+ * @return 收到有效应答且确认码为0x00返回ESP_OK
+ */
+esp_err_t fp_transact(const fp_transport_t* tp, const uint8_t addr[4],
+	uint8_t cmd, const uint8_t* params, uint8_t paramLen,
+	uint8_t* resp, uint16_t respCap, uint32_t timeoutMs,
+	fp_transact_result_t* result);
+
+/**
+ * @brief 单调时钟（微秒），用于延迟统计
+ */
+uint64_t fp_time_us(void);
+
+#ifndef _WIN32
+/**
+ * @brief 以POSIX文件描述符作为传输（串口、pty、socketpair均可）
+ * @param tp 输出传输接口
+ * @param fd 文件描述符指针（生命周期由调用者保证）
+ */
+void fp_transport_from_fd(fp_transport_t* tp, int* fd);
+
+/**
+ * @brief 打开串口并设置为8N1原始模式
+ * @param path 设备路径（如/dev/ttyUSB0）
+ * @param baud 波特率（9600、19200、38400、57600或115200，模块默认57600）
+ * @return 文件描述符，失败返回-1（不支持的波特率errno为EINVAL）
+ */
+int fp_serial_open(const char* path, uint32_t baud);
+#endif
@@ -0,0 +1,149 @@
+﻿#pragma once
+#include "fp_protocol.h"
+
+// 应答帧的类型化字段视图
+// 每种应答按字段布局（名称、类型、帧内偏移）声明一个视图，字段直接从接收缓冲区按大端读取，不拷贝；
+// 视图长度固定，字段偏移越界在编译期报错，运行时只在绑定时检查一次帧长，
+// 之后的字段访问没有任何判断
+//
+// 用法：
+//   fp_syspara_view v;
+//   if (fp_view_bind(&v, resp, len) && v.confirm() == 0x00)
+//       capacity = v.capacity();
+
+template <typename T>
+constexpr T fp_be_get(const uint8_t* p);
+
+template <>
+constexpr uint8_t fp_be_get<uint8_t>(const uint8_t* p)
+{
+	return p[0];
+}
+
+template <>
+constexpr uint16_t fp_be_get<uint16_t>(const uint8_t* p)
+{
+	return fp_be16(p);
+}
+
+template <>
+constexpr uint32_t fp_be_get<uint32_t>(const uint8_t* p)
+{
+	return fp_be32(p);
+}
+
+// 视图基类：Size为视图覆盖的帧长（含校验和）
+template <uint16_t Size>
+struct fp_frame_view
+{
+	static_assert(Size >= FP_MIN_FRAME_LEN && Size <= FP_MAX_FRAME_LEN, "视图长度超出帧长范围");
+	static constexpr uint16_t kSize = Size;
+
+	const uint8_t* p; // 帧起始（绑定后有效）
+
+	template <typename T, uint16_t Off>
+	T get() const
+	{
+		static_assert(Off + sizeof(T) <= Size - 2, "字段超出数据区");
+		return fp_be_get<T>(p + Off);
+	}
+
+	template <uint16_t Off, uint16_t Len>
+	const uint8_t* bytes() const
+	{
+		static_assert(Off + Len <= Size - 2, "字段超出数据区");
+		return p + Off;
+	}
+
+	uint8_t pid() const { return get<uint8_t, FP_PID_INDEX>(); }
+	uint16_t length() const { return get<uint16_t, FP_LEN_INDEX>(); }
+	uint8_t confirm() const { return get<uint8_t, FP_PAYLOAD_INDEX>(); }
+};
+
+// 声明一个字段：类型、名称、相对数据区（确认码之后）的偏移
+#define FP_VIEW_FIELD(T, name, off) \
+	T name() const { return this->template get<T, FP_PAYLOAD_INDEX + 1 + (off)>(); }
+
+/**
+ * @brief 把视图绑定到接收缓冲区
+ * @param v 视图
+ * @param frame 已校验的应答帧
+ * @param len 帧长度
+ * @return 帧长不足视图长度返回false（视图不可用）
+ */
+template <typename V>
+inline bool fp_view_bind(V* v, const uint8_t* frame, uint16_t len)
+{
+	if (frame == nullptr || len < V::kSize)
+		return false;
+	v->p = frame;
+	return true;
+}
+
+// ========================== 各应答的字段布局 ==========================
+// 读模组基本参数(0x0F)：16字节参数
+struct fp_syspara_view : fp_frame_view<FP_MIN_FRAME_LEN + 16>
+{
+	FP_VIEW_FIELD(uint16_t, status, 0)        // 状态寄存器
+	FP_VIEW_FIELD(uint16_t, templateSize, 2)  // 模板大小
+	FP_VIEW_FIELD(uint16_t, capacity, 4)      // 指纹库大小
+	FP_VIEW_FIELD(uint16_t, scoreLevel, 6)    // 安全等级
+	FP_VIEW_FIELD(uint32_t, address, 8)       // 设备地址
+	FP_VIEW_FIELD(uint16_t, packetCode, 12)   // 数据包大小（0=32,1=64,2=128,3=256）
+	FP_VIEW_FIELD(uint16_t, baudMultiple, 14) // 波特率（9600的倍数）
+
+	const uint8_t* addr() const { return bytes<FP_PAYLOAD_INDEX + 9, 4>(); }
+	uint16_t packetSize() const { return packetCode() <= 3 ? (uint16_t)(32 << packetCode()) : 0; }
+	uint32_t baud() const { return (uint32_t)baudMultiple() * 9600; }
+};
+
+// 读索引表(0x1F)：一页32字节位图
+struct fp_index_page_view : fp_frame_view<FP_MIN_FRAME_LEN + 32>
+{
+	const uint8_t* bitmap() const { return bytes<FP_PAYLOAD_INDEX + 1, 32>(); }
+};
+
+// 自动识别(0x32)：阶段、ID、得分
+struct fp_identify_view : fp_frame_view<FP_MIN_FRAME_LEN + 5>
+{
+	FP_VIEW_FIELD(uint8_t, stage, 0)   // 阶段（0x05为搜索结果）
+	FP_VIEW_FIELD(uint16_t, id, 1)     // 命中的ID
+	FP_VIEW_FIELD(uint16_t, score, 3)  // 比对得分
+};
+
+// 自动注册(0x31)：阶段、阶段参数
+struct fp_enroll_view : fp_frame_view<FP_MIN_FRAME_LEN + 2>
+{
+	FP_VIEW_FIELD(uint8_t, stage, 0)   // 阶段（0x06为存储模板）
+	FP_VIEW_FIELD(uint8_t, detail, 1)  // 阶段参数（录入次数或结果）
+};
+
+// 搜索指纹(0x04)：ID、得分
+struct fp_search_view : fp_frame_view<FP_MIN_FRAME_LEN + 4>
+{
+	FP_VIEW_FIELD(uint16_t, id, 0)     // 命中的ID
+	FP_VIEW_FIELD(uint16_t, score, 2)  // 比对得分
+};
+
+// 读有效模板个数(0x1D)
+struct fp_template_num_view : fp_frame_view<FP_MIN_FRAME_LEN + 2>
+{
+	FP_VIEW_FIELD(uint16_t, count, 0)  // 有效模板个数
+};
+
+// ========================== 自动流程 ==========================
+/**
+ * @brief 应答是否为该命令的最终应答
+ *        自动识别/注册在参数bit2未置位时先回若干阶段应答，收到最终阶段（识别0x05、注册0x06）
+ *        或失败确认码才算完成；其他指令一问一答，第一帧即最终应答
+ * @param cmd 指令码
+ * @param frame 已校验的应答帧
+ * @param len 帧长度
+ */
+inline bool fp_auto_is_final(uint8_t cmd, const uint8_t* frame, uint16_t len)
+{
+	if ((cmd != CMD_AUTO_IDENTIFY && cmd != CMD_AUTO_ENROLL) || len < FP_MIN_FRAME_LEN + 1 || frame[FP_PAYLOAD_INDEX] != 0x00)
+		return true;
+	uint8_t stage = frame[FP_PAYLOAD_INDEX + 1]; // 两种应答的阶段字节位置相同
+	return cmd == CMD_AUTO_IDENTIFY ? stage == 0x05 : stage == 0x06;
+}
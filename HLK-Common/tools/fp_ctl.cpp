@@ -0,0 +1,160 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../fp_health.h"
+#include "../fp_ipc.h"
+
+// 守护进程命令行客户端：列设备、发命令、订阅事件，也是fp_ipc客户端接口的用法示例
+// 用法：fp_ctl [-u 套接字路径] 子命令
+//   list                              列出设备及链路状态
+//   send 设备号 指令码 [参数字节...]  发送任意命令（十六进制），打印确认码和应答数据区
+//   identify 设备号...                 在多台设备上同时发起自动识别（同一连接多路复用）
+//   watch                             订阅识别结果和链路状态事件，持续打印
+
+static void print_event(const fp_ipc_msg_t* m)
+{
+	if (m->type == FP_IPC_EVENT_IDENTIFY && m->bodyLen >= 5)
+	{
+		printf("设备%u 识别：确认码%02X ID %u 得分%u\n", m->device, m->body[0], fp_be16(m->body + 1), fp_be16(m->body + 3));
+	}
+	else if (m->type == FP_IPC_EVENT_HEALTH && m->bodyLen >= 2)
+	{
+		printf("设备%u 链路：%s -> %s\n", m->device, fp_health_state_name((fp_health_state_t)m->body[0]),
+			fp_health_state_name((fp_health_state_t)m->body[1]));
+	}
+	fflush(stdout);
+}
+
+static void print_command_reply(const fp_ipc_msg_t* m)
+{
+	if (m->bodyLen < FP_IPC_COMMAND_REPLY_FIXED || m->body[0] != FP_IPC_OK)
+	{
+		printf("设备%u 请求%u 被拒绝：状态%u\n", m->device, m->reqId, m->bodyLen > 0 ? m->body[0] : 0xFF);
+		return;
+	}
+	uint8_t flags = m->body[1];
+	uint32_t waitUs = ((uint32_t)m->body[2] << 24) | ((uint32_t)m->body[3] << 16) | ((uint32_t)m->body[4] << 8) | m->body[5];
+	uint32_t execUs = ((uint32_t)m->body[6] << 24) | ((uint32_t)m->body[7] << 16) | ((uint32_t)m->body[8] << 8) | m->body[9];
+	printf("设备%u 请求%u：", m->device, m->reqId);
+	if (flags & FP_IPC_FLAG_POSTED)
+		printf("LED已提交");
+	else if (flags & FP_IPC_FLAG_NOT_RUN)
+		printf("未执行（守护进程退出）");
+	else if (flags & FP_IPC_FLAG_TIMEOUT)
+		printf("超时");
+	else if (flags & FP_IPC_FLAG_LINK_ERROR)
+		printf("串口错误");
+	else if (m->bodyLen > FP_IPC_COMMAND_REPLY_FIXED)
+		printf("确认码%02X", m->body[FP_IPC_COMMAND_REPLY_FIXED]);
+	if (flags & FP_IPC_FLAG_PREEMPTED)
+		printf("（被抢占）");
+	printf(" 排队%.1fms 执行%.1fms", waitUs / 1000.0, execUs / 1000.0);
+	for (uint16_t i = FP_IPC_COMMAND_REPLY_FIXED + 1; i < m->bodyLen; i++)
+		printf(i == FP_IPC_COMMAND_REPLY_FIXED + 1 ? " 数据 %02X" : " %02X", m->body[i]);
+	printf("\n");
+}
+
+// 等齐count条应答，期间到达的事件照常打印
+static int wait_replies(fp_ipc_client_t* c, uint32_t count, uint32_t timeoutMs)
+{
+	while (count > 0)
+	{
+		fp_ipc_msg_t m;
+		if (fp_ipc_recv(c, &m, timeoutMs) != ESP_OK)
+		{
+			fprintf(stderr, "等待应答超时或连接断开\n");
+			return 1;
+		}
+		if (m.reqId == 0)
+		{
+			print_event(&m);
+			continue;
+		}
+		if (m.type == (FP_IPC_COMMAND | FP_IPC_REPLY))
+		{
+			print_command_reply(&m);
+		}
+		else if (m.type == (FP_IPC_LIST | FP_IPC_REPLY) && m.bodyLen >= 1)
+		{
+			uint16_t pos = 1;
+			for (uint8_t i = 0; i < m.body[0] && pos + 6 <= m.bodyLen; i++)
+			{
+				const uint8_t* e = m.body + pos;
+				uint8_t nameLen = e[5];
+				printf("设备%u %02X%02X%02X%02X %-8s %.*s\n", i, e[0], e[1], e[2], e[3],
+					fp_health_state_name((fp_health_state_t)e[4]), nameLen, (const char*)e + 6);
+				pos += 6 + nameLen;
+			}
+		}
+		count--;
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = nullptr;
+	int opt;
+	while ((opt = getopt(argc, argv, "u:")) != -1)
+	{
+		if (opt == 'u')
+			path = optarg;
+	}
+	if (optind >= argc)
+	{
+		fprintf(stderr, "用法：%s [-u 套接字路径] list | send 设备号 指令码 [参数...] | identify 设备号... | watch\n", argv[0]);
+		return 1;
+	}
+	static fp_ipc_client_t c;
+	if (fp_ipc_connect(&c, path) != ESP_OK)
+	{
+		fprintf(stderr, "连接守护进程失败\n");
+		return 1;
+	}
+
+	const char* sub = argv[optind];
+	int rc = 1;
+	if (strcmp(sub, "list") == 0)
+	{
+		if (fp_ipc_request(&c, FP_IPC_LIST, 0, nullptr, 0) != 0)
+			rc = wait_replies(&c, 1, 2000);
+	}
+	else if (strcmp(sub, "send") == 0 && argc - optind >= 3)
+	{
+		uint8_t device = (uint8_t)strtoul(argv[optind + 1], nullptr, 0);
+		uint8_t cmd = (uint8_t)strtoul(argv[optind + 2], nullptr, 16);
+		uint8_t params[255];
+		uint8_t paramLen = 0;
+		for (int i = optind + 3; i < argc && paramLen < sizeof(params); i++)
+			params[paramLen++] = (uint8_t)strtoul(argv[i], nullptr, 16);
+		if (fp_ipc_command(&c, device, cmd, params, paramLen, 0) != 0)
+			rc = wait_replies(&c, 1, 20000);
+	}
+	else if (strcmp(sub, "identify") == 0 && argc - optind >= 2)
+	{
+		// 各设备的请求一次发完，应答按完成先后到达
+		const uint8_t params[5] = { 0x03, 0xFF, 0xFF, 0x00, 1 << 2 };
+		uint32_t sent = 0;
+		for (int i = optind + 1; i < argc; i++)
+			sent += fp_ipc_command(&c, (uint8_t)strtoul(argv[i], nullptr, 0), CMD_AUTO_IDENTIFY, params, sizeof(params), 10000) != 0;
+		rc = wait_replies(&c, sent, 20000);
+	}
+	else if (strcmp(sub, "watch") == 0)
+	{
+		uint8_t mask = FP_IPC_SUB_IDENTIFY | FP_IPC_SUB_HEALTH;
+		if (fp_ipc_request(&c, FP_IPC_SUBSCRIBE, 0, &mask, 1) != 0 && wait_replies(&c, 1, 2000) == 0)
+		{
+			fp_ipc_msg_t m;
+			while (fp_ipc_recv(&c, &m, 3600 * 1000) == ESP_OK)
+				print_event(&m);
+			rc = 0;
+		}
+	}
+	else
+	{
+		fprintf(stderr, "未知子命令：%s\n", sub);
+	}
+	fp_ipc_close(&c);
+	return rc;
+}
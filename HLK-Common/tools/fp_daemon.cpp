@@ -0,0 +1,768 @@
+﻿#include <errno.h>
+#include <fcntl.h>
+#include <grp.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <atomic>
+#include <map>
+#include <new>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "../fp_ipc.h"
+#include "../fp_rx_queue.h"
+#include "../fp_scheduler.h"
+#include "../fp_simulator.h"
+#include "../fp_views.h"
+
+// 模块守护进程：独占所有串口，每台设备一个调度器，经Unix域套接字向多个进程提供命令执行和事件订阅
+// 协议见fp_ipc.h；客户端可以在一条连接上同时发出多条请求，应答按完成顺序返回
+// 用法：fp_daemon [-u 套接字路径] [-g 组名] [-P 口令] [-S 模拟设备数] 串口[@波特率]...
+//   -u 套接字路径（默认/run/fp/daemon.sock；非root运行时指向自己的运行目录，如$XDG_RUNTIME_DIR/fp/daemon.sock）
+//   -g 允许连接的用户组（套接字目录和套接字的属组，缺省只有守护进程同一用户能连）
+//   -P 模块握手口令（十六进制，所有设备相同；调度器在会话内按需验证，模块重启后自动重新验证）
+//   -S 追加若干台实时模拟器设备（没有硬件时联调客户端，-P时模拟器也设同一口令）
+// 设备号按命令行顺序从0编号，串口上的模块地址按出厂默认FFFFFFFF
+//
+// 权限：套接字所在目录必须只有守护进程用户可写（不存在则按0750创建），套接字本身0660；
+// 连接时用SO_PEERCRED取对端用户，改写指纹库或访问控制的指令（注册/存模板/下载特征或图像/删除/清空/写寄存器/设置口令）
+// 只接受root或守护进程同一用户；
+// 设置芯片地址一律拒绝（调度器按启动时的地址组帧，改了地址之后所有命令都会失败）
+//
+// 线程：主线程poll监听套接字和所有连接，负责收请求、发应答；
+// 每个串口一个读线程（fp_rx_queue），持续把收到的字节放进接收队列，调度线程从队列取；
+// 调度线程执行命令，应答先经分派器把识别/搜索结果组成事件，再由完成回调组好应答，
+// 两者都只放入发件队列并经管道唤醒主线程，
+// 所有套接字读写都在主线程，慢客户端不会拖住串口
+
+#define MAX_CONNECTIONS 32           // 同时连接数上限
+#define MAX_INFLIGHT 32              // 每条连接执行中的请求上限
+#define MAX_OUTBOX (256 * 1024)      // 每条连接待发送字节上限（订阅了事件却不读的连接被断开）
+
+struct Daemon;
+
+struct Device
+{
+	Daemon* daemon;
+	uint8_t index;             // 设备号
+	std::string name;          // 串口路径或模拟器名
+	int fd;                    // 串口描述符（模拟器为-1）
+	fp_transport_t serial;     // 串口直连传输（只由读线程读）
+	fp_rx_queue_t* rxq;        // 串口接收队列（按缓存行对齐分配；模拟器为nullptr）
+	fp_transport_t transport;  // 调度器使用的传输
+	fp_sim_t sim;              // 模拟器设备
+	fp_sim_link_t simLink;
+	fp_scheduler_t* sched;
+	fp_session_t session;      // 口令会话（-P时挂到调度器上）
+	fp_dispatch_t dispatch;    // 应答分派（识别/搜索结果广播给订阅者）
+	std::atomic<uint8_t> health; // 链路状态（健康回调写，主线程读）
+};
+
+struct Connection
+{
+	int fd;
+	uint8_t events;                 // 订阅的事件掩码
+	uint32_t inflight;              // 执行中的请求数
+	bool privileged;                // 对端是root或守护进程同一用户（可执行破坏性指令）
+	std::vector<uint8_t> in;        // 未处理的请求字节
+	std::vector<uint8_t> out;       // 待发送字节
+};
+
+// 调度线程交给主线程的消息：conn为0表示事件（按mask发给订阅者）
+struct Outgoing
+{
+	uint32_t conn;
+	uint8_t mask;
+	std::vector<uint8_t> msg;
+};
+
+struct Daemon
+{
+	std::vector<Device*> devices;
+	std::map<uint32_t, Connection> conns;  // 连接编号 -> 连接（编号递增不复用，断开后迟到的应答直接丢弃）
+	uint32_t nextConn;
+	int wakeRead;
+	int wakeWrite;
+	std::mutex lock;                       // 保护outbox
+	std::vector<Outgoing> outbox;
+	// 统计
+	uint64_t requests;
+	uint64_t replies;
+	uint64_t events;
+	uint64_t dropped;                      // 连接已断开而丢弃的应答
+};
+
+// 一条命令请求在调度器中的上下文（完成回调中释放）
+struct Pending
+{
+	Device* dev;
+	uint32_t conn;
+	uint32_t reqId;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int)
+{
+	g_stop = 1;
+}
+
+// ========================== 调度线程侧 ==========================
+static void post(Daemon* d, uint32_t conn, uint8_t mask, const uint8_t* msg, uint16_t len)
+{
+	{
+		std::lock_guard<std::mutex> guard(d->lock);
+		d->outbox.push_back(Outgoing{ conn, mask, std::vector<uint8_t>(msg, msg + len) });
+	}
+	uint8_t one = 1;
+	(void)!::write(d->wakeWrite, &one, 1);
+}
+
+// 识别结果广播给订阅者（不管是哪个连接发起的）：分派器在调度线程中、完成回调之前调用
+static void post_identify(Device* dev, uint8_t confirm, uint16_t id, uint16_t score)
+{
+	if (confirm != 0x00)
+	{
+		id = 0xFFFF;
+		score = 0;
+	}
+	const uint8_t event[5] = { confirm, (uint8_t)(id >> 8), (uint8_t)id, (uint8_t)(score >> 8), (uint8_t)score };
+	uint8_t msg[FP_IPC_HEADER_LEN + sizeof(event)];
+	uint16_t len = fp_ipc_build(FP_IPC_EVENT_IDENTIFY, dev->index, 0, event, sizeof(event), msg, sizeof(msg));
+	post(dev->daemon, 0, FP_IPC_SUB_IDENTIFY, msg, len);
+}
+
+// 自动识别：失败或到了搜索结果阶段才有结论
+static void on_identify_reply(void* user, const fp_decoded_t* d)
+{
+	if (!fp_auto_is_final(d->cmd, d->frame, d->len))
+		return;
+	if (d->confirm != 0x00)
+		post_identify((Device*)user, d->confirm, 0, 0);
+	else
+		post_identify((Device*)user, d->confirm, d->identify.id(), d->identify.score());
+}
+
+static void on_search_reply(void* user, const fp_decoded_t* d)
+{
+	if (d->confirm != 0x00)
+		post_identify((Device*)user, d->confirm, 0, 0);
+	else
+		post_identify((Device*)user, d->confirm, d->search.id(), d->search.score());
+}
+
+static void on_command_done(void* user, uint8_t, const fp_sched_result_t* result)
+{
+	Pending* p = (Pending*)user;
+	Device* dev = p->dev;
+	const fp_transact_result_t* x = &result->xfer;
+
+	uint8_t body[FP_IPC_MAX_BODY];
+	uint16_t respLen = x->respLen < sizeof(result->resp) ? x->respLen : sizeof(result->resp);
+	uint16_t dataLen = respLen >= FP_MIN_FRAME_LEN && x->frame == FP_FRAME_OK ? respLen - FP_MIN_FRAME_LEN + 1 : 0;
+	uint32_t execUs = x->latencyUs;
+	body[0] = FP_IPC_OK;
+	body[1] = (uint8_t)((x->timeout ? FP_IPC_FLAG_TIMEOUT : 0) | (result->preempted ? FP_IPC_FLAG_PREEMPTED : 0) |
+		(x->linkError ? FP_IPC_FLAG_LINK_ERROR : 0) | (result->notRun ? FP_IPC_FLAG_NOT_RUN : 0));
+	for (int i = 0; i < 4; i++)
+	{
+		body[2 + i] = (uint8_t)(result->waitUs >> (24 - i * 8));
+		body[6 + i] = (uint8_t)(execUs >> (24 - i * 8));
+	}
+	if (dataLen > 0)
+		memcpy(body + FP_IPC_COMMAND_REPLY_FIXED, result->resp + FP_PAYLOAD_INDEX, dataLen);
+	uint8_t msg[FP_IPC_MAX_MSG];
+	uint16_t len = fp_ipc_build(FP_IPC_COMMAND | FP_IPC_REPLY, dev->index, p->reqId, body,
+		FP_IPC_COMMAND_REPLY_FIXED + dataLen, msg, sizeof(msg));
+	post(dev->daemon, p->conn, 0, msg, len);
+	delete p;
+}
+
+static void on_health(void* user, fp_health_state_t from, fp_health_state_t to)
+{
+	Device* dev = (Device*)user;
+	dev->health = (uint8_t)to;
+	const uint8_t body[2] = { (uint8_t)from, (uint8_t)to };
+	uint8_t msg[FP_IPC_HEADER_LEN + sizeof(body)];
+	uint16_t len = fp_ipc_build(FP_IPC_EVENT_HEALTH, dev->index, 0, body, sizeof(body), msg, sizeof(msg));
+	post(dev->daemon, 0, FP_IPC_SUB_HEALTH, msg, len);
+}
+
+// ========================== 主线程侧 ==========================
+static void reply(Daemon* d, Connection* c, uint8_t type, uint8_t device, uint32_t reqId, const uint8_t* body, uint16_t bodyLen)
+{
+	d->replies++;
+	uint8_t msg[FP_IPC_MAX_MSG];
+	uint16_t len = fp_ipc_build(type | FP_IPC_REPLY, device, reqId, body, bodyLen, msg, sizeof(msg));
+	c->out.insert(c->out.end(), msg, msg + len);
+}
+
+static void reply_status(Daemon* d, Connection* c, const fp_ipc_msg_t* m, uint8_t status)
+{
+	uint8_t body[FP_IPC_COMMAND_REPLY_FIXED];
+	memset(body, 0, sizeof(body));
+	body[0] = status;
+	reply(d, c, m->type, m->device, m->reqId, body, m->type == FP_IPC_COMMAND ? sizeof(body) : 1);
+}
+
+// 会改掉模块上数据或访问控制的指令，只接受有特权的连接：
+// 注册和存模板可以覆盖已占用的编号，下载特征/图像可以把伪造的指纹送进缓冲区再存储或搜索
+static bool is_destructive(uint8_t cmd)
+{
+	switch (cmd)
+	{
+	case CMD_AUTO_ENROLL:
+	case CMD_STORE_CHAR:
+	case CMD_DOWN_CHAR:
+	case CMD_DOWN_IMAGE:
+	case CMD_DELET_CHAR:
+	case CMD_EMPTY:
+	case CMD_WRITE_REG:
+	case CMD_SET_PWD:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static void handle_command(Daemon* d, uint32_t connId, Connection* c, const fp_ipc_msg_t* m)
+{
+	if (m->device >= d->devices.size())
+	{
+		reply_status(d, c, m, FP_IPC_NO_DEVICE);
+		return;
+	}
+	if (m->bodyLen < 3 || m->bodyLen - 3 > FP_SCHED_MAX_PARAMS)
+	{
+		reply_status(d, c, m, FP_IPC_BAD_REQUEST);
+		return;
+	}
+	Device* dev = d->devices[m->device];
+	uint8_t cmd = m->body[2];
+	const uint8_t* params = m->body + 3;
+	uint8_t paramLen = (uint8_t)(m->bodyLen - 3);
+	if (cmd == CMD_SET_CHIP_ADDR)
+	{
+		reply_status(d, c, m, FP_IPC_UNSUPPORTED);
+		return;
+	}
+	if (is_destructive(cmd) && !c->privileged)
+	{
+		reply_status(d, c, m, FP_IPC_DENIED);
+		return;
+	}
+
+	// LED控制进LED通道（只保留最新一条、不回调），提交即应答
+	if (fp_sched_class_of(cmd) == FP_SCHED_COSMETIC)
+	{
+		if (fp_sched_post_led(dev->sched, params, paramLen) != ESP_OK)
+		{
+			reply_status(d, c, m, FP_IPC_BAD_REQUEST);
+			return;
+		}
+		uint8_t body[FP_IPC_COMMAND_REPLY_FIXED];
+		memset(body, 0, sizeof(body));
+		body[1] = FP_IPC_FLAG_POSTED;
+		reply(d, c, m->type, m->device, m->reqId, body, sizeof(body));
+		return;
+	}
+	if (c->inflight >= MAX_INFLIGHT)
+	{
+		reply_status(d, c, m, FP_IPC_BUSY);
+		return;
+	}
+
+	fp_sched_request_t req;
+	memset(&req, 0, sizeof(req));
+	req.cmd = cmd;
+	memcpy(req.params, params, paramLen);
+	req.paramLen = paramLen;
+	req.timeoutMs = fp_be16(m->body);
+	req.done = on_command_done;
+	Pending* p = new Pending{ dev, connId, m->reqId };
+	req.user = p;
+	if (fp_sched_submit(dev->sched, &req) != ESP_OK)
+	{
+		delete p;
+		reply_status(d, c, m, FP_IPC_BUSY);
+		return;
+	}
+	c->inflight++;
+}
+
+static void handle_list(Daemon* d, Connection* c, const fp_ipc_msg_t* m)
+{
+	uint8_t body[FP_IPC_MAX_BODY];
+	uint16_t len = 1;
+	body[0] = 0;
+	for (Device* dev : d->devices)
+	{
+		uint8_t nameLen = (uint8_t)(dev->name.size() < 64 ? dev->name.size() : 64);
+		if ((size_t)len + 6 + nameLen > sizeof(body))
+			break;
+		memcpy(body + len, dev->sched->addr, 4);
+		body[len + 4] = dev->health;
+		body[len + 5] = nameLen;
+		memcpy(body + len + 6, dev->name.data(), nameLen);
+		len += 6 + nameLen;
+		body[0]++;
+	}
+	reply(d, c, m->type, m->device, m->reqId, body, len);
+}
+
+static void handle_message(Daemon* d, uint32_t connId, Connection* c, const fp_ipc_msg_t* m)
+{
+	d->requests++;
+	switch (m->type)
+	{
+	case FP_IPC_COMMAND:
+		handle_command(d, connId, c, m);
+		break;
+	case FP_IPC_LIST:
+		handle_list(d, c, m);
+		break;
+	case FP_IPC_SUBSCRIBE:
+		if (m->bodyLen != 1)
+		{
+			reply_status(d, c, m, FP_IPC_BAD_REQUEST);
+			break;
+		}
+		c->events = m->body[0];
+		reply_status(d, c, m, FP_IPC_OK);
+		break;
+	default:
+		reply_status(d, c, m, FP_IPC_UNSUPPORTED);
+		break;
+	}
+}
+
+// 读入并处理一条连接上的请求，连接应关闭时返回false
+static bool read_connection(Daemon* d, uint32_t connId, Connection* c)
+{
+	uint8_t buf[4096];
+	ssize_t n = ::recv(c->fd, buf, sizeof(buf), 0);
+	if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN))
+		return false;
+	if (n < 0)
+		return true;
+	c->in.insert(c->in.end(), buf, buf + n);
+
+	size_t used = 0;
+	while (true)
+	{
+		fp_ipc_msg_t m;
+		int len = fp_ipc_parse(c->in.data() + used, c->in.size() - used, &m);
+		if (len < 0)
+			return false; // 协议错误，无法重新同步
+		if (len == 0)
+			break;
+		handle_message(d, connId, c, &m);
+		used += len;
+	}
+	c->in.erase(c->in.begin(), c->in.begin() + used);
+	return true;
+}
+
+static bool flush_connection(Connection* c)
+{
+	while (!c->out.empty())
+	{
+		ssize_t n = ::send(c->fd, c->out.data(), c->out.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0)
+			return errno == EAGAIN || errno == EINTR;
+		c->out.erase(c->out.begin(), c->out.begin() + n);
+	}
+	return true;
+}
+
+// 把调度线程交来的应答和事件分发到各连接的发送缓冲
+static void deliver(Daemon* d)
+{
+	uint8_t drain[64];
+	while (::read(d->wakeRead, drain, sizeof(drain)) > 0)
+	{
+	}
+	std::vector<Outgoing> batch;
+	{
+		std::lock_guard<std::mutex> guard(d->lock);
+		batch.swap(d->outbox);
+	}
+	for (Outgoing& o : batch)
+	{
+		if (o.conn != 0)
+		{
+			auto it = d->conns.find(o.conn);
+			if (it == d->conns.end())
+			{
+				d->dropped++;
+				continue;
+			}
+			it->second.inflight--;
+			it->second.out.insert(it->second.out.end(), o.msg.begin(), o.msg.end());
+			d->replies++;
+			continue;
+		}
+		for (auto& kv : d->conns)
+		{
+			if (kv.second.events & o.mask)
+			{
+				kv.second.out.insert(kv.second.out.end(), o.msg.begin(), o.msg.end());
+				d->events++;
+			}
+		}
+	}
+}
+
+// 准备套接字所在目录：不存在则按0750创建；已存在的必须是本用户（或root）的目录且组和其他人不可写，
+// 否则别人可以在里面替换套接字文件
+static bool prepare_dir(const std::string& dir, gid_t group)
+{
+	if (::mkdir(dir.c_str(), 0750) == 0)
+	{
+		if (group != (gid_t)-1 && ::chown(dir.c_str(), (uid_t)-1, group) != 0)
+			return false;
+		return ::chmod(dir.c_str(), 0750) == 0; // mkdir受umask影响
+	}
+	if (errno != EEXIST)
+		return false;
+	struct stat st;
+	if (::lstat(dir.c_str(), &st) != 0)
+		return false;
+	if (!S_ISDIR(st.st_mode) || (st.st_uid != ::geteuid() && st.st_uid != 0) || (st.st_mode & (S_IWGRP | S_IWOTH)) != 0)
+	{
+		errno = EPERM;
+		return false;
+	}
+	return true;
+}
+
+// 路径上已有的文件：还有守护进程在监听则失败；是上次异常退出留下的套接字则删除；不是套接字不动它
+static bool remove_stale(const struct sockaddr_un* sa)
+{
+	struct stat st;
+	if (::lstat(sa->sun_path, &st) != 0)
+		return errno == ENOENT;
+	if (!S_ISSOCK(st.st_mode))
+	{
+		errno = EEXIST;
+		return false;
+	}
+	int probe = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (probe < 0)
+		return false;
+	bool live = ::connect(probe, (const struct sockaddr*)sa, sizeof(*sa)) == 0;
+	int err = errno;
+	::close(probe);
+	if (live)
+	{
+		errno = EADDRINUSE;
+		return false;
+	}
+	if (err != ECONNREFUSED)
+	{
+		errno = err;
+		return false;
+	}
+	return ::unlink(sa->sun_path) == 0;
+}
+
+static int listen_on(const char* path, gid_t group)
+{
+	struct sockaddr_un sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(sa.sun_path))
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+	strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+	std::string dir = path;
+	size_t slash = dir.rfind('/');
+	dir = slash == std::string::npos ? "." : slash == 0 ? "/" : dir.substr(0, slash);
+	if (!prepare_dir(dir, group) || !remove_stale(&sa))
+		return -1;
+
+	int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	mode_t old = ::umask(0117); // bind创建的套接字文件从一开始就是0660
+	bool ok = ::bind(fd, (struct sockaddr*)&sa, sizeof(sa)) == 0;
+	::umask(old);
+	if (ok && group != (gid_t)-1)
+		ok = ::chown(path, (uid_t)-1, group) == 0;
+	if (!ok || ::listen(fd, 16) != 0)
+	{
+		int err = errno;
+		::close(fd);
+		errno = err;
+		return -1;
+	}
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+	return fd;
+}
+
+// 对端是root或与守护进程同一用户
+static bool peer_privileged(int fd)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+	if (::getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) != 0)
+		return false;
+	return cred.uid == 0 || cred.uid == ::geteuid();
+}
+
+// 退出前把已交给各连接的应答尽量发完（每条连接最多等timeoutMs）
+static void flush_before_close(Connection* c, int timeoutMs)
+{
+	uint64_t deadline = fp_time_us() + (uint64_t)timeoutMs * 1000;
+	while (!c->out.empty() && flush_connection(c) && !c->out.empty())
+	{
+		uint64_t now = fp_time_us();
+		if (now >= deadline)
+			break;
+		struct pollfd pfd = { c->fd, POLLOUT, 0 };
+		if (::poll(&pfd, 1, (int)((deadline - now + 999) / 1000)) <= 0)
+			break;
+	}
+}
+
+static void serve(Daemon* d, int listenFd)
+{
+	std::vector<struct pollfd> pfds;
+	std::vector<uint32_t> ids;
+	while (!g_stop)
+	{
+		pfds.clear();
+		ids.clear();
+		pfds.push_back({ listenFd, POLLIN, 0 });
+		pfds.push_back({ d->wakeRead, POLLIN, 0 });
+		for (auto& kv : d->conns)
+		{
+			pfds.push_back({ kv.second.fd, (short)(POLLIN | (kv.second.out.empty() ? 0 : POLLOUT)), 0 });
+			ids.push_back(kv.first);
+		}
+		if (::poll(pfds.data(), pfds.size(), 500) < 0 && errno != EINTR)
+			break;
+
+		if (pfds[1].revents & POLLIN)
+			deliver(d);
+		if (pfds[0].revents & POLLIN)
+		{
+			int fd = ::accept(listenFd, nullptr, nullptr);
+			if (fd >= 0 && d->conns.size() >= MAX_CONNECTIONS)
+			{
+				::close(fd);
+			}
+			else if (fd >= 0)
+			{
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				Connection& c = d->conns[d->nextConn++];
+				c.fd = fd;
+				c.events = 0;
+				c.inflight = 0;
+				c.privileged = peer_privileged(fd);
+			}
+		}
+		for (size_t i = 0; i < ids.size(); i++)
+		{
+			auto it = d->conns.find(ids[i]);
+			Connection* c = &it->second;
+			bool keep = true;
+			if (pfds[i + 2].revents & (POLLIN | POLLHUP | POLLERR))
+				keep = read_connection(d, ids[i], c);
+			if (keep)
+				keep = flush_connection(c) && c->out.size() <= MAX_OUTBOX;
+			if (!keep)
+			{
+				::close(c->fd);
+				d->conns.erase(it); // 执行中的命令照常完成，应答到达时丢弃
+			}
+		}
+		// 本轮新产生的应答（含刚连上的连接）尽快发出，不等下一次POLLOUT
+		for (auto& kv : d->conns)
+			flush_connection(&kv.second);
+	}
+}
+
+// ========================== 主程序 ==========================
+static Device* add_device(Daemon* d, const std::string& name)
+{
+	Device* dev = new Device();
+	dev->daemon = d;
+	dev->index = (uint8_t)d->devices.size();
+	dev->name = name;
+	dev->fd = -1;
+	dev->rxq = nullptr;
+	dev->sched = new fp_scheduler_t();
+	d->devices.push_back(dev);
+	return dev;
+}
+
+int main(int argc, char** argv)
+{
+	const char* path = FP_IPC_DEFAULT_PATH;
+	gid_t group = (gid_t)-1;
+	uint32_t password = 0;
+	int simCount = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "u:g:P:S:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'u': path = optarg; break;
+		case 'g':
+		{
+			struct group* gr = ::getgrnam(optarg);
+			if (gr == nullptr)
+			{
+				fprintf(stderr, "用户组%s不存在\n", optarg);
+				return 1;
+			}
+			group = gr->gr_gid;
+			break;
+		}
+		case 'P': password = (uint32_t)strtoul(optarg, nullptr, 16); break;
+		case 'S': simCount = atoi(optarg); break;
+		default:
+			fprintf(stderr, "用法：%s [-u 套接字路径] [-g 组名] [-P 口令] [-S 模拟设备数] 串口[@波特率]...\n", argv[0]);
+			return 1;
+		}
+	}
+	if (optind >= argc && simCount <= 0)
+	{
+		fprintf(stderr, "至少需要一个串口或-S模拟设备\n");
+		return 1;
+	}
+	if (argc - optind + simCount > 255)
+	{
+		fprintf(stderr, "设备数超过255\n");
+		return 1;
+	}
+
+	static Daemon d;
+	d.nextConn = 1;
+	int wake[2];
+	if (::pipe(wake) != 0)
+	{
+		perror("pipe");
+		return 1;
+	}
+	fcntl(wake[0], F_SETFL, fcntl(wake[0], F_GETFL) | O_NONBLOCK);
+	fcntl(wake[1], F_SETFL, fcntl(wake[1], F_GETFL) | O_NONBLOCK);
+	d.wakeRead = wake[0];
+	d.wakeWrite = wake[1];
+
+	const uint8_t addr[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	for (int i = optind; i < argc; i++)
+	{
+		std::string spec = argv[i];
+		uint32_t baud = 57600;
+		size_t at = spec.find('@');
+		if (at != std::string::npos)
+		{
+			baud = (uint32_t)strtoul(spec.c_str() + at + 1, nullptr, 10);
+			spec.resize(at);
+		}
+		Device* dev = add_device(&d, spec);
+		dev->fd = fp_serial_open(spec.c_str(), baud);
+		if (dev->fd < 0)
+		{
+			fprintf(stderr, "打开%s失败：%s\n", spec.c_str(), strerror(errno));
+			return 1;
+		}
+		fp_transport_from_fd(&dev->serial, &dev->fd);
+		void* mem = nullptr;
+		if (posix_memalign(&mem, alignof(fp_rx_queue_t), sizeof(fp_rx_queue_t)) != 0)
+		{
+			fprintf(stderr, "分配%s的接收队列失败\n", spec.c_str());
+			return 1;
+		}
+		dev->rxq = new (mem) fp_rx_queue_t();
+		fp_transport_from_rx_queue(&dev->transport, dev->rxq);
+	}
+	for (int i = 0; i < simCount; i++)
+	{
+		Device* dev = add_device(&d, "sim" + std::to_string(i));
+		fp_sim_init(&dev->sim, 100);
+		fp_sim_set_occupied(&dev->sim, (uint16_t)i, true);
+		dev->sim.password = password;
+		fp_transport_from_sim(&dev->transport, &dev->simLink, &dev->sim, true);
+	}
+	for (Device* dev : d.devices)
+	{
+		fp_sched_init(dev->sched, addr, &dev->transport);
+		fp_health_config_t hc;
+		fp_health_default_config(&hc);
+		fp_health_init(&dev->sched->health, &hc, on_health, dev);
+		if (password != 0)
+		{
+			fp_session_init(&dev->session, addr, password);
+			fp_sched_attach_session(dev->sched, &dev->session);
+		}
+		fp_dispatch_init(&dev->dispatch, dev);
+		fp_dispatch_on(&dev->dispatch, CMD_AUTO_IDENTIFY, on_identify_reply);
+		fp_dispatch_on(&dev->dispatch, CMD_SEARCH, on_search_reply);
+		fp_sched_attach_dispatch(dev->sched, &dev->dispatch);
+	}
+
+	int listenFd = listen_on(path, group);
+	if (listenFd < 0)
+	{
+		fprintf(stderr, "监听%s失败：%s\n", path, strerror(errno));
+		return 1;
+	}
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	signal(SIGPIPE, SIG_IGN);
+	for (Device* dev : d.devices)
+	{
+		if (dev->rxq != nullptr)
+			fp_rx_queue_start(dev->rxq, &dev->serial);
+		fp_sched_start(dev->sched);
+	}
+	printf("监听%s，%u台设备\n", path, (unsigned)d.devices.size());
+	for (Device* dev : d.devices)
+		printf("  设备%u：%s\n", dev->index, dev->name.c_str());
+	fflush(stdout);
+
+	serve(&d, listenFd);
+
+	// 停止顺序：先停调度器（不再产生回调；队列里没执行的命令以notRun回调，Pending在回调中释放），
+	// 把这些应答交给各连接发完，再关连接和串口
+	for (Device* dev : d.devices)
+	{
+		fp_sched_stop(dev->sched);
+		if (dev->rxq != nullptr)
+			fp_rx_queue_stop(dev->rxq);
+	}
+	deliver(&d);
+	for (auto& kv : d.conns)
+	{
+		flush_before_close(&kv.second, 500);
+		::close(kv.second.fd);
+	}
+	::close(listenFd);
+	::unlink(path);
+	printf("\n请求%llu，应答%llu，事件%llu，连接断开后丢弃的应答%llu\n", (unsigned long long)d.requests,
+		(unsigned long long)d.replies, (unsigned long long)d.events, (unsigned long long)d.dropped);
+	for (Device* dev : d.devices)
+	{
+		printf("设备%u %s：\n", dev->index, dev->name.c_str());
+		fp_sched_print_stats(dev->sched);
+		printf("  ");
+		fp_dispatch_print_stats(&dev->dispatch);
+		if (dev->rxq != nullptr)
+			printf("  接收队列：读取%u次，最多积压%u字节，等待消费者%u次\n", dev->rxq->reads, dev->rxq->peak, dev->rxq->stalls);
+		if (dev->fd >= 0)
+			::close(dev->fd);
+	}
+	return 0;
+}
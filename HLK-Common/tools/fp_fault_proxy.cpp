@@ -0,0 +1,327 @@
+﻿#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+#include <deque>
+#include <initializer_list>
+#include <string>
+#include "../fp_simulator.h"
+
+// 故障注入串口代理：创建两个伪终端A、B，A收到的字节转发到B，B收到的转发到A，
+// 转发途中按配置注入位翻转、丢字节、重复字节、拆分写入、附加延迟与抖动，并按波特率限速；
+// 故障由带种子的随机数决定（两个方向各自一个序列），同样的种子和输入得到同样的故障；
+// 拆分点在字节入队时按字节序号从独立的序列取定，不随轮询时机变化，也不扰动其他故障的序列
+// 用法：fp_fault_proxy [选项]
+//   -s 种子      随机数种子（默认1）
+//   -f 概率      每字节翻转一位的概率（如0.001）
+//   -d 概率      每字节丢弃的概率
+//   -u 概率      每字节重复一次的概率
+//   -w 字节数    拆分写入：每次写入随机1到该字节数（0表示有多少写多少）
+//   -l 毫秒      固定附加延迟
+//   -j 毫秒      随机抖动上限（字节顺序不变）
+//   -b 波特率    按8N1限速（0表示不限）
+//   -D 方向      只对一个方向注入故障：ab（A到B）或ba（默认两个方向；延迟与限速始终两个方向都生效）
+//   -L 前缀      为两个伪终端建立符号链接：前缀-a、前缀-b
+//   -S 容量      B侧不建伪终端，改为内置模拟器（主机程序打开A即可测试，模拟处理耗时计入延迟）
+// 主机程序用fp_serial_open打开A，模块侧（另一个程序或真实模块的桥接）打开B；Ctrl+C结束并打印统计
+
+struct Rng
+{
+	uint32_t s;
+	uint32_t next()
+	{
+		s ^= s << 13;
+		s ^= s >> 17;
+		s ^= s << 5;
+		return s;
+	}
+	bool chance(double p) { return p > 0 && next() < p * 4294967296.0; }
+};
+
+struct Faults
+{
+	double flip;
+	double drop;
+	double dup;
+	uint16_t splitMax;
+	uint32_t latencyUs;
+	uint32_t jitterUs;
+	uint32_t byteUs;   // 每字节线路时间（0表示不限速）
+};
+
+struct Pending
+{
+	uint8_t byte;
+	bool splitBefore;   // 拆分写入：从这个字节开始新的一次写入
+	uint64_t dueUs;
+};
+
+struct Direction
+{
+	const char* name;
+	int outFd;                    // 输出伪终端（-1表示输出到模拟器）
+	bool inject;                  // 是否注入故障
+	Rng rng;                      // 翻转/丢弃/重复/抖动
+	Rng splitRng;                 // 拆分点（独立序列）
+	uint16_t untilSplit;          // 距下一个拆分点还有多少字节
+	std::deque<Pending> queue;    // 待发出的字节
+	uint64_t lastDueUs;           // 上一个字节的发出时刻（保证顺序与限速）
+	// 统计
+	uint64_t bytesIn;
+	uint64_t bytesOut;
+	uint64_t flipped;
+	uint64_t dropped;
+	uint64_t duplicated;
+	uint64_t writes;
+	uint64_t maxQueue;
+};
+
+static volatile sig_atomic_t g_stop = 0;
+
+static void on_signal(int)
+{
+	g_stop = 1;
+}
+
+// 打开一个伪终端主端，设为原始模式，返回从端路径；代理自己也保持打开从端，避免对端关闭时主端一直报挂断
+static int open_pty(std::string* path, int* keepSlave)
+{
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+		return -1;
+	*path = ptsname(master);
+	*keepSlave = open(path->c_str(), O_RDWR | O_NOCTTY);
+	struct termios tio;
+	if (*keepSlave >= 0 && tcgetattr(*keepSlave, &tio) == 0)
+	{
+		cfmakeraw(&tio);
+		tcsetattr(*keepSlave, TCSANOW, &tio);
+	}
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	return master;
+}
+
+static void enqueue(Direction* d, const Faults* f, const uint8_t* data, size_t n, uint64_t nowUs, uint32_t extraUs)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		uint8_t b = data[i];
+		int copies = 1;
+		d->bytesIn++;
+		if (d->inject)
+		{
+			if (d->rng.chance(f->drop))
+			{
+				d->dropped++;
+				continue;
+			}
+			if (d->rng.chance(f->flip))
+			{
+				b ^= (uint8_t)(1 << (d->rng.next() & 7));
+				d->flipped++;
+			}
+			if (d->rng.chance(f->dup))
+			{
+				copies = 2;
+				d->duplicated++;
+			}
+		}
+		for (int c = 0; c < copies; c++)
+		{
+			bool split = false;
+			if (d->inject && f->splitMax > 0 && d->untilSplit-- == 0)
+			{
+				d->untilSplit = (uint16_t)(d->splitRng.next() % f->splitMax); // 本段1到splitMax字节
+				split = true;
+			}
+			uint64_t due = nowUs + extraUs + f->latencyUs + (f->jitterUs ? d->rng.next() % (f->jitterUs + 1) : 0);
+			if (due < d->lastDueUs)
+				due = d->lastDueUs;
+			if (f->byteUs && due < d->lastDueUs + f->byteUs)
+				due = d->lastDueUs + f->byteUs;
+			d->lastDueUs = due;
+			d->queue.push_back({ b, split, due });
+		}
+	}
+	if (d->queue.size() > d->maxQueue)
+		d->maxQueue = d->queue.size();
+}
+
+// 发出已到期的字节，拆分写入时每次写到下一个拆分点为止
+static void flush(Direction* d, const fp_transport_t* sim, uint64_t nowUs)
+{
+	while (!d->queue.empty() && d->queue.front().dueUs <= nowUs)
+	{
+		uint8_t buf[256];
+		size_t n = 0;
+		while (n < sizeof(buf) && n < d->queue.size() && d->queue[n].dueUs <= nowUs && (n == 0 || !d->queue[n].splitBefore))
+		{
+			buf[n] = d->queue[n].byte;
+			n++;
+		}
+		ssize_t w = d->outFd >= 0 ? ::write(d->outFd, buf, n) : sim->write(sim->ctx, buf, (uint16_t)n);
+		if (w <= 0)
+			return; // 对端缓冲区满，下一轮再发
+		d->queue.erase(d->queue.begin(), d->queue.begin() + w);
+		d->bytesOut += (uint64_t)w;
+		d->writes++;
+	}
+}
+
+static void print_stats(const Direction* d)
+{
+	printf("%s：收%llu 发%llu 翻转%llu 丢弃%llu 重复%llu 写入%llu次 最大积压%llu字节\n", d->name,
+		(unsigned long long)d->bytesIn, (unsigned long long)d->bytesOut, (unsigned long long)d->flipped,
+		(unsigned long long)d->dropped, (unsigned long long)d->duplicated, (unsigned long long)d->writes,
+		(unsigned long long)d->maxQueue);
+}
+
+int main(int argc, char** argv)
+{
+	Faults f;
+	memset(&f, 0, sizeof(f));
+	uint32_t seed = 1;
+	uint32_t baud = 0;
+	const char* dirOnly = nullptr;
+	const char* linkPrefix = nullptr;
+	int simCapacity = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "s:f:d:u:w:l:j:b:D:L:S:")) != -1)
+	{
+		switch (opt)
+		{
+		case 's': seed = (uint32_t)strtoul(optarg, nullptr, 0); break;
+		case 'f': f.flip = atof(optarg); break;
+		case 'd': f.drop = atof(optarg); break;
+		case 'u': f.dup = atof(optarg); break;
+		case 'w': f.splitMax = (uint16_t)atoi(optarg); break;
+		case 'l': f.latencyUs = (uint32_t)(atof(optarg) * 1000); break;
+		case 'j': f.jitterUs = (uint32_t)(atof(optarg) * 1000); break;
+		case 'b': baud = (uint32_t)atoi(optarg); break;
+		case 'D': dirOnly = optarg; break;
+		case 'L': linkPrefix = optarg; break;
+		case 'S': simCapacity = atoi(optarg); break;
+		default:
+			printf("用法：%s [-s 种子] [-f 翻转概率] [-d 丢弃概率] [-u 重复概率] [-w 拆分字节数] "
+				"[-l 延迟ms] [-j 抖动ms] [-b 波特率] [-D ab|ba] [-L 链接前缀] [-S 模拟器容量]\n", argv[0]);
+			return 1;
+		}
+	}
+	f.byteUs = baud ? (uint32_t)(10ull * 1000000 / baud) : 0;
+	if (f.splitMax > 256)
+		f.splitMax = 256;
+
+	std::string pathA, pathB;
+	int keepA = -1, keepB = -1;
+	int fdA = open_pty(&pathA, &keepA);
+	int fdB = simCapacity > 0 ? -1 : open_pty(&pathB, &keepB);
+	if (fdA < 0 || (simCapacity == 0 && fdB < 0))
+	{
+		perror("posix_openpt");
+		return 1;
+	}
+
+	static fp_sim_t sim;
+	fp_sim_link_t link;
+	fp_transport_t simTp = {};
+	if (simCapacity > 0)
+	{
+		fp_sim_init(&sim, (uint16_t)simCapacity);
+		fp_transport_from_sim(&simTp, &link, &sim, false);
+	}
+
+	if (linkPrefix != nullptr)
+	{
+		std::string a = std::string(linkPrefix) + "-a", b = std::string(linkPrefix) + "-b";
+		unlink(a.c_str());
+		if (symlink(pathA.c_str(), a.c_str()) != 0)
+			perror(a.c_str());
+		if (fdB >= 0)
+		{
+			unlink(b.c_str());
+			if (symlink(pathB.c_str(), b.c_str()) != 0)
+				perror(b.c_str());
+		}
+	}
+	printf("A：%s\nB：%s\n", pathA.c_str(), fdB >= 0 ? pathB.c_str() : "内置模拟器");
+	printf("种子%u 翻转%g 丢弃%g 重复%g 拆分%u 延迟%.1fms 抖动%.1fms 限速%u波特 注入方向%s\n", seed, f.flip, f.drop, f.dup,
+		f.splitMax, f.latencyUs / 1000.0, f.jitterUs / 1000.0, baud, dirOnly ? dirOnly : "双向");
+	fflush(stdout);
+
+	Direction ab = {}, ba = {};
+	ab.name = "A->B";
+	ab.outFd = fdB;
+	ab.inject = dirOnly == nullptr || strcmp(dirOnly, "ab") == 0;
+	ab.rng.s = seed ? seed : 1;
+	ba.name = "B->A";
+	ba.outFd = fdA;
+	ba.inject = dirOnly == nullptr || strcmp(dirOnly, "ba") == 0;
+	ba.rng.s = (seed ? seed : 1) ^ 0x9E3779B9u;
+	ab.splitRng.s = ab.rng.s ^ 0x85EBCA6Bu;
+	ba.splitRng.s = ba.rng.s ^ 0x85EBCA6Bu;
+
+	signal(SIGINT, on_signal);
+	signal(SIGTERM, on_signal);
+	while (!g_stop)
+	{
+		// 等到下一个字节到期或有新数据
+		uint64_t now = fp_time_us();
+		int waitMs = 100;
+		for (const Direction* d : { &ab, &ba })
+		{
+			if (!d->queue.empty())
+			{
+				uint64_t due = d->queue.front().dueUs;
+				int ms = due <= now ? 0 : (int)((due - now + 999) / 1000);
+				waitMs = ms < waitMs ? ms : waitMs;
+			}
+		}
+		struct pollfd pfd[2] = { { fdA, POLLIN, 0 }, { fdB, POLLIN, 0 } };
+		int ready = poll(pfd, fdB >= 0 ? 2 : 1, waitMs);
+		if (ready < 0 && errno != EINTR)
+			break;
+
+		uint8_t buf[512];
+		now = fp_time_us();
+		if (ready > 0 && (pfd[0].revents & POLLIN))
+		{
+			ssize_t n = ::read(fdA, buf, sizeof(buf));
+			if (n > 0)
+				enqueue(&ab, &f, buf, (size_t)n, now, 0);
+		}
+		if (ready > 0 && fdB >= 0 && (pfd[1].revents & POLLIN))
+		{
+			ssize_t n = ::read(fdB, buf, sizeof(buf));
+			if (n > 0)
+				enqueue(&ba, &f, buf, (size_t)n, now, 0);
+		}
+
+		now = fp_time_us();
+		flush(&ab, &simTp, now);
+		if (fdB < 0)
+		{
+			// 模拟器应答的处理耗时计入延迟
+			int n = simTp.read(simTp.ctx, buf, sizeof(buf), 0);
+			if (n > 0)
+				enqueue(&ba, &f, buf, (size_t)n, now, sim.serviceUs);
+		}
+		flush(&ba, nullptr, now);
+	}
+
+	printf("\n");
+	print_stats(&ab);
+	print_stats(&ba);
+	if (fdB < 0)
+		printf("模拟器：处理命令%u条，收到坏帧%u\n", sim.commands, sim.badFrames);
+	if (linkPrefix != nullptr)
+	{
+		unlink((std::string(linkPrefix) + "-a").c_str());
+		unlink((std::string(linkPrefix) + "-b").c_str());
+	}
+	return 0;
+}
@@ -0,0 +1,41 @@
+﻿#include <stdio.h>
+#include "../fp_profile.h"
+
+// 占用报告工具：按预定义配置打印静态RAM占用明细
+// 用法：fp_footprint
+//
+// RAM在编译期由sizeof确定，用目标编译器编译本工具（或在目标工程里编译同一头文件）即可得到目标上的数值；
+// FLASH占用取决于目标编译器和优化选项，在主机上无法得到，请对交叉编译出的目标文件运行size：
+//   arm-none-eabi-g++ -Os -DFP_CACHE_LINE=4 -c ZW20.cpp && arm-none-eabi-size ZW20.o
+// 编译时加 -DFP_CACHE_LINE=4 可看到去掉缓存行填充后的MCU占用
+
+// 各配置在MCU上的预算（单位字节），超出时编译失败
+#if FP_CACHE_LINE <= 4
+FP_PROFILE_RAM_ASSERT(fp_profile_tiny, 1024);
+#endif
+
+template <typename P>
+static void print_profile(const char* name)
+{
+	typedef fp_static_device_t<P> dev_t;
+	printf("%s：%u台设备，容量%u，数据包%u字节，接收队列%u字节，帧队列%u帧\n", name,
+		(unsigned)P::kDevices, (unsigned)P::kSlots, (unsigned)P::kMaxPacket,
+		(unsigned)P::kRxBytes, (unsigned)P::kFrames);
+	printf("  索引位图     %6u\n", (unsigned)sizeof(((dev_t*)0)->index));
+	printf("  应答缓冲区   %6u\n", (unsigned)sizeof(((dev_t*)0)->resp));
+	printf("  帧解析器     %6u\n", (unsigned)sizeof(((dev_t*)0)->parser));
+	printf("  接收字节队列 %6u\n", (unsigned)sizeof(((dev_t*)0)->rx));
+	printf("  帧队列       %6u\n", (unsigned)sizeof(((dev_t*)0)->frames));
+	printf("  单台设备     %6u（含对齐填充）\n", (unsigned)sizeof(dev_t));
+	printf("  合计RAM      %6u\n\n", (unsigned)fp_profile_ram<P>());
+}
+
+int main()
+{
+	printf("缓存行对齐：%u字节\n\n", (unsigned)FP_CACHE_LINE);
+	print_profile<fp_profile_tiny>("tiny");
+	print_profile<fp_profile_mcu>("mcu");
+	print_profile<fp_profile_host>("host");
+	printf("FLASH占用请对交叉编译的目标文件运行size（见本文件开头说明）\n");
+	return 0;
+}
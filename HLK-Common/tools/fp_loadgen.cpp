@@ -0,0 +1,613 @@
+﻿#include <errno.h>
+#include <fcntl.h>
+#include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../fp_scheduler.h"
+#include "../fp_simulator.h"
+
+// 多设备压测工具：在本机模拟N台模块（socketpair或伪终端），每台按识别/注册/LED的比例和思考时间
+// 不断提交命令，主机侧每台设备一个调度器（与网关上的用法相同），按阶梯递增N，
+// 报告每台设备的主机CPU占用、命令端到端延迟p50/p99和内存占用，找出扩展上限
+// 用法：fp_loadgen [-n 16,32,64,128,256] [-d 秒] [-t 思考时间ms] [-m 识别,注册,LED]
+//                  [-b 波特率] [-c 附加延迟上限ms] [-s 种子] [-p]
+//   -n 设备数阶梯（逗号分隔）
+//   -d 每级测量时长（秒，另有约1秒预热不计入）
+//   -t 两次操作之间的平均思考时间（指数分布）
+//   -m 识别、注册、LED的比例
+//   -b 模拟的串口波特率，应答按字节数加上线路时间（0表示不计）
+//   -c 识别p99减去模拟处理耗时超过该值即判为到达上限
+//   -p 用伪终端代替socketpair（经过tty层，更接近真实串口）
+//
+// 模拟模块全部由一个线程服务（poll所有端口、按模拟处理耗时定时应答），
+// 它的CPU时间单独计量并从进程CPU中扣除，报告的CPU只含主机协议栈和命令脚本
+
+// ========================== 延迟样本 ==========================
+// 每级命令数不多（设备数×测量秒数量级），保留全部样本排序后取精确分位数；
+// 模拟处理耗时是常数，附加延迟只有几毫秒，分桶直方图的误差会把它淹没
+static uint64_t percentile(std::vector<uint32_t>* v, uint32_t permille)
+{
+	if (v->empty())
+		return 0;
+	size_t k = (v->size() * permille + 999) / 1000;
+	k = k == 0 ? 0 : k - 1;
+	std::nth_element(v->begin(), v->begin() + k, v->end());
+	return (*v)[k];
+}
+
+// ========================== 模拟模块 ==========================
+struct Module
+{
+	int fd;                         // 模块侧端口
+	fp_sim_t sim;
+	uint8_t rx[FP_MAX_FRAME_LEN];   // 命令组帧
+	uint16_t rxLen;
+};
+
+struct Pending
+{
+	uint64_t dueUs;                 // 应答时刻（收到命令 + 模拟处理耗时 + 线路时间）
+	uint32_t module;
+	uint16_t len;
+	uint8_t frame[FP_MAX_FRAME_LEN];
+
+	bool operator>(const Pending& o) const { return dueUs > o.dueUs; }
+};
+
+struct ModuleServer
+{
+	std::vector<Module>* modules;
+	uint32_t baud;
+	std::atomic<bool> stop;
+};
+
+// 收到的字节按帧头和长度字段组帧，每收齐一帧交给模拟器，应答按模拟处理耗时排队
+static void module_feed(ModuleServer* srv, uint32_t m, const uint8_t* data, ssize_t n,
+	std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>>* pending)
+{
+	Module* mod = &(*srv->modules)[m];
+	for (ssize_t i = 0; i < n; i++)
+	{
+		if (mod->rxLen == 0 && data[i] != FP_HEADER_0)
+			continue;
+		mod->rx[mod->rxLen++] = data[i];
+		if (mod->rxLen < FP_PAYLOAD_INDEX)
+			continue;
+		uint16_t total = fp_be16(mod->rx + FP_LEN_INDEX) + FP_PAYLOAD_INDEX;
+		if (total > sizeof(mod->rx))
+		{
+			mod->rxLen = 0;
+			continue;
+		}
+		if (mod->rxLen < total)
+			continue;
+
+		Pending p;
+		p.len = fp_sim_handle(&mod->sim, mod->rx, total, p.frame, sizeof(p.frame));
+		mod->rxLen = 0;
+		if (p.len == 0)
+			continue;
+		p.module = m;
+		p.dueUs = fp_time_us() + mod->sim.serviceUs;
+		if (srv->baud != 0)
+			p.dueUs += (uint64_t)p.len * 10 * 1000000 / srv->baud;
+		pending->push(p);
+	}
+}
+
+static void module_loop(ModuleServer* srv)
+{
+	std::vector<Module>& modules = *srv->modules;
+	std::vector<struct pollfd> pfds(modules.size());
+	for (size_t i = 0; i < modules.size(); i++)
+		pfds[i] = { modules[i].fd, POLLIN, 0 };
+	std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> pending;
+	uint8_t buf[512];
+
+	while (!srv->stop.load(std::memory_order_relaxed))
+	{
+		uint64_t now = fp_time_us();
+		while (!pending.empty() && pending.top().dueUs <= now)
+		{
+			const Pending& p = pending.top();
+			(void)!::write(modules[p.module].fd, p.frame, p.len);
+			pending.pop();
+		}
+		int waitMs = 50;
+		if (!pending.empty())
+		{
+			uint64_t left = (pending.top().dueUs - now + 999) / 1000;
+			waitMs = left < (uint64_t)waitMs ? (int)left : waitMs;
+		}
+		if (::poll(pfds.data(), pfds.size(), waitMs) <= 0)
+			continue;
+		for (size_t i = 0; i < pfds.size(); i++)
+		{
+			if ((pfds[i].revents & POLLIN) == 0)
+				continue;
+			ssize_t n = ::read(pfds[i].fd, buf, sizeof(buf));
+			if (n > 0)
+				module_feed(srv, (uint32_t)i, buf, n, &pending);
+		}
+	}
+}
+
+// ========================== 主机侧设备 ==========================
+enum
+{
+	OP_IDENTIFY = 0,
+	OP_ENROLL,
+	OP_LED,
+	OP_KINDS
+};
+
+struct Device
+{
+	int fd;                          // 主机侧端口
+	fp_transport_t transport;
+	fp_scheduler_t* sched;
+	uint32_t rng;                    // 命令脚本的随机数（只由脚本线程使用）
+	std::atomic<bool> busy;          // 有命令在执行，等待完成回调
+	std::atomic<uint64_t> doneUs;    // 最近一次完成时刻
+	uint64_t nextUs;                 // 下一次操作时刻
+	uint8_t op;                      // 执行中的操作
+	uint64_t submitUs;               // 提交时刻
+	// 统计（只由调度线程写，测量结束后读）
+	std::vector<uint32_t> latency[OP_KINDS]; // 端到端延迟样本（微秒）
+	uint32_t completed;
+	uint32_t failed;
+	uint32_t timeouts;
+};
+
+static std::atomic<uint64_t> g_measureUs;    // 测量窗口起点（之前提交的命令不计入统计）
+static std::atomic<uint64_t> g_measureEndUs; // 测量窗口终点（之后完成的命令不计入统计，含停止时以notRun回调的排队命令）
+
+static uint32_t next_rand(uint32_t* s)
+{
+	uint32_t x = *s;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *s = x;
+}
+
+// 指数分布的思考时间
+static uint64_t think_us(uint32_t* rng, uint32_t meanMs)
+{
+	double u = (next_rand(rng) + 1.0) / 4294967297.0;
+	return (uint64_t)(-log(u) * meanMs * 1000.0);
+}
+
+static void on_done(void* user, uint8_t cmd, const fp_sched_result_t* result)
+{
+	Device* d = (Device*)user;
+	uint64_t now = fp_time_us();
+	if (d->submitUs >= g_measureUs.load(std::memory_order_relaxed) && now <= g_measureEndUs.load(std::memory_order_relaxed))
+	{
+		d->latency[cmd == CMD_AUTO_ENROLL ? OP_ENROLL : OP_IDENTIFY].push_back((uint32_t)(now - d->submitUs));
+		d->completed++;
+		d->failed += result->ok != ESP_OK && !(cmd == CMD_AUTO_IDENTIFY && result->xfer.confirm == 0x09);
+		d->timeouts += result->xfer.timeout;
+	}
+	d->doneUs.store(now, std::memory_order_relaxed);
+	d->busy.store(false, std::memory_order_release);
+}
+
+// 按比例选一个操作提交给调度器
+static void start_op(Device* d, const uint32_t mix[OP_KINDS], uint16_t capacity, uint64_t now)
+{
+	uint32_t total = mix[OP_IDENTIFY] + mix[OP_ENROLL] + mix[OP_LED];
+	uint32_t r = next_rand(&d->rng) % total;
+	d->op = r < mix[OP_IDENTIFY] ? OP_IDENTIFY : r < mix[OP_IDENTIFY] + mix[OP_ENROLL] ? OP_ENROLL : OP_LED;
+	d->submitUs = now;
+	if (d->op == OP_LED)
+	{
+		// 识别前后的灯效：呼吸/闪烁/常亮轮换，调度器只发最新一条
+		uint8_t params[4] = { (uint8_t)(1 + next_rand(&d->rng) % 3), (uint8_t)(1 + next_rand(&d->rng) % 7), 0x00, 0x00 };
+		params[2] = params[1];
+		fp_sched_post_led(d->sched, params, sizeof(params));
+		return;
+	}
+
+	fp_sched_request_t req;
+	memset(&req, 0, sizeof(req));
+	req.done = on_done;
+	req.user = d;
+	if (d->op == OP_IDENTIFY)
+	{
+		const uint8_t params[5] = { 0x03, 0xFF, 0xFF, 0x00, 1 << 2 };
+		req.cmd = CMD_AUTO_IDENTIFY;
+		memcpy(req.params, params, sizeof(params));
+		req.paramLen = sizeof(params);
+		req.timeoutMs = 3000;
+	}
+	else
+	{
+		// 注册到库的后半段，允许覆盖（bit3），不返回中间状态（bit2）
+		uint16_t id = (uint16_t)(capacity / 2 + next_rand(&d->rng) % (capacity / 2));
+		const uint8_t params[5] = { (uint8_t)(id >> 8), (uint8_t)id, 0x02, 0x00, (1 << 3) | (1 << 2) };
+		req.cmd = CMD_AUTO_ENROLL;
+		memcpy(req.params, params, sizeof(params));
+		req.paramLen = sizeof(params);
+		req.timeoutMs = 8000;
+	}
+	d->busy.store(true, std::memory_order_relaxed);
+	if (fp_sched_submit(d->sched, &req) != ESP_OK)
+	{
+		d->busy.store(false, std::memory_order_relaxed);
+		d->doneUs.store(now, std::memory_order_relaxed);
+	}
+}
+
+// 命令脚本：所有设备共用一个线程，1ms粒度检查谁该做下一次操作
+static void script_loop(std::vector<Device*>* devices, const uint32_t mix[OP_KINDS], uint32_t thinkMs,
+	uint16_t capacity, const std::atomic<bool>* stop)
+{
+	while (!stop->load(std::memory_order_relaxed))
+	{
+		uint64_t now = fp_time_us();
+		for (Device* d : *devices)
+		{
+			if (d->busy.load(std::memory_order_acquire))
+				continue;
+			uint64_t done = d->doneUs.exchange(0, std::memory_order_relaxed);
+			if (done != 0)
+				d->nextUs = done + think_us(&d->rng, thinkMs);
+			if (now >= d->nextUs)
+			{
+				start_op(d, mix, capacity, now);
+				if (d->op == OP_LED)
+					d->nextUs = now + think_us(&d->rng, thinkMs);
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+}
+
+// ========================== 资源计量 ==========================
+static uint64_t cpu_us(const struct rusage* ru)
+{
+	return (uint64_t)(ru->ru_utime.tv_sec + ru->ru_stime.tv_sec) * 1000000 + ru->ru_utime.tv_usec + ru->ru_stime.tv_usec;
+}
+
+static uint64_t thread_cpu_us(std::thread* t)
+{
+	clockid_t cid;
+	struct timespec ts;
+	if (pthread_getcpuclockid(t->native_handle(), &cid) != 0 || clock_gettime(cid, &ts) != 0)
+		return 0;
+	return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// 各设备实际发给模块的LED帧数（LED通道会合并覆盖提交，按提交数计会虚高吞吐）
+static uint64_t leds_sent(const std::vector<Device*>& devices)
+{
+	uint64_t sent = 0;
+	for (Device* d : devices)
+	{
+		std::lock_guard<std::mutex> guard(d->sched->led.lock);
+		sent += d->sched->led.sent;
+	}
+	return sent;
+}
+
+// 读/proc/self/status中的一项（VmRSS、Threads等），单位按原文
+static long proc_status(const char* key)
+{
+	FILE* f = fopen("/proc/self/status", "r");
+	if (f == nullptr)
+		return -1;
+	char line[256];
+	long value = -1;
+	size_t keyLen = strlen(key);
+	while (fgets(line, sizeof(line), f) != nullptr)
+	{
+		if (strncmp(line, key, keyLen) == 0 && line[keyLen] == ':')
+		{
+			value = strtol(line + keyLen + 1, nullptr, 10);
+			break;
+		}
+	}
+	fclose(f);
+	return value;
+}
+
+// ========================== 端口 ==========================
+// 打开一对端口，返回主机侧和模块侧描述符
+static bool open_pair(bool pty, int* host, int* module)
+{
+	if (!pty)
+	{
+		int sv[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0)
+			return false;
+		fcntl(sv[1], F_SETFL, fcntl(sv[1], F_GETFL) | O_NONBLOCK);
+		*host = sv[0];
+		*module = sv[1];
+		return true;
+	}
+	int master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0)
+	{
+		if (master >= 0)
+			::close(master);
+		return false;
+	}
+	*host = fp_serial_open(ptsname(master), 57600);
+	if (*host < 0)
+	{
+		::close(master);
+		return false;
+	}
+	fcntl(master, F_SETFL, fcntl(master, F_GETFL) | O_NONBLOCK);
+	*module = master;
+	return true;
+}
+
+// ========================== 单级测量 ==========================
+struct Options
+{
+	std::vector<uint32_t> ladder;
+	uint32_t seconds;
+	uint32_t thinkMs;
+	uint32_t mix[OP_KINDS];
+	uint32_t baud;
+	uint32_t limitMs;
+	uint32_t seed;
+	bool pty;
+};
+
+struct StepReport
+{
+	uint32_t devices;
+	double cmdPerSec;
+	double cpuPctPerDevice;
+	double moduleCpuPct;
+	std::vector<uint32_t> latency[OP_KINDS];
+	uint64_t leds;             // 计量窗口内实际发给模块的LED帧（被覆盖合并的提交不算）
+	uint32_t failed;
+	uint32_t timeouts;
+	long rssKbPerDevice;
+	long threads;
+};
+
+static const uint16_t CAPACITY = 100;
+
+static bool run_step(const Options* o, uint32_t n, StepReport* rep)
+{
+	rep->devices = n;
+	long rssBefore = proc_status("VmRSS");
+
+	std::vector<Module> modules(n);
+	std::vector<Device*> devices;
+	for (uint32_t i = 0; i < n; i++)
+	{
+		int host, module;
+		if (!open_pair(o->pty, &host, &module))
+		{
+			fprintf(stderr, "第%u对端口打开失败：%s\n", i, strerror(errno));
+			for (uint32_t k = 0; k < i; k++)
+			{
+				::close(modules[k].fd);
+				::close(devices[k]->fd);
+				delete devices[k];
+			}
+			return false;
+		}
+		Module* m = &modules[i];
+		m->fd = module;
+		m->rxLen = 0;
+		fp_sim_init(&m->sim, CAPACITY);
+		for (uint16_t id = 0; id < 10; id++)
+			fp_sim_set_occupied(&m->sim, id, true);
+
+		Device* d = new Device();
+		d->fd = host;
+		d->rng = o->seed * 2654435761u + i + 1;
+		if (d->rng == 0)
+			d->rng = 1;
+		d->nextUs = fp_time_us() + think_us(&d->rng, o->thinkMs);
+		fp_transport_from_fd(&d->transport, &d->fd);
+		d->sched = new fp_scheduler_t();
+		fp_sched_init(d->sched, m->sim.addr, &d->transport);
+		devices.push_back(d);
+	}
+
+	ModuleServer srv;
+	srv.modules = &modules;
+	srv.baud = o->baud;
+	srv.stop = false;
+	std::thread moduleThread(module_loop, &srv);
+	for (Device* d : devices)
+		fp_sched_start(d->sched);
+
+	std::atomic<bool> stopScript(false);
+	g_measureUs = UINT64_MAX;
+	g_measureEndUs = UINT64_MAX;
+	std::thread scriptThread(script_loop, &devices, o->mix, o->thinkMs, CAPACITY, &stopScript);
+
+	// 预热后开始计量
+	std::this_thread::sleep_for(std::chrono::seconds(1));
+	uint64_t ledBefore = leds_sent(devices);
+	struct rusage ru0, ru1;
+	getrusage(RUSAGE_SELF, &ru0);
+	uint64_t module0 = thread_cpu_us(&moduleThread);
+	uint64_t t0 = fp_time_us();
+	g_measureUs = t0;
+
+	std::this_thread::sleep_for(std::chrono::seconds(o->seconds));
+
+	uint64_t t1 = fp_time_us();
+	g_measureEndUs = t1;
+	getrusage(RUSAGE_SELF, &ru1);
+	uint64_t module1 = thread_cpu_us(&moduleThread);
+	uint64_t elapsed = t1 - t0;
+	rep->leds = leds_sent(devices) - ledBefore;
+	rep->rssKbPerDevice = (proc_status("VmRSS") - rssBefore) / (long)n;
+	rep->threads = proc_status("Threads");
+
+	stopScript = true;
+	scriptThread.join();
+	for (Device* d : devices)
+		fp_sched_stop(d->sched);
+	srv.stop = true;
+	moduleThread.join();
+
+	uint64_t completed = 0;
+	for (Device* d : devices)
+	{
+		for (int k = 0; k < OP_KINDS; k++)
+			rep->latency[k].insert(rep->latency[k].end(), d->latency[k].begin(), d->latency[k].end());
+		completed += d->completed;
+		rep->failed += d->failed;
+		rep->timeouts += d->timeouts;
+		::close(d->fd);
+		delete d->sched;
+		delete d;
+	}
+	for (Module& m : modules)
+		::close(m.fd);
+
+	uint64_t hostCpu = cpu_us(&ru1) - cpu_us(&ru0) - (module1 - module0);
+	rep->cmdPerSec = (completed + rep->leds) * 1e6 / elapsed;
+	rep->cpuPctPerDevice = hostCpu * 100.0 / elapsed / n;
+	rep->moduleCpuPct = (module1 - module0) * 100.0 / elapsed;
+	return true;
+}
+
+// ========================== 主程序 ==========================
+static uint32_t service_us(uint8_t cmd)
+{
+	// 直接问模拟器，表头里给出模拟处理耗时，延迟减去它就是主机侧附加的部分
+	fp_sim_t sim;
+	fp_sim_init(&sim, CAPACITY);
+	const uint8_t params[5] = { 0x03, 0x00, 0x01, 0x00, (1 << 3) | (1 << 2) };
+	uint8_t payload[6] = { cmd };
+	memcpy(payload + 1, params, sizeof(params));
+	uint8_t frame[FP_MAX_FRAME_LEN], resp[FP_MAX_FRAME_LEN];
+	uint16_t len = fp_build_frame(sim.addr, PACKET_CMD, payload, sizeof(payload), frame, sizeof(frame));
+	fp_sim_handle(&sim, frame, len, resp, sizeof(resp));
+	return sim.serviceUs;
+}
+
+static bool parse_list(const char* text, uint32_t* out, size_t cap, std::vector<uint32_t>* vec)
+{
+	size_t n = 0;
+	for (const char* p = text; *p != '\0';)
+	{
+		char* end;
+		unsigned long v = strtoul(p, &end, 10);
+		if (end == p)
+			return false;
+		if (vec != nullptr)
+			vec->push_back((uint32_t)v);
+		else if (n < cap)
+			out[n] = (uint32_t)v;
+		n++;
+		p = *end == ',' ? end + 1 : end;
+	}
+	return vec != nullptr ? !vec->empty() : n == cap;
+}
+
+int main(int argc, char** argv)
+{
+	Options o;
+	o.seconds = 10;
+	o.thinkMs = 1000;
+	o.mix[OP_IDENTIFY] = 70;
+	o.mix[OP_ENROLL] = 5;
+	o.mix[OP_LED] = 25;
+	o.baud = 57600;
+	o.limitMs = 50;
+	o.seed = 1;
+	o.pty = false;
+	const char* ladder = "16,32,64,128,256";
+	int opt;
+	while ((opt = getopt(argc, argv, "n:d:t:m:b:c:s:p")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n': ladder = optarg; break;
+		case 'd': o.seconds = (uint32_t)atoi(optarg); break;
+		case 't': o.thinkMs = (uint32_t)atoi(optarg); break;
+		case 'm':
+			if (!parse_list(optarg, o.mix, OP_KINDS, nullptr))
+			{
+				fprintf(stderr, "比例应为三个数：识别,注册,LED\n");
+				return 1;
+			}
+			break;
+		case 'b': o.baud = (uint32_t)atoi(optarg); break;
+		case 'c': o.limitMs = (uint32_t)atoi(optarg); break;
+		case 's': o.seed = (uint32_t)strtoul(optarg, nullptr, 0); break;
+		case 'p': o.pty = true; break;
+		default:
+			fprintf(stderr, "用法：%s [-n 16,32,64,128,256] [-d 秒] [-t 思考时间ms] [-m 识别,注册,LED] "
+				"[-b 波特率] [-c 附加延迟上限ms] [-s 种子] [-p]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (!parse_list(ladder, nullptr, 0, &o.ladder) || o.seconds == 0 ||
+		o.mix[OP_IDENTIFY] + o.mix[OP_ENROLL] + o.mix[OP_LED] == 0)
+	{
+		fprintf(stderr, "参数无效\n");
+		return 1;
+	}
+
+	// 每台设备占两个描述符，伪终端模式还受系统pty数量限制
+	struct rlimit rl;
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+	{
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	uint32_t identifyUs = service_us(CMD_AUTO_IDENTIFY);
+	uint32_t enrollUs = service_us(CMD_AUTO_ENROLL);
+	printf("端口：%s，波特率：%u，思考时间：%ums，比例 识别:注册:LED = %u:%u:%u，每级%u秒\n",
+		o.pty ? "伪终端" : "socketpair", o.baud, o.thinkMs, o.mix[OP_IDENTIFY], o.mix[OP_ENROLL], o.mix[OP_LED], o.seconds);
+	printf("模拟处理耗时：识别%.0fms，注册%.0fms；调度器%u字节/台\n\n",
+		identifyUs / 1000.0, enrollUs / 1000.0, (unsigned)sizeof(fp_scheduler_t));
+	printf("%6s %9s %11s %9s %9s %9s %9s %9s %10s %6s %6s %11s %6s\n", "设备数", "命令/s", "CPU/台(%)",
+		"识别p50", "识别p99", "附加p99", "注册p50", "注册p99", "模拟CPU(%)", "失败", "超时", "RSS/台(KB)", "线程");
+
+	uint32_t ceiling = 0;
+	for (uint32_t n : o.ladder)
+	{
+		StepReport r = StepReport();
+		if (n == 0 || !run_step(&o, n, &r))
+			break;
+		uint64_t idP50 = percentile(&r.latency[OP_IDENTIFY], 500);
+		uint64_t idP99 = percentile(&r.latency[OP_IDENTIFY], 990);
+		uint64_t enP50 = percentile(&r.latency[OP_ENROLL], 500);
+		uint64_t enP99 = percentile(&r.latency[OP_ENROLL], 990);
+		double extraMs = idP99 > identifyUs ? (idP99 - identifyUs) / 1000.0 : 0.0;
+		printf("%6u %9.1f %11.3f %9.1f %9.1f %9.1f %9.1f %9.1f %10.1f %6u %6u %11ld %6ld\n", n, r.cmdPerSec,
+			r.cpuPctPerDevice, idP50 / 1000.0, idP99 / 1000.0, extraMs, enP50 / 1000.0, enP99 / 1000.0,
+			r.moduleCpuPct, r.failed, r.timeouts, r.rssKbPerDevice, r.threads);
+		fflush(stdout);
+		if (ceiling == 0 && (extraMs > o.limitMs || r.timeouts > 0))
+			ceiling = n;
+	}
+
+	printf("\n延迟为提交到完成回调的端到端时间（毫秒），附加p99 = 识别p99 - 模拟处理耗时（含应答的线路时间）；\n"
+		"CPU/台为主机协议栈与命令脚本的CPU时间占单核的百分比，已扣除模拟模块线程\n");
+	if (ceiling != 0)
+		printf("扩展上限：%u台时附加延迟超过%ums或出现超时\n", ceiling, o.limitMs);
+	else
+		printf("所测范围内未到上限\n");
+	return 0;
+}
@@ -0,0 +1,450 @@
+﻿#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "../fp_capture.h"
+#include "../fp_dispatch.h"
+#include "../fp_parser.h"
+
+// 离线抓包分析工具：mmap抓包文件，按字节区间切分给多个线程并行解码，
+// 输出各命令计数与延迟分位数、确认码分布、各设备（端口+地址）校验和错误率
+// 用法：fp_trace_analyzer [-j 线程数] 抓包文件...
+//
+// 文件按字节数均分为若干区间，每个区间的起点用fp_capture_resync对齐到记录边界，各线程只扫描自己的区间。
+// 同一设备的帧和命令/应答配对可能跨越区间边界，所以各线程对每条设备流
+// 先把"同步点"（第一条以包头开始的命令记录）之前的记录暂存下来，之后用全新的解码状态处理；
+// 全部线程结束后按区间顺序拼接：把暂存的记录接着喂给前一区间该设备流的解码状态，
+// 除同步点时尚未收齐的半帧应答计入丢弃字节外，结果与顺序解码一致
+
+// ========================== 延迟直方图 ==========================
+// 对数线性分桶（每个2倍区间8个桶，误差<12.5%），可直接相加合并
+#define HIST_BUCKETS 320
+
+struct LatencyHist
+{
+	uint32_t bucket[HIST_BUCKETS];
+	uint64_t count;
+	uint64_t maxUs;
+
+	static uint32_t index(uint64_t us)
+	{
+		if (us < 16)
+			return (uint32_t)us;
+		uint32_t e = 0; // 最高有效位
+		for (uint64_t v = us; v > 1; v >>= 1)
+			e++;
+		uint32_t idx = 16 + (e - 4) * 8 + (uint32_t)((us >> (e - 3)) & 7);
+		return idx < HIST_BUCKETS ? idx : HIST_BUCKETS - 1;
+	}
+
+	static uint64_t lower(uint32_t idx)
+	{
+		if (idx < 16)
+			return idx;
+		uint32_t e = (idx - 16) / 8 + 4;
+		return (uint64_t)(8 + (idx - 16) % 8) << (e - 3);
+	}
+
+	void add(uint64_t us)
+	{
+		bucket[index(us)]++;
+		count++;
+		maxUs = std::max(maxUs, us);
+	}
+
+	void merge(const LatencyHist& o)
+	{
+		for (uint32_t i = 0; i < HIST_BUCKETS; i++)
+			bucket[i] += o.bucket[i];
+		count += o.count;
+		maxUs = std::max(maxUs, o.maxUs);
+	}
+
+	uint64_t percentile(double p) const
+	{
+		if (count == 0)
+			return 0;
+		uint64_t target = (uint64_t)(p * (count - 1)) + 1;
+		uint64_t acc = 0;
+		for (uint32_t i = 0; i < HIST_BUCKETS; i++)
+		{
+			acc += bucket[i];
+			if (acc >= target)
+				return std::min(lower(i), maxUs);
+		}
+		return maxUs;
+	}
+};
+
+// ========================== 统计结构 ==========================
+struct CmdStats
+{
+	uint64_t count;      // 命令数
+	uint64_t answered;   // 收到应答数
+	uint64_t ok;         // 确认码0x00
+	LatencyHist latency; // 命令到应答的延迟
+};
+
+struct DeviceStats
+{
+	uint8_t port;
+	uint8_t addr[4];
+	uint64_t bytes;
+	uint64_t txFrames;
+	uint64_t rxFrames;
+	uint64_t txChecksumErrors;
+	uint64_t rxChecksumErrors;
+	uint64_t lengthErrors;
+	uint64_t droppedBytes;
+	uint64_t unanswered; // 下一条命令发出前仍未收到应答
+	uint64_t orphans;    // 没有对应命令的应答
+	uint64_t confirm[256];
+};
+
+struct GlobalStats
+{
+	CmdStats cmd[256];
+	uint64_t confirm[256];
+	uint64_t records;
+	uint64_t bytes;
+};
+
+// 单个设备的解码状态
+struct DeviceDecoder
+{
+	DeviceStats stats;
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> tx;
+	fp_parser_buf_t<FP_MAX_FRAME_LEN> rx;
+	GlobalStats* global;
+	uint64_t curTs;      // 当前记录时间戳
+	bool pending;        // 有等待应答的命令
+	uint8_t pendingCmd;
+	uint64_t pendingTs;
+};
+
+static void on_tx_frame(void* user, const uint8_t* frame, uint16_t len, fp_frame_result_t result)
+{
+	DeviceDecoder* d = (DeviceDecoder*)user;
+	(void)len;
+	if (result != FP_FRAME_OK)
+	{
+		d->stats.txChecksumErrors += (result == FP_FRAME_BAD_CHECKSUM);
+		return;
+	}
+	d->stats.txFrames++;
+	if (frame[FP_PID_INDEX] != PACKET_CMD)
+		return; // 下载数据包不参与命令配对
+	if (d->pending)
+		d->stats.unanswered++;
+	uint8_t cmd = frame[FP_PAYLOAD_INDEX];
+	d->global->cmd[cmd].count++;
+	d->pending = true;
+	d->pendingCmd = cmd;
+	d->pendingTs = d->curTs;
+}
+
+static void on_rx_frame(void* user, const uint8_t* frame, uint16_t len, fp_frame_result_t result)
+{
+	DeviceDecoder* d = (DeviceDecoder*)user;
+	(void)len;
+	if (result != FP_FRAME_OK)
+	{
+		d->stats.rxChecksumErrors += (result == FP_FRAME_BAD_CHECKSUM);
+		return;
+	}
+	d->stats.rxFrames++;
+	if (frame[FP_PID_INDEX] != PACKET_RESPONSE)
+		return; // 上传数据包
+	uint8_t confirm = frame[FP_PAYLOAD_INDEX];
+	d->stats.confirm[confirm]++;
+	d->global->confirm[confirm]++;
+	if (!d->pending)
+	{
+		d->stats.orphans++;
+		return;
+	}
+	CmdStats* cs = &d->global->cmd[d->pendingCmd];
+	cs->answered++;
+	cs->ok += (confirm == 0x00);
+	cs->latency.add(d->curTs > d->pendingTs ? d->curTs - d->pendingTs : 0); // 并发写入的时间戳可能略有倒序
+	d->pending = false;
+}
+
+// 设备流按端口+地址区分：各串口上的设备常常都用默认地址FFFFFFFF
+static uint64_t stream_key(uint8_t port, const uint8_t addr[4])
+{
+	return ((uint64_t)port << 32) | ((uint32_t)addr[0] << 24) | ((uint32_t)addr[1] << 16) | ((uint32_t)addr[2] << 8) | addr[3];
+}
+
+static DeviceDecoder* new_decoder(uint8_t port, const uint8_t addr[4], GlobalStats* global)
+{
+	DeviceDecoder* d = (DeviceDecoder*)calloc(1, sizeof(DeviceDecoder));
+	d->stats.port = port;
+	memcpy(d->stats.addr, addr, 4);
+	d->global = global;
+	fp_parser_init(&d->tx, on_tx_frame, d);
+	fp_parser_init(&d->rx, on_rx_frame, d);
+	return d;
+}
+
+static void decode_record(DeviceDecoder* d, const fp_capture_record_t* rec)
+{
+	d->curTs = rec->tsUs;
+	d->stats.bytes += rec->len;
+	d->global->records++;
+	d->global->bytes += rec->len;
+	fp_parser_feed(rec->dir == FP_DIR_TX ? &d->tx : &d->rx, rec->data, rec->len);
+}
+
+// 解码结束：解析器里剩下的半帧计入丢弃字节，还在等应答的命令计入未应答
+static void finish_decoder(DeviceDecoder* d)
+{
+	d->stats.lengthErrors = d->tx.lengthErrors + d->rx.lengthErrors;
+	d->stats.droppedBytes = d->tx.droppedBytes + d->rx.droppedBytes + d->tx.have + d->rx.have;
+	d->stats.unanswered += d->pending;
+}
+
+static void add_stats(DeviceStats* sum, const DeviceStats* s)
+{
+	sum->port = s->port;
+	memcpy(sum->addr, s->addr, 4);
+	sum->bytes += s->bytes;
+	sum->txFrames += s->txFrames;
+	sum->rxFrames += s->rxFrames;
+	sum->txChecksumErrors += s->txChecksumErrors;
+	sum->rxChecksumErrors += s->rxChecksumErrors;
+	sum->lengthErrors += s->lengthErrors;
+	sum->droppedBytes += s->droppedBytes;
+	sum->unanswered += s->unanswered;
+	sum->orphans += s->orphans;
+	for (uint32_t c = 0; c < 256; c++)
+		sum->confirm[c] += s->confirm[c];
+}
+
+// 同步点：以包头开始的命令记录（主机写串口按整帧写，新命令开始时上一帧已经发完）
+static bool is_sync_point(const fp_capture_record_t* rec)
+{
+	return rec->dir == FP_DIR_TX && rec->len > FP_PID_INDEX && rec->data[0] == FP_HEADER_0 &&
+		rec->data[1] == FP_HEADER_1 && rec->data[FP_PID_INDEX] == PACKET_CMD;
+}
+
+// ========================== 并行分析 ==========================
+// 一个区间里的一条设备流
+struct WorkerStream
+{
+	std::vector<fp_capture_record_t> head; // 同步点之前的记录（拼接时交给前一区间的解码状态）
+	DeviceDecoder* decoder;                // 同步点开始的解码状态（没遇到同步点为nullptr）
+};
+
+struct Worker
+{
+	size_t begin;
+	size_t end;
+	GlobalStats global;
+	std::vector<uint64_t> order; // 设备流首次出现的顺序（输出稳定）
+	std::unordered_map<uint64_t, WorkerStream> streams;
+};
+
+static void run_worker(const fp_capture_reader_t* file, Worker* w)
+{
+	fp_capture_reader_t r = *file;
+	r.map = nullptr; // 共享映射，只读不释放
+	r.pos = w->begin;
+	fp_capture_record_t rec;
+	uint64_t lastKey = UINT64_MAX;
+	WorkerStream* ws = nullptr;
+	while (r.pos < w->end && fp_capture_next(&r, &rec))
+	{
+		uint64_t key = stream_key(rec.port, rec.addr);
+		if (key != lastKey)
+		{
+			lastKey = key; // 同一设备的记录通常连续出现，缓存上次的查找
+			auto it = w->streams.find(key);
+			if (it == w->streams.end())
+			{
+				it = w->streams.emplace(key, WorkerStream()).first;
+				it->second.decoder = nullptr;
+				w->order.push_back(key);
+			}
+			ws = &it->second;
+		}
+		if (ws->decoder == nullptr)
+		{
+			if (!is_sync_point(&rec))
+			{
+				ws->head.push_back(rec);
+				continue;
+			}
+			ws->decoder = new_decoder(rec.port, rec.addr, &w->global);
+		}
+		decode_record(ws->decoder, &rec);
+	}
+}
+
+static bool analyze_file(const char* path, unsigned threads, GlobalStats* global, std::vector<DeviceStats>* devices)
+{
+	fp_capture_reader_t file;
+	if (fp_capture_reader_open(&file, path) != ESP_OK)
+	{
+		printf("错误: 无法打开抓包文件%s\n", path);
+		return false;
+	}
+
+	// 按字节均分，每段起点对齐到记录边界（区间太小时少开线程）
+	size_t data = file.size - FP_CAPTURE_FILE_HDR;
+	unsigned n = (unsigned)std::max<size_t>(1, std::min<size_t>(threads, data / (64 * 1024) + 1));
+	std::vector<Worker*> workers;
+	size_t prev = FP_CAPTURE_FILE_HDR;
+	for (unsigned i = 0; i < n; i++)
+	{
+		size_t end = i + 1 == n ? file.size : fp_capture_resync(&file, FP_CAPTURE_FILE_HDR + data / n * (i + 1));
+		if (end <= prev)
+			continue;
+		Worker* w = new Worker(); // 值初始化，统计数组清零
+		w->begin = prev;
+		w->end = end;
+		workers.push_back(w);
+		prev = end;
+	}
+	std::vector<std::thread> pool;
+	for (Worker* w : workers)
+		pool.emplace_back(run_worker, &file, w);
+	for (auto& t : pool)
+		t.join();
+
+	// 按区间顺序拼接设备流：暂存记录接着喂给上一段的解码状态，遇到同步点后换成本段的解码状态
+	std::unordered_map<uint64_t, DeviceDecoder*> carry;
+	std::unordered_map<uint64_t, DeviceStats> totals;
+	std::vector<uint64_t> order;
+	for (Worker* w : workers)
+	{
+		for (uint64_t key : w->order)
+		{
+			WorkerStream* ws = &w->streams[key];
+			DeviceDecoder*& c = carry[key];
+			if (c == nullptr)
+			{
+				order.push_back(key); // 首次出现的设备流，同步点之前的记录从头解码
+				if (!ws->head.empty())
+					c = new_decoder(ws->head[0].port, ws->head[0].addr, global);
+			}
+			for (const fp_capture_record_t& rec : ws->head)
+				decode_record(c, &rec);
+			if (ws->decoder == nullptr)
+				continue;
+			if (c != nullptr)
+			{
+				// 同步点的命令发出时上一条命令还没有应答，顺序解码也会在这里计为未应答
+				finish_decoder(c);
+				add_stats(&totals[key], &c->stats);
+				free(c);
+			}
+			c = ws->decoder;
+		}
+	}
+	for (auto& kv : carry)
+	{
+		if (kv.second == nullptr)
+			continue;
+		finish_decoder(kv.second);
+		add_stats(&totals[kv.first], &kv.second->stats);
+		free(kv.second);
+	}
+	for (uint64_t key : order)
+		devices->push_back(totals[key]);
+
+	// 合并
+	for (Worker* w : workers)
+	{
+		for (uint32_t c = 0; c < 256; c++)
+		{
+			global->cmd[c].count += w->global.cmd[c].count;
+			global->cmd[c].answered += w->global.cmd[c].answered;
+			global->cmd[c].ok += w->global.cmd[c].ok;
+			global->cmd[c].latency.merge(w->global.cmd[c].latency);
+			global->confirm[c] += w->global.confirm[c];
+		}
+		global->records += w->global.records;
+		global->bytes += w->global.bytes;
+		delete w;
+	}
+	fp_capture_reader_close(&file);
+	return true;
+}
+
+// ========================== 输出 ==========================
+static void print_report(const GlobalStats* g, std::vector<DeviceStats>* devices, double seconds)
+{
+	printf("记录%llu条，%.1fMB，设备%zu台，耗时%.2fs（%.1fMB/s）\n",
+		(unsigned long long)g->records, g->bytes / 1e6, devices->size(), seconds,
+		seconds > 0 ? g->bytes / 1e6 / seconds : 0.0);
+
+	printf("\n%-6s %-18s %10s %10s %8s %9s %9s %9s %9s\n", "指令", "名称", "次数", "应答", "成功率", "p50(ms)", "p90(ms)", "p99(ms)", "max(ms)");
+	for (uint32_t c = 0; c < 256; c++)
+	{
+		const CmdStats* cs = &g->cmd[c];
+		if (cs->count == 0)
+			continue;
+		printf("0x%02X   %-18s %10llu %10llu %7.2f%% %9.2f %9.2f %9.2f %9.2f\n", c, fp_dispatch_name((uint8_t)c),
+			(unsigned long long)cs->count, (unsigned long long)cs->answered,
+			cs->answered ? 100.0 * cs->ok / cs->answered : 0.0,
+			cs->latency.percentile(0.50) / 1000.0, cs->latency.percentile(0.90) / 1000.0,
+			cs->latency.percentile(0.99) / 1000.0, cs->latency.maxUs / 1000.0);
+	}
+
+	printf("\n确认码分布：\n");
+	for (uint32_t c = 0; c < 256; c++)
+	{
+		if (g->confirm[c])
+			printf("  0x%02X: %llu\n", c, (unsigned long long)g->confirm[c]);
+	}
+
+	std::sort(devices->begin(), devices->end(), [](const DeviceStats& a, const DeviceStats& b) {
+		return stream_key(a.port, a.addr) < stream_key(b.port, b.addr);
+	});
+	printf("\n%-4s %-10s %10s %10s %10s %9s %10s %8s %8s\n", "端口", "设备地址", "发送帧", "接收帧", "校验错误", "错误率", "丢弃字节", "未应答", "孤立应答");
+	for (const DeviceStats& d : *devices)
+	{
+		uint64_t bad = d.txChecksumErrors + d.rxChecksumErrors;
+		uint64_t frames = d.txFrames + d.rxFrames + bad;
+		printf("%-4u %02X%02X%02X%02X   %10llu %10llu %10llu %8.3f%% %10llu %8llu %8llu\n", d.port,
+			d.addr[0], d.addr[1], d.addr[2], d.addr[3],
+			(unsigned long long)d.txFrames, (unsigned long long)d.rxFrames, (unsigned long long)bad,
+			frames ? 100.0 * bad / frames : 0.0, (unsigned long long)d.droppedBytes,
+			(unsigned long long)d.unanswered, (unsigned long long)d.orphans);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+	int first = 1;
+	if (argc > 2 && strcmp(argv[1], "-j") == 0)
+	{
+		threads = (unsigned)std::max(1, atoi(argv[2]));
+		first = 3;
+	}
+	if (first >= argc)
+	{
+		printf("用法：%s [-j 线程数] 抓包文件...\n", argv[0]);
+		return 1;
+	}
+
+	GlobalStats* global = (GlobalStats*)calloc(1, sizeof(GlobalStats));
+	std::vector<DeviceStats> devices;
+	uint64_t start = fp_time_us();
+	for (int i = first; i < argc; i++)
+	{
+		if (!analyze_file(argv[i], threads, global, &devices))
+		{
+			free(global);
+			return 1;
+		}
+	}
+	print_report(global, &devices, (fp_time_us() - start) / 1e6);
+	free(global);
+	return 0;
+}
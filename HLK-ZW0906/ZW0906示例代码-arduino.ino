@@ -24,6 +24,9 @@ const uint8_t CMD_STORE_CHAR = 0x06; // 存储模板
 const uint8_t CMD_CLEAR_LIB = 0x0D;   // 清空指纹库
 const uint8_t CMD_READ_SYSPARA = 0x0F; // 读模组基本参数
 
+// 应答缓冲区大小：最长的应答是读模组基本参数（28字节），按32字节分配，超出部分丢弃
+const uint8_t RESPONSE_MAX_LEN = 32;
+
 // 定义缓冲区ID
 uint8_t BUFFER_ID = 0;
 
@@ -50,6 +53,15 @@ void printHex(uint8_t* data, uint8_t len) {
   Serial.println();
 }
 
+// 读取大端（高字节在前）字段
+u16 read_be16(const uint8_t* p) {
+  return (u16)(p[0] << 8) | p[1];
+}
+
+u32 read_be32(const uint8_t* p) {
+  return ((u32)p[0] << 24) | ((u32)p[1] << 16) | ((u32)p[2] << 8) | p[3];
+}
+
 void setup() {
   // 初始化串口
   Serial.begin(57600);
@@ -127,7 +139,7 @@ int run_command(void)
 //读模组基本参数
 int read_FP_info(void)
 {
-  uint8_t response[32];
+  uint8_t response[RESPONSE_MAX_LEN];
   uint8_t index = 0;
   uint32_t startTime = millis();
 
@@ -147,12 +159,12 @@ int read_FP_info(void)
 
   // 检查确认码
   if (index >= 28 && response[9] == 0x00) {
-    u16 register_cnt = (u16)(response[10]<<8) | response[11];
-    u16 fp_temp_size = (u16)(response[12]<<8) | response[13];
-    u16 fp_lib_size  = (u16)(response[14]<<8) | response[15];
-    u16 score_level  = (u16)(response[16]<<8) | response[17];
-    u32 device_addr  = (u32)(response[18]<<24) | (response[19]<<16)| (response[20]<<8) | response[21];
-    u16 data_pack_size = (u16)(response[22]<<8) | response[23];
+    u16 register_cnt = read_be16(response + 10);
+    u16 fp_temp_size = read_be16(response + 12);
+    u16 fp_lib_size  = read_be16(response + 14);
+    u16 score_level  = read_be16(response + 16);
+    u32 device_addr  = read_be32(response + 18);
+    u16 data_pack_size = read_be16(response + 22);
     if(0 == data_pack_size) {
       data_pack_size = 32;
     }
@@ -165,7 +177,7 @@ int read_FP_info(void)
     else if(3 == data_pack_size) {
       data_pack_size = 256;
     }
-    u16 baud_set = (u16)(response[24]<<8) | response[25];
+    u16 baud_set = read_be16(response + 24);
     
     Serial.print("register cnt:");
     Serial.println(register_cnt);
@@ -405,14 +417,17 @@ void sendCommand1(uint8_t cmd, uint8_t param1, uint16_t param2, uint16_t param3)
 
 // 接收响应包
 bool receiveResponse() {
-  uint8_t response[50];
+  uint8_t response[RESPONSE_MAX_LEN];
   uint8_t index = 0;
   uint32_t startTime = millis();
 
   // 等待响应包
   while (millis() - startTime < 200) {
     if (fingerprintSerial.available()) {
-      response[index++] = fingerprintSerial.read();
+      uint8_t b = fingerprintSerial.read();
+      if (index < RESPONSE_MAX_LEN) {
+        response[index++] = b;
+      }
     }
   }
 
@@ -48,19 +48,58 @@
 #define CHECKSUM_LEN 2         // 校验和长度（字节）
 #define CHECKSUM_START_INDEX 6 // 校验和计算起始索引（固定，从0开始）
 
+// 指纹库容量：决定设备上下文中ID数组的大小和索引表的解析范围，可在编译选项中覆盖
+// 指纹ID和计数以uint8_t保存，且只解析索引表第0页（32字节），所以不能超过255
+#ifndef FP_SLOT_CAPACITY
+#define FP_SLOT_CAPACITY 100
+#endif
+static_assert(FP_SLOT_CAPACITY >= 1 && FP_SLOT_CAPACITY <= 255, "FP_SLOT_CAPACITY必须在1-255之间");
+
 const uint8_t FRAME_HEADER[2] = { 0xEF, 0x01 };          // 帧头
-uint8_t g_deviceAddress[4] = { 0xFF, 0xFF, 0xFF, 0xFF }; // 设备地址
-uint8_t g_fingerIDArray[100] = { 0xFF };                 // 指纹模块最大容量为100枚指纹
-uint8_t g_fingerNumber = 0;                            // 有效指纹数量
+
+// 设备上下文：每个指纹模块一份，驱动函数不读写任何可变全局状态
+// 线程安全约定：
+//   组帧函数和verify_received_data只读取上下文，同一上下文可被多个线程同时使用
+//   fingerprint_parse_frame写入上下文中的解析结果，同一上下文同一时刻只能由一个线程调用
+//   不同上下文之间互不影响，每个线程持有自己的上下文时无需加锁
+typedef struct
+{
+	uint8_t address[4];                      // 设备地址
+	uint8_t fingerIDArray[FP_SLOT_CAPACITY]; // 已注册的指纹ID
+	uint8_t fingerNumber;                    // 有效指纹数量
+} fp_device_t;
+
+/**
+ * @brief 初始化设备上下文
+ * @param dev 设备上下文
+ * @param address 设备地址（出厂默认为FFFFFFFF）
+ */
+void fp_device_init(fp_device_t* dev, const uint8_t address[4])
+{
+	memcpy(dev->address, address, sizeof(dev->address));
+	memset(dev->fingerIDArray, 0xFF, sizeof(dev->fingerIDArray));
+	dev->fingerNumber = 0;
+}
 
 // ========================== 通用工具函数 ==========================
+/**
+ * @brief 读取大端（高字节在前）的16位字段
+ * @param p 字段起始位置
+ * @return 字段值
+ */
+static inline uint16_t read_be16(const uint8_t* p)
+{
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
 /**
  * @brief 校验指纹模块接收数据的有效性（重点验证校验和）
+ * @param dev 设备上下文
  * @param recvData 接收的数据包缓冲区
  * @param dataLen 实际接收的字节数（必须显式传入，不能用strlen计算）
  * @return 校验结果：true=有效数据，ESP_FAIL=无效数据
  */
-esp_err_t verify_received_data(const uint8_t* recvData, uint16_t dataLen)
+esp_err_t verify_received_data(const fp_device_t* dev, const uint8_t* recvData, uint16_t dataLen)
 {
 	// 基础合法性检查
 	if (recvData == nullptr || dataLen < 12) // 最小应答帧长度为12字节
@@ -78,10 +117,10 @@ esp_err_t verify_received_data(const uint8_t* recvData, uint16_t dataLen)
 	// 验证设备地址
 	for (int i = 2; i < 6; i++)
 	{
-		if (recvData[i] != g_deviceAddress[i - 2])
+		if (recvData[i] != dev->address[i - 2])
 		{
 			printf("校验失败：设备地址不匹配, 应为%02X%02X%02X%02X，实际为%02X%02X%02X%02X\n",
-				g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3],
+				dev->address[0], dev->address[1], dev->address[2], dev->address[3],
 				recvData[2], recvData[3], recvData[4], recvData[5]);
 			return ESP_FAIL;
 		}
@@ -93,7 +132,7 @@ esp_err_t verify_received_data(const uint8_t* recvData, uint16_t dataLen)
 		return ESP_FAIL;
 	}
 	// 验证长度
-	uint16_t expectedDataLen = (recvData[7] << 8) | recvData[8]; // 数据长度（高字节在前）
+	uint16_t expectedDataLen = read_be16(recvData + 7);         // 数据长度（高字节在前）
 	if (expectedDataLen + 9 != dataLen)                          // 包头(2) + 设备地址(4) + 包标识(1) + 数据长度(2) + 校验和(2)
 	{
 		printf("校验失败：数据长度不匹配（期望=%d，实际=%d）\n", expectedDataLen + 9, dataLen);
@@ -101,7 +140,7 @@ esp_err_t verify_received_data(const uint8_t* recvData, uint16_t dataLen)
 	}
 
 	// 提取校验和（最后2字节，高字节在前）
-	uint16_t receivedChecksum = (recvData[dataLen - 2] << 8) | recvData[dataLen - 1];
+	uint16_t receivedChecksum = read_be16(recvData + dataLen - 2);
 
 	// 计算校验范围数据的累加和（包标识+数据长度+指令结果）
 	// 校验范围：从索引6（包标识）到索引dataLen-3（校验和前1字节）
@@ -151,6 +190,7 @@ uint16_t calculate_checksum(const uint8_t* recvData, uint16_t dataLen)
 // ========================== 功能函数 ==========================
 /**
  * @brief 指纹模块自动注册函数
+ * @param dev 设备上下文
  * @param ID 指纹ID号（2字节，高字节在前）
  * @param enrollTimes 录入次数（0-5，超出范围返回失败，0和1效果相同）
  * @param ledControl 采图背光灯控制（bit0）：false=常亮；true=采图成功后熄灭
@@ -161,15 +201,15 @@ uint16_t calculate_checksum(const uint8_t* recvData, uint16_t dataLen)
  * @param requireRemove 手指离开要求（bit5）：false=需离开；true=无需离开
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t auto_enroll(uint16_t ID, uint8_t enrollTimes,
+esp_err_t auto_enroll(const fp_device_t* dev, uint16_t ID, uint8_t enrollTimes,
 	bool ledControl, bool preprocess,
 	bool returnStatus, bool allowOverwrite,
 	bool allowDuplicate, bool requireRemove)
 {
 	// 参数合法性检查
-	if (ID >= 100)
+	if (ID >= FP_SLOT_CAPACITY)
 	{
-		printf("错误: 指纹ID号必须在0-99之间\n");
+		printf("错误: 指纹ID号必须在0-%d之间\n", FP_SLOT_CAPACITY - 1);
 		return ESP_FAIL;
 	}
 	if (enrollTimes > 5)
@@ -190,7 +230,7 @@ esp_err_t auto_enroll(uint16_t ID, uint8_t enrollTimes,
 	// 计算数据帧长度：帧头(6) + 命令码(2) + 数据长度和指令(2) + ID(2) + 录入次数(1) + 参数(2) + 校验和(2) = 17
 	uint8_t frame[17] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x08,                                                                     // 数据长度(2字节)
 		CMD_AUTO_ENROLL,                                                                // 指令(1字节)
@@ -220,6 +260,7 @@ esp_err_t auto_enroll(uint16_t ID, uint8_t enrollTimes,
 }
 /**
  * @brief 指纹模块自动识别函数
+ * @param dev 设备上下文
  * @param ID 指纹ID号（2字节，高字节在前）
  *           - 具体数值（如1对应0x0001）：验证指定ID的指纹
  *           - 0xFFFF：验证所有已注册的指纹
@@ -229,7 +270,7 @@ esp_err_t auto_enroll(uint16_t ID, uint8_t enrollTimes,
  * @param returnStatus 识别状态返回控制（bit2）：false=返回状态；true=不返回状态
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t auto_identify(uint16_t ID, uint8_t scoreLevel, bool ledControl, bool preprocess, bool returnStatus)
+esp_err_t auto_identify(const fp_device_t* dev, uint16_t ID, uint8_t scoreLevel, bool ledControl, bool preprocess, bool returnStatus)
 {
 	// 组装参数（PR，bit0-bit2）
 	uint16_t param = 0;
@@ -240,7 +281,7 @@ esp_err_t auto_identify(uint16_t ID, uint8_t scoreLevel, bool ledControl, bool p
 	// 构建数据帧（共15字节）
 	uint8_t frame[17] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节，SC=命令包)
 		0x00, 0x08,                                                                     // 数据长度(2字节)
 		CMD_AUTO_IDENTIFY,                                                              // 指令码(PS_Autoldentify)
@@ -270,13 +311,14 @@ esp_err_t auto_identify(uint16_t ID, uint8_t scoreLevel, bool ledControl, bool p
 }
 /**
  * @brief 指纹模块LED控制函数
+ * @param dev 设备上下文
  * @param functionCode 功能码（参考BLN_xxx宏定义，1-7有效）
  * @param startColor 起始颜色（bit0-蓝，bit1-绿，bit2-红，0x00-全灭，0x07-全亮）
  * @param endColor 结束颜色（仅功能码1-普通呼吸灯有效，其他功能无效）
  * @param cycleTimes 循环次数（仅功能码1-呼吸灯/2-闪烁灯有效，0=无限循环）
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t control_led(uint8_t functionCode, uint8_t startColor,
+esp_err_t control_led(const fp_device_t* dev, uint8_t functionCode, uint8_t startColor,
 	uint8_t endColor, uint8_t cycleTimes)
 {
 	// 参数合法性检查
@@ -300,7 +342,7 @@ esp_err_t control_led(uint8_t functionCode, uint8_t startColor,
 
 	uint8_t frame[16] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x07,                                                                     // 数据长度(2字节)
 		CMD_CONTROL_BLN,                                                                // 指令(1字节)
@@ -332,6 +374,7 @@ esp_err_t control_led(uint8_t functionCode, uint8_t startColor,
 
 /**
  * @brief 指纹模块LED七彩呼吸灯控制函数
+ * @param dev 设备上下文
  * @param timeBit 呼吸周期时间参数（取值1-100，分别对应0.1秒-10秒）
  * @param high1 第1组高4位配置
  * @param low1 第1组低4位配置
@@ -356,7 +399,7 @@ esp_err_t control_led(uint8_t functionCode, uint8_t startColor,
  *
  * @return 操作结果（ESP_OK表示成功，其他值表示失败）
  */
-esp_err_t control_colorful_led(uint8_t timeBit,
+esp_err_t control_colorful_led(const fp_device_t* dev, uint8_t timeBit,
 	uint8_t high1, uint8_t low1,
 	uint8_t high2, uint8_t low2,
 	uint8_t high3, uint8_t low3,
@@ -388,8 +431,8 @@ esp_err_t control_colorful_led(uint8_t timeBit,
 	// 帧数据组装
 	uint8_t frame[20] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1],         // 设备地址(4字节)
-		g_deviceAddress[2], g_deviceAddress[3],
+		dev->address[0], dev->address[1],               // 设备地址(4字节)
+		dev->address[2], dev->address[3],
 		PACKET_CMD,                                     // 包标识(1字节)
 		0x00, 0x0B,                                     // 数据长度(2字节)
 		CMD_CONTROL_BLN,                                // 指令(1字节)
@@ -422,16 +465,17 @@ esp_err_t control_colorful_led(uint8_t timeBit,
 
 /**
  * @brief 删除一定数量的指纹
+ * @param dev 设备上下文
  * @param ID：指纹号
  * @param count：删除数量
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t delet_char(uint16_t ID, uint16_t count)
+esp_err_t delet_char(const fp_device_t* dev, uint16_t ID, uint16_t count)
 {
 	// 参数合法性检查
-	if (ID >= 100)
+	if (ID >= FP_SLOT_CAPACITY)
 	{
-		printf("错误: 指纹ID号必须在0-99之间\n");
+		printf("错误: 指纹ID号必须在0-%d之间\n", FP_SLOT_CAPACITY - 1);
 		return ESP_FAIL;
 	}
 	if (count == 0 || count > 5)
@@ -442,7 +486,7 @@ esp_err_t delet_char(uint16_t ID, uint16_t count)
 
 	uint8_t frame[16] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x07,                                                                     // 数据长度(2字节)
 		CMD_DELET_CHAR,                                                                 // 指令(1字节)
@@ -472,14 +516,14 @@ esp_err_t delet_char(uint16_t ID, uint16_t count)
 
 /**
  * @brief 清空所有指纹
- * @param 无参数
+ * @param dev 设备上下文
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t empty()
+esp_err_t empty(const fp_device_t* dev)
 {
 	uint8_t frame[12] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x03,                                                                     // 数据长度(2字节)
 		CMD_EMPTY,                                                                      // 指令(1字节)
@@ -504,14 +548,14 @@ esp_err_t empty()
 
 /**
  * @brief 取消指令
- * @param 无参数
+ * @param dev 设备上下文
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t cancel()
+esp_err_t cancel(const fp_device_t* dev)
 {
 	uint8_t frame[12] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x03,                                                                     // 数据长度(2字节)
 		CMD_CANCEL,                                                                     // 指令(1字节)
@@ -535,14 +579,14 @@ esp_err_t cancel()
 }
 /**
  * @brief 休眠指令
- * @param 无参数
+ * @param dev 设备上下文
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t sleep()
+esp_err_t sleep(const fp_device_t* dev)
 {
 	uint8_t frame[12] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x03,                                                                     // 数据长度(2字节)
 		CMD_SLEEP,                                                                      // 指令(1字节)
@@ -566,14 +610,15 @@ esp_err_t sleep()
 }
 /**
  * @brief 读索引表
+ * @param dev 设备上下文
  * @param page 页码（0-4）
  * @return 操作是否成功（参数有效且帧组装成功返回true）
  */
-esp_err_t read_index_table(uint8_t page)
+esp_err_t read_index_table(const fp_device_t* dev, uint8_t page)
 {
 	uint8_t frame[13] = {
 		FRAME_HEADER[0], FRAME_HEADER[1],                                               // 包头(2字节)
-		g_deviceAddress[0], g_deviceAddress[1], g_deviceAddress[2], g_deviceAddress[3], // 设备地址(4字节)
+		dev->address[0], dev->address[1], dev->address[2], dev->address[3],             // 设备地址(4字节)
 		PACKET_CMD,                                                                     // 包标识(1字节)
 		0x00, 0x04,                                                                     // 数据长度(2字节)
 		CMD_READ_INDEX_TABLE,                                                           // 指令(1字节)
@@ -599,25 +644,26 @@ esp_err_t read_index_table(uint8_t page)
 
 /**
  * @brief 解析读索引表命令返回的数据帧，提取指纹ID信息
+ * @param dev 设备上下文
  * @param recvData 接收的数据包缓冲区
  * @param dataLen 实际接收的字节数（必须显式传入，不能用strlen计算）
  * @return 操作是否成功（参数有效且解析成功返回ESP_OK，否则返回对应错误码）
  */
-esp_err_t fingerprint_parse_frame(const uint8_t* recvData, uint16_t dataLen)
+esp_err_t fingerprint_parse_frame(fp_device_t* dev, const uint8_t* recvData, uint16_t dataLen)
 {
-	if (!verify_received_data(recvData, dataLen))
+	if (!verify_received_data(dev, recvData, dataLen))
 	{
 		return ESP_FAIL; // 保持你的返回值风格
 	}
 
-	memset(g_fingerIDArray, 0xFF, sizeof(g_fingerIDArray));
-	g_fingerNumber = 0;
+	memset(dev->fingerIDArray, 0xFF, sizeof(dev->fingerIDArray));
+	dev->fingerNumber = 0;
 
 	// 优化的解析部分
 	uint8_t mask[] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
 	uint8_t temp_num = 0; // 局部变量暂存计数
 
-	for (uint8_t i = 10; i <= 22; i++)
+	for (uint8_t i = 10; i < 10 + (FP_SLOT_CAPACITY + 7) / 8; i++)
 	{
 		uint8_t byte = recvData[i];
 		if (byte == 0)
@@ -627,23 +673,23 @@ esp_err_t fingerprint_parse_frame(const uint8_t* recvData, uint16_t dataLen)
 		{
 			if (byte & mask[j])
 			{
-				g_fingerIDArray[temp_num] = (i - 10) * 8 + j;
+				dev->fingerIDArray[temp_num] = (i - 10) * 8 + j;
 				temp_num++;
-				if (temp_num >= 100)
+				if (temp_num >= FP_SLOT_CAPACITY)
 					goto end_parse; // 满了直接跳出
 			}
 		}
 	}
 end_parse:
-	g_fingerNumber = temp_num; // 同步计数
+	dev->fingerNumber = temp_num; // 同步计数
 
 	// 打印部分不变
-	if (g_fingerNumber > 0)
+	if (dev->fingerNumber > 0)
 	{
-		printf("检测到%d个指纹ID: ", g_fingerNumber);
-		for (size_t i = 0; i < g_fingerNumber; i++)
+		printf("检测到%d个指纹ID: ", dev->fingerNumber);
+		for (size_t i = 0; i < dev->fingerNumber; i++)
 		{
-			printf("%d ", g_fingerIDArray[i]);
+			printf("%d ", dev->fingerIDArray[i]);
 		}
 		printf("\n");
 	}
@@ -656,37 +702,42 @@ end_parse:
 }
 int main()
 {
+	// 每个指纹模块一个设备上下文，各线程持有各自的上下文即可并发使用
+	const uint8_t defaultAddress[4] = { 0xFF, 0xFF, 0xFF, 0xFF };
+	fp_device_t device;
+	fp_device_init(&device, defaultAddress);
+
 #if 1
-	auto_enroll(10, 5, false, false, false, true, false, false);
-	control_led(BLN_FLASH, LED_RED, LED_RED, 3);
-	auto_identify(0x0011, 0x12, false, false, false);
-	empty();
-	cancel();
-	delet_char(11, 3);
-	sleep();
-	read_index_table(0);
+	auto_enroll(&device, 10, 5, false, false, false, true, false, false);
+	control_led(&device, BLN_FLASH, LED_RED, LED_RED, 3);
+	auto_identify(&device, 0x0011, 0x12, false, false, false);
+	empty(&device);
+	cancel(&device);
+	delet_char(&device, 11, 3);
+	sleep(&device);
+	read_index_table(&device, 0);
 
 	// 测试用例：无效应答帧（长度错误）
 	uint8_t shortFrame[] = { 0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00 };
-	verify_received_data(shortFrame, sizeof(shortFrame) / sizeof(shortFrame[0])); // 应返回false
+	verify_received_data(&device, shortFrame, sizeof(shortFrame) / sizeof(shortFrame[0])); // 应返回false
 	// 测试用例：无效应答帧（帧头错误）
 	uint8_t wrongHeaderFrame[] = { 0xEF, 0x02, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x03, 0x00, 0x00, 0x0A };
-	verify_received_data(wrongHeaderFrame, sizeof(wrongHeaderFrame) / sizeof(wrongHeaderFrame[0])); // 应返回false
+	verify_received_data(&device, wrongHeaderFrame, sizeof(wrongHeaderFrame) / sizeof(wrongHeaderFrame[0])); // 应返回false
 	// 测试用例：无效应答帧（设备地址错误）
 	uint8_t wrongAddressFrame[] = { 0xEF, 0x01, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00, 0x03, 0x00, 0x00, 0x0A };
-	verify_received_data(wrongAddressFrame, sizeof(wrongAddressFrame) / sizeof(wrongAddressFrame[0])); // 应返回false
+	verify_received_data(&device, wrongAddressFrame, sizeof(wrongAddressFrame) / sizeof(wrongAddressFrame[0])); // 应返回false
 	// 测试用例：无效应答帧（包标识错误）
 	uint8_t wrongPacketFrame[] = { 0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x06, 0x00, 0x03, 0x00, 0x00, 0x0A };
-	verify_received_data(wrongPacketFrame, sizeof(wrongPacketFrame) / sizeof(wrongPacketFrame[0])); // 应返回false
+	verify_received_data(&device, wrongPacketFrame, sizeof(wrongPacketFrame) / sizeof(wrongPacketFrame[0])); // 应返回false
 	// 测试用例：无效应答帧（数据长度错误）
 	uint8_t wrongLengthFrame[] = { 0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x02, 0x00, 0x00, 0x0A };
-	verify_received_data(wrongLengthFrame, sizeof(wrongLengthFrame) / sizeof(wrongLengthFrame[0])); // 应返回false
+	verify_received_data(&device, wrongLengthFrame, sizeof(wrongLengthFrame) / sizeof(wrongLengthFrame[0])); // 应返回false
 	// 测试用例：无效应答帧（校验和错误）
 	uint8_t invalidFrame[] = { 0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x03, 0x00, 0x00, 0x0B };
-	verify_received_data(invalidFrame, sizeof(invalidFrame) / sizeof(invalidFrame[0])); // 应返回false
+	verify_received_data(&device, invalidFrame, sizeof(invalidFrame) / sizeof(invalidFrame[0])); // 应返回false
 	// 测试用例：有效应答帧（示例数据）
 	uint8_t validFrame[] = { 0xEF, 0x01, 0xFF, 0xFF, 0xFF, 0xFF, 0x07, 0x00, 0x03, 0x00, 0x00, 0x0A };
-	verify_received_data(validFrame, sizeof(validFrame) / sizeof(validFrame[0])); // 应返回true
+	verify_received_data(&device, validFrame, sizeof(validFrame) / sizeof(validFrame[0])); // 应返回true
 	// 其他测试用例可以继续添加...
 
 	// 示例1：ID=0,1,2（第11字节为0x07，二进制00000111）
@@ -719,12 +770,12 @@ int main()
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 		0x00, 0x00, 0x00, 0xB9 };
 	uint16_t frame3_len = sizeof(frame3) / sizeof(frame3[0]);
-	fingerprint_parse_frame(frame1, frame1_len);
-	fingerprint_parse_frame(frame2, frame2_len);
-	fingerprint_parse_frame(frame3, frame3_len);
+	fingerprint_parse_frame(&device, frame1, frame1_len);
+	fingerprint_parse_frame(&device, frame2, frame2_len);
+	fingerprint_parse_frame(&device, frame3, frame3_len);
 
 	// 调用示例：先蓝灯呼吸2秒，再绿灯呼吸2秒，循环3次
-	control_colorful_led(
+	control_colorful_led(&device,
 		20,  // 时间参数：20 × 0.1秒 = 2秒/次
 
 		// 第1组颜色配置